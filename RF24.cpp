@@ -9,11 +9,19 @@
 #include "nRF24L01.h"
 #include "RF24_config.h"
 #include "RF24.h"
+#include "RF24Airtime.h"
+#if defined (RF24_LINUX)
+#include <stdarg.h>
+#include "RF24Registers.h"
+#endif
 
 /****************************************************************************/
 
 void RF24::csn(bool mode)
 {
+#if defined (RF24_LINUX)
+	if(!mode) spi_accesses++;
+#endif
 
 #if defined (RF24_TINY)
 	if (ce_pin != csn_pin) {
@@ -82,7 +90,7 @@ void RF24::ce(bool level)
 
 /****************************************************************************/
 
-  inline void RF24::beginTransaction() {
+  void RF24::beginTransaction() {
     #if defined (RF24_SPI_TRANSACTIONS)
     _SPI.beginTransaction(SPISettings(RF24_SPI_SPEED, MSBFIRST, SPI_MODE0));
     #endif
@@ -91,7 +99,7 @@ void RF24::ce(bool level)
 
 /****************************************************************************/
 
-  inline void RF24::endTransaction() {
+  void RF24::endTransaction() {
     csn(HIGH);
 	#if defined (RF24_SPI_TRANSACTIONS)
     _SPI.endTransaction();
@@ -104,6 +112,11 @@ uint8_t RF24::read_register(uint8_t reg, uint8_t* buf, uint8_t len)
 {
   uint8_t status;
 
+  #if !defined (MINIMAL)
+  if ( cache_read(reg, buf, len) ) return last_status;
+  uint8_t* dst = buf;
+  #endif
+
   #if defined (RF24_LINUX)
   beginTransaction(); //configures the spi settings for RPi, locks mutex and setting csn low
   uint8_t * prx = spi_rxbuff;
@@ -133,6 +146,11 @@ uint8_t RF24::read_register(uint8_t reg, uint8_t* buf, uint8_t len)
 
 #endif
 
+  #if !defined (MINIMAL)
+  cache_store(reg, dst, buf - dst);
+  #endif
+
+  last_status = status;
   return status;
 }
 
@@ -141,6 +159,10 @@ uint8_t RF24::read_register(uint8_t reg, uint8_t* buf, uint8_t len)
 uint8_t RF24::read_register(uint8_t reg)
 {
   uint8_t result;
+
+  #if !defined (MINIMAL)
+  if ( cache_read(reg, &result, 1) ) return result;
+  #endif
   
   #if defined (RF24_LINUX)
 	
@@ -152,18 +174,23 @@ uint8_t RF24::read_register(uint8_t reg)
   *ptx++ = RF24_NOP ; // Dummy operation, just for reading
   
   _SPI.transfernb( (char *) spi_txbuff, (char *) spi_rxbuff, 2);
+  last_status = *prx;  // status is 1st byte of receive buffer
   result = *++prx;   // result is 2nd byte of receive buffer
   
   endTransaction();
   #else
 
   beginTransaction();
-  _SPI.transfer( R_REGISTER | ( REGISTER_MASK & reg ) );
+  last_status = _SPI.transfer( R_REGISTER | ( REGISTER_MASK & reg ) );
   result = _SPI.transfer(0xff);
   endTransaction();
 
   #endif
 
+  #if !defined (MINIMAL)
+  cache_store(reg, &result, 1);
+  #endif
+
   return result;
 }
 
@@ -173,6 +200,10 @@ uint8_t RF24::write_register(uint8_t reg, const uint8_t* buf, uint8_t len)
 {
   uint8_t status;
 
+  #if !defined (MINIMAL)
+  if ( cache_write(reg, buf, len) ) return last_status; // Unchanged, nothing to send
+  #endif
+
   #if defined (RF24_LINUX) 
   beginTransaction();
   uint8_t * prx = spi_rxbuff;
@@ -196,6 +227,7 @@ uint8_t RF24::write_register(uint8_t reg, const uint8_t* buf, uint8_t len)
 
   #endif
 
+  last_status = status;
   return status;
 }
 
@@ -207,6 +239,10 @@ uint8_t RF24::write_register(uint8_t reg, uint8_t value)
 
   IF_SERIAL_DEBUG(printf_P(PSTR("write_register(%02x,%02x)\r\n"),reg,value));
 
+  #if !defined (MINIMAL)
+  if ( cache_write(reg, &value, 1) ) return last_status; // Unchanged, nothing to send
+  #endif
+
   #if defined (RF24_LINUX)
     beginTransaction();
 	uint8_t * prx = spi_rxbuff;
@@ -226,23 +262,534 @@ uint8_t RF24::write_register(uint8_t reg, uint8_t value)
 
   #endif
 
+  last_status = status;
+  if ( ( REGISTER_MASK & reg ) == NRF_STATUS ){
+    last_status &= ~( value & ( _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT) ) ); // Flags are cleared by writing 1
+  }
   return status;
 }
 
 /****************************************************************************/
+#if !defined (MINIMAL)
+
+uint8_t* RF24::cache_slot(uint8_t reg, uint8_t& width, uint32_t& bit)
+{
+  reg &= REGISTER_MASK;
+  width = 1;
+
+  if ( reg <= RF_SETUP ){ // NRF_CONFIG, EN_AA, EN_RXADDR, SETUP_AW, SETUP_RETR, RF_CH, RF_SETUP
+    bit = 1UL << reg;
+    return &reg_cache[reg];
+  }
+  if ( reg >= RX_PW_P0 && reg <= RX_PW_P5 ){
+    bit = 1UL << ( reg - RX_PW_P0 + 7 );
+    return &reg_cache[reg - RX_PW_P0 + 7];
+  }
+  if ( reg == DYNPD || reg == FEATURE ){
+    bit = 1UL << ( reg - DYNPD + 13 );
+    return &reg_cache[reg - DYNPD + 13];
+  }
+  if ( reg >= RX_ADDR_P0 && reg <= TX_ADDR ){
+    // Pipes 2-5 only have their own LSB
+    if ( reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR ) width = 5;
+    bit = 1UL << ( reg - RX_ADDR_P0 + 15 );
+    return addr_cache[reg - RX_ADDR_P0];
+  }
+  return NULL;
+}
+
+/****************************************************************************/
+
+bool RF24::cache_read(uint8_t reg, uint8_t* buf, uint8_t len)
+{
+  uint8_t width;
+  uint32_t bit;
+  uint8_t* slot;
+
+  if ( !reg_cache_enabled || !( slot = cache_slot(reg, width, bit) ) ) return false;
+  if ( !( reg_cache_valid & bit ) || len > width ) return false;
+
+  memcpy(buf, slot, len);
+  return true;
+}
+
+/****************************************************************************/
+
+void RF24::cache_store(uint8_t reg, const uint8_t* buf, uint8_t len)
+{
+  uint8_t width;
+  uint32_t bit;
+  uint8_t* slot;
+
+  if ( !reg_cache_enabled || !( slot = cache_slot(reg, width, bit) ) ) return;
+
+  memcpy(slot, buf, rf24_min(len, width));
+  // A partial access only validates a slot that was already known
+  if ( len >= width ) reg_cache_valid |= bit;
+}
+
+/****************************************************************************/
+
+bool RF24::cache_write(uint8_t reg, const uint8_t* buf, uint8_t len)
+{
+  uint8_t width;
+  uint32_t bit;
+  uint8_t* slot;
+
+  if ( !reg_cache_enabled || !( slot = cache_slot(reg, width, bit) ) ) return false;
+
+  uint8_t size = rf24_min(len, width);
+  if ( ( reg_cache_valid & bit ) && !memcmp(slot, buf, size) ) return true;
+
+  cache_store(reg, buf, len);
+  return false;
+}
+
+/****************************************************************************/
+
+void RF24::cache_drop(uint8_t reg)
+{
+  uint8_t width;
+  uint32_t bit;
+
+  if ( cache_slot(reg, width, bit) ) reg_cache_valid &= ~bit;
+}
+
+/****************************************************************************/
+
+void RF24::cache_fill(void)
+{
+  uint8_t buf[5];
+
+  for ( uint8_t reg = 0; reg <= FEATURE; reg++ ){
+    uint8_t width;
+    uint32_t bit;
+    if ( cache_slot(reg, width, bit) && !( reg_cache_valid & bit ) ){
+      read_register(reg, buf, width);
+    }
+  }
+}
+
+/****************************************************************************/
+
+void RF24::enableRegisterCache(void)
+{
+  reg_cache_enabled = true;
+  reg_cache_valid = 0;
+}
+
+/****************************************************************************/
+
+void RF24::disableRegisterCache(void)
+{
+  reg_cache_enabled = false;
+}
+
+/****************************************************************************/
+
+void RF24::reloadRegisterCache(void)
+{
+  if ( !reg_cache_enabled ) return;
+
+  reg_cache_valid = 0;
+  cache_fill();
+}
+
+/****************************************************************************/
+
+bool RF24::verifyRegisterCache(bool restore)
+{
+  if ( !reg_cache_enabled ) return true;
+
+  bool match = true;
+  uint8_t chip[5];
+
+  reg_cache_enabled = false; // Talk to the chip directly
+
+  // NRF_CONFIG goes last, so a restored PWR_UP comes after the rest of the configuration
+  for ( uint8_t n = 1; n <= FEATURE + 1; n++ ){
+    uint8_t reg = n % ( FEATURE + 1 );
+    uint8_t width;
+    uint32_t bit;
+    uint8_t* slot = cache_slot(reg, width, bit);
+
+    if ( !slot || !( reg_cache_valid & bit ) ) continue;
+
+    read_register(reg, chip, width);
+    if ( !memcmp(chip, slot, width) ) continue;
+
+    match = false;
+    if ( restore ){
+      write_register(reg, slot, width);
+      if ( reg == NRF_CONFIG && ( slot[0] & _BV(PWR_UP) ) && !( chip[0] & _BV(PWR_UP) ) ){
+        delay(5); // Tpd2stby, see powerUp()
+      }
+    }else{
+      memcpy(slot, chip, width);
+    }
+  }
+
+  reg_cache_enabled = true;
+  return match;
+}
+
+/****************************************************************************/
+#endif
+
+#if defined (RF24_LINUX)
+
+// Every image register, address register and OBSERVE_TX, RPD and FIFO_STATUS at once
+static const uint8_t reg_access_max = RF24RegisterImage::count + TX_ADDR - RX_ADDR_P0 + 1 + 3;
+
+void RF24::read_registers(RegAccess* regs, uint8_t count, bool chip)
+{
+  #if defined (RF24_SPI_BATCH)
+  uint8_t tx[reg_access_max][6];
+  uint8_t rx[reg_access_max][6];
+  uint8_t queued[reg_access_max];
+  uint8_t n = 0;
+
+  for ( uint8_t i = 0; i < count; i++ ){
+    #if !defined (MINIMAL)
+    if ( !chip && cache_read(regs[i].reg, regs[i].data, regs[i].len) ) continue;
+    #endif
+    tx[n][0] = R_REGISTER | ( REGISTER_MASK & regs[i].reg );
+    memset(tx[n] + 1, RF24_NOP, regs[i].len);
+    queued[n++] = i;
+  }
+  if ( !n ) return;
+
+  beginTransaction();
+  _SPI.beginBatch();
+  for ( uint8_t k = 0; k < n; k++ ){
+    _SPI.batch( (char *) tx[k], (char *) rx[k], 1 + regs[queued[k]].len);
+  }
+  _SPI.endBatch();
+  endTransaction();
+
+  for ( uint8_t k = 0; k < n; k++ ){
+    RegAccess& r = regs[queued[k]];
+    memcpy(r.data, rx[k] + 1, r.len);
+    #if !defined (MINIMAL)
+    cache_store(r.reg, r.data, r.len);
+    #endif
+  }
+  last_status = rx[n - 1][0];
+  #else
+  #if !defined (MINIMAL)
+  bool cached = reg_cache_enabled;
+  reg_cache_enabled = reg_cache_enabled && !chip;
+  #endif
+  for ( uint8_t i = 0; i < count; i++ ){
+    read_register(regs[i].reg, regs[i].data, regs[i].len);
+  }
+  #if !defined (MINIMAL)
+  reg_cache_enabled = cached;
+  #endif
+  #endif
+}
+
+/****************************************************************************/
+
+void RF24::write_registers(const RegAccess* regs, uint8_t count)
+{
+  #if defined (RF24_SPI_BATCH)
+  uint8_t tx[reg_access_max][6];
+  uint8_t rx[reg_access_max][6];
+
+  if ( !count ) return;
+
+  beginTransaction();
+  _SPI.beginBatch();
+  for ( uint8_t i = 0; i < count; i++ ){
+    tx[i][0] = W_REGISTER | ( REGISTER_MASK & regs[i].reg );
+    memcpy(tx[i] + 1, regs[i].data, regs[i].len);
+    _SPI.batch( (char *) tx[i], (char *) rx[i], 1 + regs[i].len);
+  }
+  _SPI.endBatch();
+  endTransaction();
+
+  #if !defined (MINIMAL)
+  for ( uint8_t i = 0; i < count; i++ ){
+    cache_store(regs[i].reg, regs[i].data, regs[i].len);
+  }
+  #endif
+  last_status = rx[count - 1][0];
+  #else
+  for ( uint8_t i = 0; i < count; i++ ){
+    write_register(regs[i].reg, regs[i].data, regs[i].len);
+  }
+  #endif
+}
+
+/****************************************************************************/
+
+void RF24::image_state(const RF24RegisterImage& image, bool powering_up)
+{
+  if ( powering_up ){
+    delay(5); // Tpd2stby, see powerUp()
+  }
+
+  addr_width = RF24Reg::SetupAw::Aw::get(image.get(SETUP_AW)) + 2;
+  dynamic_payloads_enabled = RF24Reg::Feature::EnDpl::get(image.get(FEATURE));
+  uint8_t rate = image.get(RF_SETUP) & ( _BV(RF_DR_LOW) | _BV(RF_DR_HIGH) );
+  txDelay = rate == _BV(RF_DR_LOW) ? 450 : rate == _BV(RF_DR_HIGH) ? 190 : 250; // As setDataRate()
+  tx_rate = rate == _BV(RF_DR_LOW) ? RF24_250KBPS : rate == _BV(RF_DR_HIGH) ? RF24_2MBPS : RF24_1MBPS;
+  tx_retries = image.get(SETUP_RETR);
+  for ( uint8_t pipe = 0; pipe < 6; pipe++ ){
+    uint8_t width = image.get(RX_PW_P0 + pipe);
+    pipe_payload_size[pipe] = width ? width : payload_size;
+  }
+}
+
+/****************************************************************************/
+
+void RF24::readRegisters(RF24RegisterImage& image)
+{
+  RegAccess regs[RF24RegisterImage::count];
+
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    regs[i].reg = RF24RegisterImage::reg(i);
+    regs[i].len = 1;
+  }
+  read_registers(regs, RF24RegisterImage::count);
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    image.values[i] = regs[i].data[0];
+  }
+}
+
+/****************************************************************************/
+
+void RF24::writeRegisters(const RF24RegisterImage& image)
+{
+  bool powering_up = ( image.get(NRF_CONFIG) & _BV(PWR_UP) ) && !( read_register(NRF_CONFIG) & _BV(PWR_UP) );
+  RegAccess regs[RF24RegisterImage::count];
+  uint8_t count = 0;
+
+  // NRF_CONFIG is slot 0, it goes last
+  for ( uint8_t n = 1; n <= RF24RegisterImage::count; n++ ){
+    uint8_t i = n % RF24RegisterImage::count;
+    uint8_t reg = RF24RegisterImage::reg(i);
+    #if !defined (MINIMAL)
+    if ( cache_write(reg, &image.values[i], 1) ) continue; // Unchanged, nothing to send
+    #endif
+    regs[count].reg = reg;
+    regs[count].len = 1;
+    regs[count].data[0] = image.values[i];
+    count++;
+  }
+  write_registers(regs, count);
+
+  image_state(image, powering_up);
+}
+
+/****************************************************************************/
+
+void RF24::apply(const RF24RadioProfile& profile)
+{
+  const uint8_t width = rf24_max(3, rf24_min(profile.address_width, 5));
+  RegAccess regs[reg_access_max];
+  uint8_t count = RF24RegisterImage::count;
+
+  // The registers, then the addresses the profile sets
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    regs[i].reg = RF24RegisterImage::reg(i);
+    regs[i].len = 1;
+  }
+  if ( profile.writing_address ){
+    regs[count].reg = TX_ADDR;
+    regs[count++].len = width;
+  }
+  if ( profile.writing_address || ( profile.reading_pipes & 1 ) ){
+    regs[count].reg = RX_ADDR_P0;
+    regs[count++].len = width;
+  }
+  for ( uint8_t pipe = 1; pipe < 6; pipe++ ){
+    if ( profile.reading_pipes & _BV(pipe) ){
+      regs[count].reg = RX_ADDR_P0 + pipe;
+      regs[count++].len = pipe == 1 ? width : 1; // Pipes 2-5 only have their own LSB
+    }
+  }
+  read_registers(regs, count);
+
+  RF24RegisterImage current;
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    current.values[i] = regs[i].data[0];
+  }
+  const RF24RegisterImage image = profile.image(current);
+
+  // Keep what changes, addresses first and NRF_CONFIG last
+  RegAccess changed[reg_access_max];
+  uint8_t n = 0;
+  for ( uint8_t i = RF24RegisterImage::count; i < count; i++ ){
+    uint64_t address = regs[i].reg == TX_ADDR || ( regs[i].reg == RX_ADDR_P0 && profile.pipe0Writes(current) )
+                     ? profile.writing_address : profile.reading_addresses[regs[i].reg - RX_ADDR_P0];
+    // Addresses are sent LSB first, like openReadingPipe() does on little endian Linux
+    if ( !memcmp(regs[i].data, &address, regs[i].len) ) continue;
+    changed[n] = regs[i];
+    memcpy(changed[n++].data, &address, regs[i].len);
+  }
+  for ( uint8_t k = 1; k <= RF24RegisterImage::count; k++ ){
+    uint8_t i = k % RF24RegisterImage::count;
+    if ( image.values[i] == current.values[i] ) continue;
+    changed[n].reg = RF24RegisterImage::reg(i);
+    changed[n].len = 1;
+    changed[n++].data[0] = image.values[i];
+  }
+  write_registers(changed, n);
+
+  payload_size = rf24_min(profile.payload_size, 32);
+  image_state(image, false);
+  tx_payload_size = profile.writingWidth();
+  if ( profile.reading_pipes & 1 ){
+    memcpy(pipe0_reading_address, &profile.reading_addresses[0], width);
+  }else{
+    pipe0_reading_address[0] = 0;
+  }
+}
+
+/****************************************************************************/
+
+void RF24::snapshot(RF24RadioState& state)
+{
+  RegAccess regs[reg_access_max];
+  uint8_t count = 0;
+
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    regs[count].reg = RF24RegisterImage::reg(i);
+    regs[count++].len = 1;
+  }
+  for ( uint8_t reg = RX_ADDR_P0; reg <= TX_ADDR; reg++ ){
+    regs[count].reg = reg;
+    regs[count++].len = reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR ? 5 : 1;
+  }
+  regs[count].reg = OBSERVE_TX;
+  regs[count++].len = 1;
+  regs[count].reg = RPD;
+  regs[count++].len = 1;
+  regs[count].reg = FIFO_STATUS;
+  regs[count++].len = 1;
+  read_registers(regs, count, true);
+
+  const RegAccess* r = regs;
+  for ( uint8_t i = 0; i < RF24RegisterImage::count; i++ ){
+    state.registers.values[i] = (r++)->data[0];
+  }
+  memset(state.addresses, 0, sizeof(state.addresses));
+  for ( uint8_t i = 0; i < 7; i++, r++ ){
+    memcpy(state.addresses[i], r->data, r->len);
+  }
+  state.observe_tx = (r++)->data[0];
+  state.rpd = (r++)->data[0];
+  state.fifo_status = r->data[0];
+  state.status = last_status;
+  state.payload_size = payload_size;
+  state.tx_payload_size = tx_payload_size;
+  memcpy(state.pipe0_reading_address, pipe0_reading_address, sizeof(pipe0_reading_address));
+  state.p_variant = p_variant;
+}
+
+/****************************************************************************/
+
+bool RF24::holdsState(const RF24RadioState& state)
+{
+  RegAccess regs[RF_SETUP + 1];
+
+  for ( uint8_t reg = NRF_CONFIG; reg <= RF_SETUP; reg++ ){
+    regs[reg].reg = reg;
+    regs[reg].len = 1;
+  }
+  read_registers(regs, RF_SETUP + 1, true);
+
+  for ( uint8_t reg = NRF_CONFIG; reg <= RF_SETUP; reg++ ){
+    uint8_t mask = reg == NRF_CONFIG ? (uint8_t) ~_BV(PRIM_RX) : reg == EN_RXADDR ? 0 : 0xFF;
+    if ( ( regs[reg].data[0] ^ state.registers.get(reg) ) & mask ) return false;
+  }
+  return true;
+}
+
+/****************************************************************************/
+
+bool RF24::restore(const RF24RadioState& state)
+{
+  ce(LOW);
+
+  bool reset = !holdsState(state);
+  bool powering_up = ( state.registers.get(NRF_CONFIG) & _BV(PWR_UP) ) && !( read_register(NRF_CONFIG) & _BV(PWR_UP) );
+  if ( reset && !p_variant ){
+    toggle_features(); // FEATURE and DYNPD need ACTIVATE again on the nRF24L01, see begin()
+  }
+
+  flush_rx();
+  flush_tx();
+
+  // The addresses, the registers and the flags, NRF_CONFIG last
+  RegAccess regs[reg_access_max];
+  uint8_t count = 0;
+  for ( uint8_t reg = RX_ADDR_P0; reg <= TX_ADDR; reg++ ){
+    regs[count].reg = reg;
+    regs[count].len = reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR ? 5 : 1;
+    memcpy(regs[count++].data, state.addresses[reg - RX_ADDR_P0], 5);
+  }
+  for ( uint8_t n = 1; n <= RF24RegisterImage::count; n++ ){
+    uint8_t i = n % RF24RegisterImage::count;
+    if ( !i ){
+      regs[count].reg = NRF_STATUS;
+      regs[count].len = 1;
+      regs[count++].data[0] = _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT);
+    }
+    regs[count].reg = RF24RegisterImage::reg(i);
+    regs[count].len = 1;
+    regs[count++].data[0] = state.registers.values[i];
+  }
+  write_registers(regs, count);
+  last_status &= ~( _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT) );
+
+  payload_size = state.payload_size;
+  image_state(state.registers, powering_up);
+  tx_payload_size = state.tx_payload_size;
+  memcpy(pipe0_reading_address, state.pipe0_reading_address, sizeof(pipe0_reading_address));
+
+  if ( !holdsState(state) ) return false;
+  if ( state.registers.get(NRF_CONFIG) & _BV(PRIM_RX) ){
+    ce(HIGH);
+  }
+  return true;
+}
+
+/****************************************************************************/
+#endif
 
 uint8_t RF24::write_payload(const void* buf, uint8_t data_len, const uint8_t writeType)
 {
   uint8_t status;
   const uint8_t* current = reinterpret_cast<const uint8_t*>(buf);
 
-   data_len = rf24_min(data_len, payload_size);
-   uint8_t blank_len = dynamic_payloads_enabled ? 0 : payload_size - data_len;
+   data_len = rf24_min(data_len, tx_payload_size);
+   uint8_t blank_len = dynamic_payloads_enabled ? 0 : tx_payload_size - data_len;
+   #if defined (RF24_LINUX)
+   tx_len = data_len + blank_len;
+   tx_ack = writeType == W_TX_PAYLOAD;
+   #endif
   
   //printf("[Writing %u bytes %u blanks]",data_len,blank_len);
   IF_SERIAL_DEBUG( printf("[Writing %u bytes %u blanks]\n",data_len,blank_len); );
   
- #if defined (RF24_LINUX)
+ #if defined (RF24_SPI_SEGMENTS)
+	// Command, payload straight from the caller's buffer and the padding of
+	// a static payload, in one chip select frame
+	static const uint8_t blanks[32] = { 0 };
+	SPISegment segs[3];
+	uint8_t count = 0;
+	segs[count++] = { &writeType, &status, 1 };
+	if ( data_len ) segs[count++] = { current, NULL, data_len };
+	if ( blank_len ) segs[count++] = { blanks, NULL, blank_len };
+
+	beginTransaction();
+	_SPI.transferSegments(segs, count);
+	endTransaction();
+
+ #elif defined (RF24_LINUX)
 	beginTransaction();
 	uint8_t * prx = spi_rxbuff;
 	uint8_t * ptx = spi_txbuff;
@@ -273,6 +820,7 @@ uint8_t RF24::write_payload(const void* buf, uint8_t data_len, const uint8_t wri
 
   #endif
 
+  last_status = status;
   return status;
 }
 
@@ -283,14 +831,30 @@ uint8_t RF24::read_payload(void* buf, uint8_t data_len)
   uint8_t status;
   uint8_t* current = reinterpret_cast<uint8_t*>(buf);
 
-  if(data_len > payload_size) data_len = payload_size;
-  uint8_t blank_len = dynamic_payloads_enabled ? 0 : payload_size - data_len;
+  // Padded to the width of the pipe the payload came in on, as last reported by STATUS
+  uint8_t pipe = ( last_status >> RX_P_NO ) & 0x07;
+  uint8_t width = pipe < 6 ? pipe_payload_size[pipe] : payload_size;
+  if(data_len > width) data_len = width;
+  uint8_t blank_len = dynamic_payloads_enabled ? 0 : width - data_len;
   
   //printf("[Reading %u bytes %u blanks]",data_len,blank_len);
 
   IF_SERIAL_DEBUG( printf("[Reading %u bytes %u blanks]\n",data_len,blank_len); );
   
-  #if defined (RF24_LINUX)
+  #if defined (RF24_SPI_SEGMENTS)
+	// Payload straight into the caller's buffer, NOPs clocked out by the backend
+	const uint8_t command = R_RX_PAYLOAD;
+	SPISegment segs[3];
+	uint8_t count = 0;
+	segs[count++] = { &command, &status, 1 };
+	if ( data_len ) segs[count++] = { NULL, current, data_len };
+	if ( blank_len ) segs[count++] = { NULL, NULL, blank_len };
+
+	beginTransaction();
+	_SPI.transferSegments(segs, count);
+	endTransaction();
+
+  #elif defined (RF24_LINUX)
 	beginTransaction();
 	uint8_t * prx = spi_rxbuff;
 	uint8_t * ptx = spi_txbuff;
@@ -328,11 +892,84 @@ uint8_t RF24::read_payload(void* buf, uint8_t data_len)
 
   #endif
 
+  last_status = status;
   return status;
 }
 
 /****************************************************************************/
 
+#if defined (RF24_SPI_BATCH)
+uint8_t RF24::read_payload(void* buf, uint8_t data_len, bool clear_irq)
+{
+  uint8_t* current = reinterpret_cast<uint8_t*>(buf);
+
+  // Padded to the width of the pipe the payload came in on, as last reported by STATUS
+  uint8_t pipe = ( last_status >> RX_P_NO ) & 0x07;
+  uint8_t width = pipe < 6 ? pipe_payload_size[pipe] : payload_size;
+  if(data_len > width) data_len = width;
+  uint8_t blank_len = dynamic_payloads_enabled ? 0 : width - data_len;
+  uint8_t size = data_len + blank_len + 1; // Add register value to transmit buffer
+
+  beginTransaction();
+  spi_txbuff[0] = R_RX_PAYLOAD;
+  _SPI.beginBatch();
+  #if defined (RF24_SPI_SEGMENTS)
+  SPISegment segs[3];
+  uint8_t count = 0;
+  segs[count++] = { spi_txbuff, spi_rxbuff, 1 };
+  if ( data_len ) segs[count++] = { NULL, current, data_len };
+  if ( blank_len ) segs[count++] = { NULL, NULL, blank_len };
+  _SPI.batchSegments(segs, count);
+  size = 1; // Only the command went through the buffers
+  #else
+  memset(spi_txbuff + 1, RF24_NOP, size - 1);
+  _SPI.batch( (char *) spi_txbuff, (char *) spi_rxbuff, size);
+  #endif
+  if (clear_irq) {
+    // Second command of the same batch, right behind the payload in the buffers
+    spi_txbuff[size] = W_REGISTER | ( REGISTER_MASK & NRF_STATUS );
+    spi_txbuff[size + 1] = _BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS);
+    _SPI.batch( (char *) spi_txbuff + size, (char *) spi_rxbuff + size, 2);
+  }
+  _SPI.endBatch();
+  endTransaction();
+
+  #if !defined (RF24_SPI_SEGMENTS)
+  memcpy(current, spi_rxbuff + 1, data_len);
+  #endif
+  last_status = spi_rxbuff[0]; // 1st byte is status
+  if (clear_irq) {
+    last_status &= ~( _BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS) );
+  }
+  return spi_rxbuff[0];
+}
+
+/****************************************************************************/
+
+uint8_t RF24::clear_status(bool flush)
+{
+  beginTransaction();
+  spi_txbuff[0] = W_REGISTER | ( REGISTER_MASK & NRF_STATUS );
+  spi_txbuff[1] = _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT);
+  spi_txbuff[2] = FLUSH_TX;
+  _SPI.beginBatch();
+  _SPI.batch( (char *) spi_txbuff, (char *) spi_rxbuff, 2);
+  if (flush) {
+    _SPI.batch( (char *) spi_txbuff + 2, (char *) spi_rxbuff + 2, 1);
+  }
+  _SPI.endBatch();
+  endTransaction();
+
+  last_status = spi_rxbuff[0] & ~( _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT) );
+  if (flush) {
+    last_status &= ~_BV(TX_FULL);
+  }
+  return spi_rxbuff[0]; // status before the flags were cleared
+}
+
+/****************************************************************************/
+#endif
+
 uint8_t RF24::flush_rx(void)
 {
   return spiTrans( FLUSH_RX );
@@ -355,6 +992,7 @@ uint8_t RF24::spiTrans(uint8_t cmd){
   status = _SPI.transfer( cmd ); //DDMDSDD
   endTransaction();
   
+  last_status = status;
   return status;
 }
 
@@ -434,9 +1072,37 @@ void RF24::print_address_register(const char* name, uint8_t reg, uint8_t qty)
 
 RF24::RF24(uint16_t _cepin, uint16_t _cspin):
   ce_pin(_cepin), csn_pin(_cspin), p_variant(false),
-  payload_size(32), dynamic_payloads_enabled(false), addr_width(5),csDelay(5)//,pipe0_reading_address(0)
+  payload_size(32), dynamic_payloads_enabled(false), addr_width(5),last_status(0),csDelay(5)//,pipe0_reading_address(0)
 {
   pipe0_reading_address[0]=0;
+  memset(pipe_payload_size, payload_size, sizeof(pipe_payload_size));
+  tx_payload_size = payload_size;
+  #if defined (RF24_TX_POLICY)
+  timeout_policy.margin_us = 1000;
+  timeout_policy.fixed_us = 0;
+  timeout_policy.notify = true;
+  tx_retries = 5 << ARD | 15 << ARC; // As begin() sets them
+  tx_rate = RF24_1MBPS;
+  #endif
+  #if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+  tx_result = RF24_TX_OK;
+  #endif
+  #if defined (RF24_LINUX)
+  tx_wait = RF24_WAIT_SPIN;
+  tx_len = payload_size;
+  tx_ack = true;
+  spi_accesses = 0;
+  tx_spi_start = 0;
+  resetTxStats();
+  #endif
+  #if !defined (MINIMAL)
+  reg_cache_enabled = false;
+  reg_cache_valid = 0;
+  #endif
+  #if defined (RF24_IRQ_WAIT)
+  irq_pin = -1;
+  tx_ds_cleared = false;
+  #endif
 }
 
 /****************************************************************************/
@@ -444,9 +1110,37 @@ RF24::RF24(uint16_t _cepin, uint16_t _cspin):
 #if defined (RF24_LINUX) && !defined (MRAA)//RPi constructor
 
 RF24::RF24(uint16_t _cepin, uint16_t _cspin, uint32_t _spi_speed):
-  ce_pin(_cepin),csn_pin(_cspin),spi_speed(_spi_speed),p_variant(false), payload_size(32), dynamic_payloads_enabled(false),addr_width(5)//,pipe0_reading_address(0) 
+  ce_pin(_cepin),csn_pin(_cspin),spi_speed(_spi_speed),p_variant(false), payload_size(32), dynamic_payloads_enabled(false),addr_width(5),last_status(0)//,pipe0_reading_address(0) 
 {
   pipe0_reading_address[0]=0;
+  memset(pipe_payload_size, payload_size, sizeof(pipe_payload_size));
+  tx_payload_size = payload_size;
+  #if defined (RF24_TX_POLICY)
+  timeout_policy.margin_us = 1000;
+  timeout_policy.fixed_us = 0;
+  timeout_policy.notify = true;
+  tx_retries = 5 << ARD | 15 << ARC; // As begin() sets them
+  tx_rate = RF24_1MBPS;
+  #endif
+  #if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+  tx_result = RF24_TX_OK;
+  #endif
+  #if defined (RF24_LINUX)
+  tx_wait = RF24_WAIT_SPIN;
+  tx_len = payload_size;
+  tx_ack = true;
+  spi_accesses = 0;
+  tx_spi_start = 0;
+  resetTxStats();
+  #endif
+  #if !defined (MINIMAL)
+  reg_cache_enabled = false;
+  reg_cache_valid = 0;
+  #endif
+  #if defined (RF24_IRQ_WAIT)
+  irq_pin = -1;
+  tx_ds_cleared = false;
+  #endif
 }
 #endif
 
@@ -468,6 +1162,21 @@ uint8_t RF24::getChannel()
 void RF24::setPayloadSize(uint8_t size)
 {
   payload_size = rf24_min(size,32);
+  memset(pipe_payload_size, payload_size, sizeof(pipe_payload_size));
+  tx_payload_size = payload_size;
+  // read_payload() pads to the width of the pipe, the chip must agree
+  for ( uint8_t pipe = 0; pipe < 6; pipe++ ){
+    write_register(RX_PW_P0 + pipe, payload_size);
+  }
+}
+
+/****************************************************************************/
+
+void RF24::setPayloadSize(uint8_t pipe, uint8_t size)
+{
+  if ( pipe > 5 ) return;
+  pipe_payload_size[pipe] = rf24_min(size,32);
+  write_register(RX_PW_P0 + pipe,pipe_payload_size[pipe]);
 }
 
 /****************************************************************************/
@@ -479,6 +1188,13 @@ uint8_t RF24::getPayloadSize(void)
 
 /****************************************************************************/
 
+uint8_t RF24::getPayloadSize(uint8_t pipe)
+{
+  return pipe < 6 ? pipe_payload_size[pipe] : payload_size;
+}
+
+/****************************************************************************/
+
 #if !defined (MINIMAL)
 
 static const char rf24_datarate_e_str_0[] PROGMEM = "1MBPS";
@@ -538,51 +1254,276 @@ void RF24::printDetails(void)
     printf("CSN Pin  \t = Custom GPIO%d%s\n", csn_pin,
     csn_pin==RPI_V2_GPIO_P1_26 ? " (CE1) Software Driven" : "" );
   }
-  printf("CE Pin  \t = Custom GPIO%d\n", ce_pin );
-  printf("Clock Speed\t = " );
-	switch (spi_speed)
-	{
-		case BCM2835_SPI_SPEED_64MHZ : printf("64 Mhz");	break ;
-		case BCM2835_SPI_SPEED_32MHZ : printf("32 Mhz");	break ;
-		case BCM2835_SPI_SPEED_16MHZ : printf("16 Mhz");	break ;
-		case BCM2835_SPI_SPEED_8MHZ  : printf("8 Mhz");	break ;
-		case BCM2835_SPI_SPEED_4MHZ  : printf("4 Mhz");	break ;
-		case BCM2835_SPI_SPEED_2MHZ  : printf("2 Mhz");	break ;
-		case BCM2835_SPI_SPEED_1MHZ  : printf("1 Mhz");	break ;
-		case BCM2835_SPI_SPEED_512KHZ: printf("512 KHz");	break ;
-		case BCM2835_SPI_SPEED_256KHZ: printf("256 KHz");	break ;
-		case BCM2835_SPI_SPEED_128KHZ: printf("128 KHz");	break ;
-		case BCM2835_SPI_SPEED_64KHZ : printf("64 KHz");	break ;
-		case BCM2835_SPI_SPEED_32KHZ : printf("32 KHz");	break ;
-		case BCM2835_SPI_SPEED_16KHZ : printf("16 KHz");	break ;
-		case BCM2835_SPI_SPEED_8KHZ  : printf("8 KHz");	break ;
-		default : printf("8 Mhz");	break ;
-	}
-	printf("\n================ NRF Configuration ================\n");
- 
-#endif //Linux
+  printf("CE Pin  \t = Custom GPIO%d\n", ce_pin );
+  printf("Clock Speed\t = " );
+	switch (spi_speed)
+	{
+		case BCM2835_SPI_SPEED_64MHZ : printf("64 Mhz");	break ;
+		case BCM2835_SPI_SPEED_32MHZ : printf("32 Mhz");	break ;
+		case BCM2835_SPI_SPEED_16MHZ : printf("16 Mhz");	break ;
+		case BCM2835_SPI_SPEED_8MHZ  : printf("8 Mhz");	break ;
+		case BCM2835_SPI_SPEED_4MHZ  : printf("4 Mhz");	break ;
+		case BCM2835_SPI_SPEED_2MHZ  : printf("2 Mhz");	break ;
+		case BCM2835_SPI_SPEED_1MHZ  : printf("1 Mhz");	break ;
+		case BCM2835_SPI_SPEED_512KHZ: printf("512 KHz");	break ;
+		case BCM2835_SPI_SPEED_256KHZ: printf("256 KHz");	break ;
+		case BCM2835_SPI_SPEED_128KHZ: printf("128 KHz");	break ;
+		case BCM2835_SPI_SPEED_64KHZ : printf("64 KHz");	break ;
+		case BCM2835_SPI_SPEED_32KHZ : printf("32 KHz");	break ;
+		case BCM2835_SPI_SPEED_16KHZ : printf("16 KHz");	break ;
+		case BCM2835_SPI_SPEED_8KHZ  : printf("8 KHz");	break ;
+		default : printf("8 Mhz");	break ;
+	}
+	printf("\n================ NRF Configuration ================\n");
+ 
+#endif //Linux
+
+#if defined (RF24_LINUX)
+  // One snapshot instead of a read per register
+  RF24RadioState state;
+  char text[1024];
+  snapshot(state);
+  state.format(text, sizeof(text));
+  fputs(text, stdout);
+#else
+  print_status(get_status());
+
+  print_address_register(PSTR("RX_ADDR_P0-1"),RX_ADDR_P0,2);
+  print_byte_register(PSTR("RX_ADDR_P2-5"),RX_ADDR_P2,4);
+  print_address_register(PSTR("TX_ADDR\t"),TX_ADDR);
+
+  print_byte_register(PSTR("RX_PW_P0-6"),RX_PW_P0,6);
+  print_byte_register(PSTR("EN_AA\t"),EN_AA);
+  print_byte_register(PSTR("EN_RXADDR"),EN_RXADDR);
+  print_byte_register(PSTR("RF_CH\t"),RF_CH);
+  print_byte_register(PSTR("RF_SETUP"),RF_SETUP);
+  print_byte_register(PSTR("CONFIG\t"),NRF_CONFIG);
+  print_byte_register(PSTR("DYNPD/FEATURE"),DYNPD,2);
+
+  printf_P(PSTR("Data Rate\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_datarate_e_str_P[getDataRate()]));
+  printf_P(PSTR("Model\t\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_model_e_str_P[isPVariant()]));
+  printf_P(PSTR("CRC Length\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_crclength_e_str_P[getCRCLength()]));
+  printf_P(PSTR("PA Power\t = " PRIPSTR "\r\n"),  pgm_read_ptr(&rf24_pa_dbm_e_str_P[getPALevel()]));
+#endif
+
+}
+
+/****************************************************************************/
+#if defined (RF24_LINUX)
+
+static const char* const rf24_register_names[FEATURE + 1] = {
+  "CONFIG", "EN_AA", "EN_RXADDR", "SETUP_AW", "SETUP_RETR", "RF_CH", "RF_SETUP", "STATUS",
+  "OBSERVE_TX", "RPD", "RX_ADDR_P0", "RX_ADDR_P1", "RX_ADDR_P2", "RX_ADDR_P3", "RX_ADDR_P4", "RX_ADDR_P5",
+  "TX_ADDR", "RX_PW_P0", "RX_PW_P1", "RX_PW_P2", "RX_PW_P3", "RX_PW_P4", "RX_PW_P5", "FIFO_STATUS",
+  NULL, NULL, NULL, NULL, "DYNPD", "FEATURE"
+};
+
+// Appends to a text that may not fit, keeping count of its whole length like snprintf()
+static void state_printf(char* buf, size_t size, size_t& len, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, format, args);
+  va_end(args);
+  if ( n > 0 ) len += n;
+}
+
+// Bytes of @p reg in a snapshot, addresses at the configured width and MSB first once printed
+static const uint8_t* state_register(const RF24RadioState& state, uint8_t reg, uint8_t& len)
+{
+  len = 1;
+  if ( RF24RegisterImage::slot(reg) >= 0 ) return &state.registers.values[RF24RegisterImage::slot(reg)];
+  if ( reg >= RX_ADDR_P0 && reg <= TX_ADDR ){
+    if ( reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR ){
+      len = RF24Reg::SetupAw::Aw::get(state.registers.get(SETUP_AW)) + 2;
+    }
+    return state.addresses[reg - RX_ADDR_P0];
+  }
+  switch ( reg ){
+    case NRF_STATUS: return &state.status;
+    case OBSERVE_TX: return &state.observe_tx;
+    case RPD: return &state.rpd;
+    case FIFO_STATUS: return &state.fifo_status;
+  }
+  return NULL;
+}
+
+static void state_print_register(char* buf, size_t size, size_t& len, const RF24RadioState& state, uint8_t reg)
+{
+  uint8_t width;
+  const uint8_t* value = state_register(state, reg, width);
+  state_printf(buf, size, len, "0x");
+  while ( width-- ){
+    state_printf(buf, size, len, "%02x", value[width]);
+  }
+}
+
+/****************************************************************************/
+
+const char* RF24RadioState::registerName(uint8_t reg)
+{
+  return reg <= FEATURE ? rf24_register_names[reg] : NULL;
+}
+
+/****************************************************************************/
+
+size_t RF24RadioState::toBinary(uint8_t* buf) const
+{
+  uint8_t* p = buf;
+  *p++ = 'R';
+  *p++ = 'S';
+  *p++ = 2; // Layout version
+  *p++ = p_variant;
+  memcpy(p, registers.values, RF24RegisterImage::count);
+  p += RF24RegisterImage::count;
+  memcpy(p, addresses, sizeof(addresses));
+  p += sizeof(addresses);
+  *p++ = status;
+  *p++ = observe_tx;
+  *p++ = rpd;
+  *p++ = fifo_status;
+  *p++ = payload_size;
+  memcpy(p, pipe0_reading_address, sizeof(pipe0_reading_address));
+  p += sizeof(pipe0_reading_address);
+  *p++ = tx_payload_size;
+  return binary_size;
+}
+
+/****************************************************************************/
+
+bool RF24RadioState::fromBinary(const uint8_t* buf, size_t len)
+{
+  // Version 1 had no tx_payload_size, one byte shorter
+  if ( len < 3 || buf[0] != 'R' || buf[1] != 'S' || buf[2] < 1 || buf[2] > 2 ) return false;
+  const bool v1 = buf[2] == 1;
+  if ( len < binary_size - v1 ) return false;
+
+  const uint8_t* p = buf + 3;
+  p_variant = *p++;
+  memcpy(registers.values, p, RF24RegisterImage::count);
+  p += RF24RegisterImage::count;
+  memcpy(addresses, p, sizeof(addresses));
+  p += sizeof(addresses);
+  status = *p++;
+  observe_tx = *p++;
+  rpd = *p++;
+  fifo_status = *p++;
+  payload_size = *p++;
+  memcpy(pipe0_reading_address, p, sizeof(pipe0_reading_address));
+  p += sizeof(pipe0_reading_address);
+  tx_payload_size = v1 ? payload_size : *p;
+  return true;
+}
+
+/****************************************************************************/
+
+size_t RF24RadioState::toJSON(char* buf, size_t size) const
+{
+  size_t len = 0;
+
+  state_printf(buf, size, len, "{");
+  for ( uint8_t reg = 0; reg <= FEATURE; reg++ ){
+    if ( !rf24_register_names[reg] ) continue;
+    state_printf(buf, size, len, "\"%s\":\"", rf24_register_names[reg]);
+    state_print_register(buf, size, len, *this, reg);
+    state_printf(buf, size, len, "\",");
+  }
+  state_printf(buf, size, len, "\"payload_size\":%u,\"tx_payload_size\":%u,\"pipe0_reading_address\":\"0x", payload_size, tx_payload_size);
+  for ( uint8_t i = RF24Reg::SetupAw::Aw::get(registers.get(SETUP_AW)) + 2; i--; ){
+    state_printf(buf, size, len, "%02x", pipe0_reading_address[i]);
+  }
+  state_printf(buf, size, len, "\",\"p_variant\":%s}", p_variant ? "true" : "false");
+  return len;
+}
+
+/****************************************************************************/
+
+size_t RF24RadioState::format(char* buf, size_t size) const
+{
+  size_t len = 0;
+  uint8_t config = registers.get(NRF_CONFIG);
+  uint8_t setup = registers.get(RF_SETUP);
+
+  state_printf(buf, size, len, "STATUS\t\t = 0x%02x RX_DR=%x TX_DS=%x MAX_RT=%x RX_P_NO=%x TX_FULL=%x\r\n",
+               status,
+               (status & _BV(RX_DR))?1:0,
+               (status & _BV(TX_DS))?1:0,
+               (status & _BV(MAX_RT))?1:0,
+               ((status >> RX_P_NO) & 0x07),
+               (status & _BV(TX_FULL))?1:0);
+
+  static const struct { const char* name; uint8_t reg; uint8_t qty; } lines[] = {
+    { "RX_ADDR_P0-1", RX_ADDR_P0, 2 }, { "RX_ADDR_P2-5", RX_ADDR_P2, 4 }, { "TX_ADDR\t", TX_ADDR, 1 },
+    { "RX_PW_P0-6", RX_PW_P0, 6 }, { "EN_AA\t", EN_AA, 1 }, { "EN_RXADDR", EN_RXADDR, 1 },
+    { "RF_CH\t", RF_CH, 1 }, { "RF_SETUP", RF_SETUP, 1 }, { "CONFIG\t", NRF_CONFIG, 1 },
+    { "DYNPD/FEATURE", DYNPD, 2 }
+  };
+  for ( uint8_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++ ){
+    state_printf(buf, size, len, "%s\t =", lines[i].name);
+    for ( uint8_t reg = lines[i].reg; reg < lines[i].reg + lines[i].qty; reg++ ){
+      state_printf(buf, size, len, " ");
+      state_print_register(buf, size, len, *this, reg);
+    }
+    state_printf(buf, size, len, "\r\n");
+  }
 
-  print_status(get_status());
+  // As getDataRate(), isPVariant(), getCRCLength() and getPALevel()
+  uint8_t dr = setup & ( _BV(RF_DR_LOW) | _BV(RF_DR_HIGH) );
+  rf24_datarate_e rate = dr == _BV(RF_DR_LOW) ? RF24_250KBPS : dr == _BV(RF_DR_HIGH) ? RF24_2MBPS : RF24_1MBPS;
+  rf24_crclength_e crc = !( config & _BV(EN_CRC) ) && !registers.get(EN_AA) ? RF24_CRC_DISABLED
+                       : config & _BV(CRCO) ? RF24_CRC_16 : RF24_CRC_8;
+  state_printf(buf, size, len, "Data Rate\t = %s\r\n", rf24_datarate_e_str_P[rate]);
+  state_printf(buf, size, len, "Model\t\t = %s\r\n", rf24_model_e_str_P[p_variant]);
+  state_printf(buf, size, len, "CRC Length\t = %s\r\n", rf24_crclength_e_str_P[crc]);
+  state_printf(buf, size, len, "PA Power\t = %s\r\n", rf24_pa_dbm_e_str_P[( setup & ( _BV(RF_PWR_LOW) | _BV(RF_PWR_HIGH) ) ) >> 1]);
+  return len;
+}
 
-  print_address_register(PSTR("RX_ADDR_P0-1"),RX_ADDR_P0,2);
-  print_byte_register(PSTR("RX_ADDR_P2-5"),RX_ADDR_P2,4);
-  print_address_register(PSTR("TX_ADDR\t"),TX_ADDR);
+/****************************************************************************/
 
-  print_byte_register(PSTR("RX_PW_P0-6"),RX_PW_P0,6);
-  print_byte_register(PSTR("EN_AA\t"),EN_AA);
-  print_byte_register(PSTR("EN_RXADDR"),EN_RXADDR);
-  print_byte_register(PSTR("RF_CH\t"),RF_CH);
-  print_byte_register(PSTR("RF_SETUP"),RF_SETUP);
-  print_byte_register(PSTR("CONFIG\t"),NRF_CONFIG);
-  print_byte_register(PSTR("DYNPD/FEATURE"),DYNPD,2);
+uint32_t RF24RadioState::diff(const RF24RadioState& other) const
+{
+  uint32_t changed = 0;
 
-  printf_P(PSTR("Data Rate\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_datarate_e_str_P[getDataRate()]));
-  printf_P(PSTR("Model\t\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_model_e_str_P[isPVariant()]));
-  printf_P(PSTR("CRC Length\t = " PRIPSTR "\r\n"),pgm_read_ptr(&rf24_crclength_e_str_P[getCRCLength()]));
-  printf_P(PSTR("PA Power\t = " PRIPSTR "\r\n"),  pgm_read_ptr(&rf24_pa_dbm_e_str_P[getPALevel()]));
+  for ( uint8_t reg = 0; reg <= FEATURE; reg++ ){
+    uint8_t len, other_len;
+    const uint8_t* a = state_register(*this, reg, len);
+    const uint8_t* b = state_register(other, reg, other_len);
+    if ( a && ( len != other_len || memcmp(a, b, len) ) ) changed |= 1UL << reg;
+  }
+  if ( payload_size != other.payload_size || tx_payload_size != other.tx_payload_size || p_variant != other.p_variant
+       || memcmp(pipe0_reading_address, other.pipe0_reading_address, sizeof(pipe0_reading_address)) ){
+    changed |= driver_bit;
+  }
+  return changed;
+}
+
+/****************************************************************************/
 
+size_t RF24RadioState::formatDiff(const RF24RadioState& other, char* buf, size_t size) const
+{
+  uint32_t changed = diff(other);
+  size_t len = 0;
+
+  if ( size ) buf[0] = 0;
+  for ( uint8_t reg = 0; reg <= FEATURE; reg++ ){
+    if ( !( changed & ( 1UL << reg ) ) ) continue;
+    state_printf(buf, size, len, "%s%s ", len ? ", " : "", rf24_register_names[reg]);
+    state_print_register(buf, size, len, *this, reg);
+    state_printf(buf, size, len, " -> ");
+    state_print_register(buf, size, len, other, reg);
+  }
+  if ( changed & driver_bit ){
+    state_printf(buf, size, len, "%spayload_size %u -> %u", len ? ", " : "", payload_size, other.payload_size);
+    if ( tx_payload_size != other.tx_payload_size ){
+      state_printf(buf, size, len, ", tx_payload_size %u -> %u", tx_payload_size, other.tx_payload_size);
+    }
+  }
+  return len;
 }
 
+#endif
+/****************************************************************************/
 #endif
 /****************************************************************************/
 
@@ -591,6 +1532,10 @@ bool RF24::begin(void)
 
   uint8_t setup=0;
 
+  #if !defined (MINIMAL)
+  reg_cache_valid = 0; // The chip may have been reset, trust nothing cached so far
+  #endif
+
   #if defined (RF24_LINUX)
 
 	#if defined (MRAA)
@@ -710,6 +1655,12 @@ bool RF24::begin(void)
   // PTX should use only 22uA of power
   write_register(NRF_CONFIG, ( read_register(NRF_CONFIG) ) & ~_BV(PRIM_RX) );
 
+  #if !defined (MINIMAL)
+  if ( reg_cache_enabled ){
+    cache_fill();
+  }
+  #endif
+
   // if setup is 0 or ff then there was no response from module
   return ( setup != 0 && setup != 0xff );
 }
@@ -718,6 +1669,9 @@ bool RF24::begin(void)
 
 bool RF24::isChipConnected()
 {
+  #if !defined (MINIMAL)
+  cache_drop(SETUP_AW); // Ask the chip, not the cache
+  #endif
   uint8_t setup = read_register(SETUP_AW);
   if(setup >= 1 && setup <= 3)
   {
@@ -824,53 +1778,168 @@ void RF24::errNotify(){
 	delay(5000);
 	#endif
 }
+
+/******************************************************************/
+
+void RF24::tx_timeout(){
+	tx_result = RF24_TX_TIMEOUT;
+	#if defined (RF24_TX_POLICY)
+	if(timeout_policy.notify){
+		errNotify();
+	}
+	#if defined (FAILURE_HANDLING)
+	else{
+		failureDetected = 1;
+	}
+	#endif
+	#else
+	errNotify();
+	#endif
+}
+
+/******************************************************************/
+
+uint32_t RF24::getTxDeadline(uint8_t payloads)
+{
+	#if !defined (RF24_TX_POLICY)
+	return 95000;
+	#else
+	if(timeout_policy.fixed_us){
+		return timeout_policy.fixed_us;
+	}
+	// The longest payload on the longest addresses, retried until MAX_RT
+	RF24Airtime link((rf24_datarate_e) tx_rate, 5, RF24_CRC_16, 32, tx_retries >> ARD, tx_retries & 0x0F);
+	return payloads * link.giveUpUs() + timeout_policy.margin_us;
+	#endif
+}
+#endif
+
+/******************************************************************/
+
+bool RF24::tx_end(uint8_t result, bool loaded){
+	#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+	tx_result = result;
+	#endif
+	#if defined (RF24_LINUX)
+	tx_stats.spi += spi_accesses - tx_spi_start;
+	tx_stats.payloads += loaded;
+	tx_stats.failed += result != RF24_TX_OK;
+	#endif
+	return result == RF24_TX_OK;
+}
+
+/******************************************************************/
+
+#if defined (RF24_LINUX)
+void RF24::tx_begin(){
+	tx_spi_start = spi_accesses;
+}
+
+/******************************************************************/
+
+void RF24::tx_pause(uint8_t look){
+	tx_stats.waits++;
+	if(tx_wait == RF24_WAIT_SPIN){
+		return;
+	}
+	// Nothing can happen before the payload is acked at best, counted with
+	// the shortest CRC so the first look is never late. Then every look
+	// waits twice as long, from an eighth of the packet up to the time a
+	// retransmission takes.
+	RF24Airtime air((rf24_datarate_e) tx_rate, addr_width, RF24_CRC_8, tx_len, tx_retries >> ARD, tx_retries & 0x0F, tx_ack);
+	uint32_t us = air.deliveryUs();
+	if(look){
+		us = rf24_min( ( air.packetUs() >> 3 ) << rf24_min( look - 1, 8 ), air.attemptUs() );
+	}
+	#if defined (RF24_IRQ_WAIT)
+	if(tx_wait == RF24_WAIT_IRQ && irq_pin >= 0){
+		// The line only falls again once the TX_DS of an earlier payload
+		// is cleared, only the FIFO tells the writes apart here
+		if(last_status & _BV(TX_DS)){
+			write_register(NRF_STATUS,_BV(TX_DS));
+			tx_ds_cleared = true;
+		}
+		if(waitForInterrupt(irq_pin, us / 1000 + 1) >= 0){
+			return;
+		}
+	}
+	#endif
+	delayMicroseconds(us);
+}
+
+/******************************************************************/
+
+void RF24::resetTxStats(){
+	memset(&tx_stats, 0, sizeof(tx_stats));
+}
 #endif
+
 /******************************************************************/
 
 //Similar to the previous write, clears the interrupt flags
 bool RF24::write( const void* buf, uint8_t len, const bool multicast )
 {
+	tx_begin();
 	//Start Writing
 	startFastWrite(buf,len,multicast);
 
+	return tx_complete();
+}
+
+bool RF24::write( const void* buf, uint8_t len ){
+	return write(buf,len,0);
+}
+
+/****************************************************************************/
+
+bool RF24::tx_complete()
+{
 	//Wait until complete or failed
 	#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-		uint32_t timer = millis();
+		uint32_t timer = micros();
+		uint32_t deadline = getTxDeadline();
+		uint32_t look = timer; // Taken before the status is read, so a late look still gives the chip the whole deadline
 	#endif 
 	
-  //DDMDSDD
-	// printf("Status is %d \n", get_status());
-	while( ! ( get_status()  & ( _BV(TX_DS) | _BV(MAX_RT) ))) {
-  // while(( get_status()  & ( _BV(TX_DS) | _BV(MAX_RT) ))) { 
+	uint8_t status;
+	uint8_t looks = 0;
+	while( ! ( ( status = get_status() )  & ( _BV(TX_DS) | _BV(MAX_RT) ))) {
     #if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-			if(millis() - timer > 95){			
-				errNotify();
+			if(look - timer > deadline){
+				tx_timeout();
 				#if defined (FAILURE_HANDLING)
-          printf("%d - Err in RF24::write!\n", get_status());
-				  return 0;		
+				  return tx_end(RF24_TX_TIMEOUT, true);
 				#else
 				  delay(100);
 				#endif
 			}
 		#endif
+		tx_pause(looks++);
+		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+			look = micros();
+		#endif
 	}
     
 	ce(LOW);
 
-	uint8_t status = write_register(NRF_STATUS,_BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT) );
+  #if defined (RF24_SPI_BATCH)
+	// Clear the flags and, on failure, flush the TX FIFO with a single syscall
+	status = clear_status( status & _BV(MAX_RT) );
+  #else
+	status = write_register(NRF_STATUS,_BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT) );
+  #endif
 
   //Max retries exceeded
   if( status & _BV(MAX_RT)){
+  #if !defined (RF24_SPI_BATCH)
   	flush_tx(); //Only going to be 1 packet int the FIFO at a time using this method, so just flush
-  	return 0;
+  #endif
+  	return tx_end(RF24_TX_MAX_RT, true);
   }
 	//TX OK 1 or 0
-  return 1;
+  return tx_end(RF24_TX_OK, true);
 }
 
-bool RF24::write( const void* buf, uint8_t len ){
-	return write(buf,len,0);
-}
 /****************************************************************************/
 
 //For general use, the interrupt flags are not important to clear
@@ -882,29 +1951,46 @@ bool RF24::writeBlocking( const void* buf, uint8_t len, uint32_t timeout )
 	//The radio will auto-clear everything in the FIFO as long as CE remains high
 
 	uint32_t timer = millis();							  //Get the time that the payload transmission started
+	#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+	// Past the user-defined timeout, the payload at the head must complete in
+	// time. Counted apart, in ms then in us, timeout * 1000 would overflow.
+	uint32_t deadline = getTxDeadline();
+	bool late = false;
+	uint32_t start = 0;
+	uint32_t look = micros();
+	#endif
+	uint8_t looks = 0;
+	tx_begin();
 
 	while( ( get_status()  & ( _BV(TX_FULL) ))) {		  //Blocking only if FIFO is full. This will loop and block until TX is successful or timeout
 
-		if( get_status() & _BV(MAX_RT)){					  //If MAX Retries have been reached
+		if( last_status & _BV(MAX_RT)){					  //If MAX Retries have been reached
 			reUseTX();										  //Set re-transmit and clear the MAX_RT interrupt flag
-			if(millis() - timer > timeout){ return 0; }		  //If this payload has exceeded the user-defined timeout, exit and return 0
+			if(millis() - timer > timeout){ return tx_end(RF24_TX_MAX_RT, false); } //If this payload has exceeded the user-defined timeout, exit and return 0
+			looks = 0;
 		}
 		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-			if(millis() - timer > (timeout+95) ){			
-        printf("err in RF24::writeBlocking!");
-				errNotify();
+			if(!late){
+				late = millis() - timer > timeout;
+				start = look;
+			}else if(look - start > deadline){
+				tx_timeout();
 				#if defined (FAILURE_HANDLING)
-				return 0;			
+				return tx_end(RF24_TX_TIMEOUT, false);
                 #endif				
 			}
 		#endif
+		tx_pause(looks++);
+		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+			look = micros();
+		#endif
 
   	}
 
   	//Start Writing
 	startFastWrite(buf,len,0);								  //Write the payload if a buffer is clear
 
-	return 1;												  //Return 1 to indicate successful transmission
+	return tx_end(RF24_TX_OK, true);						  //Return 1 to indicate successful transmission
 }
 
 /****************************************************************************/
@@ -925,36 +2011,53 @@ bool RF24::writeFast( const void* buf, uint8_t len, const bool multicast )
 	//Return 0 so the user can control the retrys and set a timer or failure counter if required
 	//The radio will auto-clear everything in the FIFO as long as CE remains high
 
+	tx_begin();
+	if(!tx_room()){
+		return false;
+	}
+		     //Start Writing
+	startFastWrite(buf,len,multicast);
+
+	return tx_end(RF24_TX_OK, true);
+}
+
+bool RF24::writeFast( const void* buf, uint8_t len ){
+	return writeFast(buf,len,0);
+}
+
+/****************************************************************************/
+
+bool RF24::tx_room()
+{
 	#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-		uint32_t timer = millis();
+		uint32_t timer = micros();
+		uint32_t deadline = getTxDeadline(); // The payload at the head of the FIFO completes by then
+		uint32_t look = timer;
 	#endif
-	
+	uint8_t looks = 0;
+
 	while( ( get_status()  & ( _BV(TX_FULL) ))) {			  //Blocking only if FIFO is full. This will loop and block until TX is successful or fail
 
-		if( get_status() & _BV(MAX_RT)){
+		if( last_status & _BV(MAX_RT)){
 			//reUseTX();										  //Set re-transmit
 			write_register(NRF_STATUS,_BV(MAX_RT) );			  //Clear max retry flag
-			return 0;										  //Return 0. The previous payload has been retransmitted
+			return tx_end(RF24_TX_MAX_RT, false);			  //Return 0. The previous payload has been retransmitted
 															  //From the user perspective, if you get a 0, just keep trying to send the same payload
 		}
 		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-			if(millis() - timer > 95 ){			
-        printf("err in RF24::writeFast");
-				errNotify();
+			if(look - timer > deadline){
+				tx_timeout();
 				#if defined (FAILURE_HANDLING)
-				return 0;							
+				return tx_end(RF24_TX_TIMEOUT, false);
 				#endif
 			}
 		#endif
+		tx_pause(looks++);
+		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+			look = micros();
+		#endif
   	}
-		     //Start Writing
-	startFastWrite(buf,len,multicast);
-
-	return 1;
-}
-
-bool RF24::writeFast( const void* buf, uint8_t len ){
-	return writeFast(buf,len,0);
+	return true;
 }
 
 /****************************************************************************/
@@ -1003,28 +2106,35 @@ bool RF24::rxFifoFull(){
 bool RF24::txStandBy(){
 
     #if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-		uint32_t timeout = millis();
+		uint32_t timeout = micros();
+		uint32_t deadline = getTxDeadline(3); // A full FIFO
+		uint32_t look = timeout;
 	#endif
+	uint8_t looks = 0;
+	tx_begin();
 	while( ! (read_register(FIFO_STATUS) & _BV(TX_EMPTY)) ){
-		if( get_status() & _BV(MAX_RT)){
+		if( last_status & _BV(MAX_RT)){ // STATUS came with FIFO_STATUS
 			write_register(NRF_STATUS,_BV(MAX_RT) );
 			ce(LOW);
 			flush_tx();    //Non blocking, flush the data
-			return 0;
+			return tx_end(RF24_TX_MAX_RT, false);
 		}
 		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-			if( millis() - timeout > 95){
-        printf("err in RF24::txStandBy");
-				errNotify();
+			if( look - timeout > deadline){
+				tx_timeout();
 				#if defined (FAILURE_HANDLING)
-				return 0;	
+				return tx_end(RF24_TX_TIMEOUT, false);
 				#endif
 			}
 		#endif
+		tx_pause(looks++);
+		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+			look = micros();
+		#endif
 	}
 
 	ce(LOW);			   //Set STANDBY-I mode
-	return 1;
+	return tx_end(RF24_TX_OK, false);
 }
 
 /****************************************************************************/
@@ -1036,30 +2146,47 @@ bool RF24::txStandBy(uint32_t timeout, bool startTx){
 	  ce(HIGH);
 	}
 	uint32_t start = millis();
+	#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+	// Past the user-defined timeout, a full FIFO must complete in time, see
+	// writeBlocking()
+	uint32_t deadline = getTxDeadline(3);
+	bool late = false;
+	uint32_t timer = 0;
+	uint32_t look = micros();
+	#endif
+	uint8_t looks = 0;
+	tx_begin();
 
 	while( ! (read_register(FIFO_STATUS) & _BV(TX_EMPTY)) ){
-		if( get_status() & _BV(MAX_RT)){
+		if( last_status & _BV(MAX_RT)){ // STATUS came with FIFO_STATUS
 			write_register(NRF_STATUS,_BV(MAX_RT) );
 				ce(LOW);										  //Set re-transmit
 				ce(HIGH);
 				if(millis() - start >= timeout){
-					ce(LOW); flush_tx(); return 0;
+					ce(LOW); flush_tx(); return tx_end(RF24_TX_MAX_RT, false);
 				}
+				looks = 0;
 		}
 		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
-			if( millis() - start > (timeout+95)){
-        printf("err in RF24::txStandBy");
-				errNotify();
+			if(!late){
+				late = millis() - start >= timeout;
+				timer = look;
+			}else if( look - timer > deadline){
+				tx_timeout();
 				#if defined (FAILURE_HANDLING)
-				return 0;	
+				return tx_end(RF24_TX_TIMEOUT, false);
 				#endif
 			}
 		#endif
+		tx_pause(looks++);
+		#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+			look = micros();
+		#endif
 	}
 
 	
 	ce(LOW);				   //Set STANDBY-I mode
-	return 1;
+	return tx_end(RF24_TX_OK, false);
 
 }
 
@@ -1086,11 +2213,12 @@ uint8_t RF24::getDynamicPayloadSize(void)
   spi_txbuff[1] = 0xff;
   beginTransaction();
   _SPI.transfernb( (char *) spi_txbuff, (char *) spi_rxbuff, 2);
+  last_status = spi_rxbuff[0];
   result = spi_rxbuff[1];  
   endTransaction();
   #else
   beginTransaction();
-  _SPI.transfer( R_RX_PL_WID );
+  last_status = _SPI.transfer( R_RX_PL_WID );
   result = _SPI.transfer(0xff);
   endTransaction();
   #endif
@@ -1110,33 +2238,217 @@ bool RF24::available(void)
 
 bool RF24::available(uint8_t* pipe_num)
 {
-  if (!( read_register(FIFO_STATUS) & _BV(RX_EMPTY) )){
-
-    // If the caller wants the pipe number, include that
-    if ( pipe_num ){
-	  uint8_t status = get_status();
-      *pipe_num = ( status >> RX_P_NO ) & 0x07;
-  	}
-  	return 1;
+  // RX_P_NO of STATUS reads 7 while the RX FIFO is empty, so a single
+  // NOP tells both whether a payload is waiting and on which pipe
+  uint8_t pipe = ( get_status() >> RX_P_NO ) & 0x07;
+  if ( pipe > 5 ){
+    return 0;
   }
 
-
-  return 0;
-
-
+  // If the caller wants the pipe number, include that
+  if ( pipe_num ){
+    *pipe_num = pipe;
+  }
+  return 1;
 }
 
 /****************************************************************************/
 
 void RF24::read( void* buf, uint8_t len ){
 
+  #if defined (RF24_SPI_BATCH)
+  // Fetch the payload and clear the interrupt flags with a single syscall
+  read_payload( buf, len, true );
+  #else
   // Fetch the payload
   read_payload( buf, len );
 
   //Clear the two possible interrupt flags with one command
   write_register(NRF_STATUS,_BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS) );
+  #endif
+
+}
+
+/****************************************************************************/
+
+size_t RF24::readBurst(RF24Frame* out, size_t max)
+{
+  // Static payloads are read at the widest pipe width, each frame keeps its own
+  uint8_t widest = payload_size;
+  for ( uint8_t pipe = 0; pipe < 6; pipe++ ){
+    widest = rf24_max(widest, pipe_payload_size[pipe]);
+  }
+  return read_burst(out, max, widest, dynamic_payloads_enabled);
+}
+
+/****************************************************************************/
+
+size_t RF24::read_burst(RF24Frame* out, size_t max, uint8_t width, bool dynamic)
+{
+  size_t count = 0;
+  uint32_t now = millis();
+
+  #if defined (RF24_SPI_BATCH)
+
+  // Queue a read for every entry the FIFO may hold plus the RX_DR clear,
+  // then keep the reads whose STATUS byte shows a pipe (7 = FIFO empty).
+  // A payload may arrive after a read found the FIFO empty and be popped by
+  // the next one, so an empty slot doesn't end the burst: the RX_DR clear
+  // at the end would hide that payload for good.
+  const uint8_t reads = rf24_min(max, 3);
+  const uint8_t size = 1 + ( dynamic ? 32 : width );
+  uint8_t tx[3 * (2 + 33) + 2];
+  uint8_t rx[sizeof(tx)];
+  uint8_t pos = 0;
+
+  #if defined (RF24_SPI_SEGMENTS)
+  memset(tx, RF24_NOP, 3 * 3 + 2); // Commands only, the payloads bypass tx and rx
+  #else
+  memset(tx, RF24_NOP, sizeof(tx));
+  #endif
+  beginTransaction();
+  _SPI.beginBatch();
+  for ( uint8_t i = 0; i < reads; i++ ){
+    if ( dynamic ){
+      tx[pos] = R_RX_PL_WID;
+      _SPI.batch( (char *) tx + pos, (char *) rx + pos, 2);
+      pos += 2;
+    }
+    tx[pos] = R_RX_PAYLOAD;
+    #if defined (RF24_SPI_SEGMENTS)
+    // The payload goes straight into its frame, only STATUS into rx
+    SPISegment segs[2] = { { tx + pos, rx + pos, 1 }, { NULL, out[i].data, (uint32_t)( size - 1 ) } };
+    _SPI.batchSegments(segs, 2);
+    pos += 1;
+    #else
+    _SPI.batch( (char *) tx + pos, (char *) rx + pos, size);
+    pos += size;
+    #endif
+  }
+  tx[pos] = W_REGISTER | ( REGISTER_MASK & NRF_STATUS );
+  tx[pos + 1] = _BV(RX_DR);
+  _SPI.batch( (char *) tx + pos, (char *) rx + pos, 2);
+  _SPI.endBatch();
+  endTransaction();
+
+  last_status = rx[pos] & ~_BV(RX_DR);
+
+  uint8_t* prx = rx;
+  for ( uint8_t i = 0; i < reads; i++ ){
+    uint8_t pipe = ( prx[0] >> RX_P_NO ) & 0x07;
+    uint8_t length = pipe < 6 ? pipe_payload_size[pipe] : payload_size;
+    if ( dynamic ){
+      // The width read may have found the FIFO empty just before a payload
+      // arrived for the payload read to pop: the pipe is the payload read's,
+      // and a payload without a width is kept whole
+      length = pipe < 6 ? prx[1] : 32;
+      prx += 2;
+      pipe = ( prx[0] >> RX_P_NO ) & 0x07;
+    }
+    #if defined (RF24_SPI_SEGMENTS)
+    prx += 1;
+    #else
+    const uint8_t* payload = prx + 1;
+    prx += size;
+    #endif
+    if ( pipe > 5 ) continue;
+    if ( length > 32 ){ flush_rx(); break; } // Corrupt, see getDynamicPayloadSize()
+
+    RF24Frame& frame = out[count++];
+    frame.pipe = pipe;
+    frame.length = length;
+    frame.timestamp = now;
+    #if defined (RF24_SPI_SEGMENTS)
+    // Read into the frame of its slot, behind an empty one it moves down
+    if ( &frame != &out[i] ){
+      memcpy(frame.data, out[i].data, length);
+    }
+    #else
+    memcpy(frame.data, payload, length);
+    #endif
+  }
 
+  #else
+
+  while ( count < max ){
+    uint8_t length = 0;
+    if ( dynamic ){
+      length = getDynamicPayloadSize(); // Its STATUS byte carries the pipe as well
+    }else{
+      get_status();
+    }
+    uint8_t pipe = ( last_status >> RX_P_NO ) & 0x07;
+    if ( pipe > 5 ) break;
+    if ( !dynamic ){
+      length = pipe_payload_size[pipe];
+    }
+    if ( length == 0 ) break;
+
+    RF24Frame& frame = out[count++];
+    frame.pipe = pipe;
+    frame.length = length;
+    frame.timestamp = now;
+    read_payload(frame.data, length);
+  }
+
+  if ( count ){
+    write_register(NRF_STATUS, _BV(RX_DR));
+  }
+
+  #endif
+
+  return count;
+}
+
+/****************************************************************************/
+
+#if defined (RF24_IRQ_WAIT)
+bool RF24::attachIrq(uint16_t pin)
+{
+  if ( setupInterrupt(pin, INT_EDGE_FALLING) != 0 ){
+    irq_pin = -1;
+    return false;
+  }
+  irq_pin = pin;
+  return true;
+}
+
+/****************************************************************************/
+
+uint8_t RF24::waitForEvent(int timeout)
+{
+  const uint8_t events = _BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT);
+  uint32_t start = millis();
+  uint8_t status;
+
+  // The IRQ only falls on a new event, so look at STATUS before sleeping.
+  // An edge between this read and the wait stays latched on the GPIO.
+  while ( !( (status = get_status()) & events ) && ( ( status >> RX_P_NO ) & 0x07 ) > 5 ){
+    int left = -1;
+    if ( timeout >= 0 ){
+      uint32_t elapsed = millis() - start;
+      if ( elapsed >= (uint32_t) timeout ){
+        return 0;
+      }
+      left = timeout - elapsed;
+    }
+    if ( irq_pin < 0 ){
+      delayMicroseconds(100);
+    }else if ( waitForInterrupt(irq_pin, left) < 0 ){
+      return 0;
+    }
+  }
+
+  uint8_t fired = status & events;
+  if ( fired ){
+    write_register(NRF_STATUS, fired);
+  }
+  if ( ( ( status >> RX_P_NO ) & 0x07 ) <= 5 ){
+    fired |= _BV(RX_DR);
+  }
+  return fired;
 }
+#endif
 
 /****************************************************************************/
 
@@ -1148,12 +2460,46 @@ void RF24::whatHappened(bool& tx_ok,bool& tx_fail,bool& rx_ready)
 
   // Report to the user what happened
   tx_ok = status & _BV(TX_DS);
+  #if defined (RF24_IRQ_WAIT)
+  tx_ok = tx_ok || tx_ds_cleared;
+  tx_ds_cleared = false;
+  #endif
   tx_fail = status & _BV(MAX_RT);
   rx_ready = status & _BV(RX_DR);
 }
 
 /****************************************************************************/
 
+uint8_t RF24::lastStatus(void) const
+{
+  return last_status;
+}
+
+/****************************************************************************/
+
+uint8_t RF24::lastPipe(void) const
+{
+  return ( last_status >> RX_P_NO ) & 0x07;
+}
+
+/****************************************************************************/
+
+bool RF24::lastTxFull(void) const
+{
+  return last_status & _BV(TX_FULL);
+}
+
+/****************************************************************************/
+
+void RF24::lastFlags(bool& tx_ok,bool& tx_fail,bool& rx_ready) const
+{
+  tx_ok = last_status & _BV(TX_DS);
+  tx_fail = last_status & _BV(MAX_RT);
+  rx_ready = last_status & _BV(RX_DR);
+}
+
+/****************************************************************************/
+
 void RF24::openWritingPipe(uint64_t value)
 {
   // Note that AVR 8-bit uC's store this LSB first, and the NRF24L01(+)
@@ -1165,7 +2511,15 @@ void RF24::openWritingPipe(uint64_t value)
   
   //const uint8_t max_payload_size = 32;
   //write_register(RX_PW_P0,rf24_min(payload_size,max_payload_size));
-  write_register(RX_PW_P0,payload_size);
+  write_register(RX_PW_P0,pipe_payload_size[0]);
+  tx_payload_size = payload_size;
+}
+
+/****************************************************************************/
+void RF24::openWritingPipe(uint64_t value, uint8_t size)
+{
+  openWritingPipe(value);
+  tx_payload_size = rf24_min(size,32);
 }
 
 /****************************************************************************/
@@ -1179,7 +2533,15 @@ void RF24::openWritingPipe(const uint8_t *address)
 
   //const uint8_t max_payload_size = 32;
   //write_register(RX_PW_P0,rf24_min(payload_size,max_payload_size));
-  write_register(RX_PW_P0,payload_size);
+  write_register(RX_PW_P0,pipe_payload_size[0]);
+  tx_payload_size = payload_size;
+}
+
+/****************************************************************************/
+void RF24::openWritingPipe(const uint8_t *address, uint8_t size)
+{
+  openWritingPipe(address);
+  tx_payload_size = rf24_min(size,32);
 }
 
 /****************************************************************************/
@@ -1210,7 +2572,7 @@ void RF24::openReadingPipe(uint8_t child, uint64_t address)
     else
       write_register(pgm_read_byte(&child_pipe[child]), reinterpret_cast<const uint8_t*>(&address), 1);
 
-    write_register(pgm_read_byte(&child_payload_size[child]),payload_size);
+    write_register(pgm_read_byte(&child_payload_size[child]),pipe_payload_size[child]);
 
     // Note it would be more efficient to set all of the bits for all open
     // pipes at once.  However, I thought it would make the calling code
@@ -1250,7 +2612,7 @@ void RF24::openReadingPipe(uint8_t child, const uint8_t *address)
     }else{
       write_register(pgm_read_byte(&child_pipe[child]), address, 1);
 	}
-    write_register(pgm_read_byte(&child_payload_size[child]),payload_size);
+    write_register(pgm_read_byte(&child_payload_size[child]),pipe_payload_size[child]);
 
     // Note it would be more efficient to set all of the bits for all open
     // pipes at once.  However, I thought it would make the calling code
@@ -1371,10 +2733,11 @@ void RF24::writeAckPayload(uint8_t pipe, const void* buf, uint8_t len)
     }
 	
     _SPI.transfern( (char *) spi_txbuff, size);
+    last_status = spi_txbuff[0];
 	endTransaction();
   #else
   beginTransaction();
-  _SPI.transfer(W_ACK_PAYLOAD | ( pipe & 0x07 ) );
+  last_status = _SPI.transfer(W_ACK_PAYLOAD | ( pipe & 0x07 ) );
 
   while ( data_len-- )
     _SPI.transfer(*current++);
@@ -1507,8 +2870,14 @@ bool RF24::setDataRate(rf24_datarate_e speed)
     }
   }
   write_register(RF_SETUP,setup);
+  #if defined (RF24_TX_POLICY)
+  tx_rate = speed;
+  #endif
 
   // Verify our result
+  #if !defined (MINIMAL)
+  cache_drop(RF_SETUP); // Ask the chip, not the cache
+  #endif
   if ( read_register(RF_SETUP) == setup )
   {
     result = true;
@@ -1597,7 +2966,11 @@ void RF24::disableCRC( void )
 /****************************************************************************/
 void RF24::setRetries(uint8_t delay, uint8_t count)
 {
- write_register(SETUP_RETR,(delay&0xf)<<ARD | (count&0xf)<<ARC);
+ uint8_t retries = (delay&0xf)<<ARD | (count&0xf)<<ARC;
+ #if defined (RF24_TX_POLICY)
+ tx_retries = retries;
+ #endif
+ write_register(SETUP_RETR,retries);
 }
 
 
@@ -44,12 +44,69 @@ typedef enum { RF24_1MBPS = 0, RF24_2MBPS, RF24_250KBPS } rf24_datarate_e;
  */
 typedef enum { RF24_CRC_DISABLED = 0, RF24_CRC_8, RF24_CRC_16 } rf24_crclength_e;
 
+/**
+ * Outcome of a write.
+ *
+ * For use with getWriteResult()
+ */
+typedef enum { RF24_TX_OK = 0, RF24_TX_MAX_RT, RF24_TX_TIMEOUT } rf24_tx_result_e;
+
+/**
+ * How the write paths wait for the chip between two looks at it.
+ *
+ * For use with setTxWait()
+ */
+typedef enum { RF24_WAIT_SPIN = 0, RF24_WAIT_BACKOFF, RF24_WAIT_IRQ } rf24_tx_wait_e;
+
+/**
+ * How long the write paths wait for the chip, see RF24::setTimeoutPolicy()
+ */
+struct RF24TimeoutPolicy
+{
+  uint32_t margin_us; /**< Added to the time the link needs, covers SPI and scheduling latency. Default: 1000 */
+  uint32_t fixed_us; /**< If not 0, the deadline of every wait whatever the link, 95000 waits like older releases. Default: 0 */
+  bool notify; /**< Call errNotify(), which prints, on a timeout. Default: true */
+};
+
+/**
+ * What the write paths spent on the SPI bus, see RF24::getTxStats()
+ */
+struct RF24TxStats
+{
+  uint32_t payloads; /**< Payloads loaded by write(), writeFast() and writeBlocking() */
+  uint32_t failed; /**< Writes that ended in MAX_RT or a timeout */
+  uint32_t spi; /**< SPI accesses made by the write paths and txStandBy(), a batch counting once */
+  uint32_t waits; /**< Looks at the chip that found the payload still on air */
+};
+
+/**
+ * One received payload, as returned by readBurst()
+ */
+struct RF24Frame
+{
+  uint8_t pipe; /**< Pipe the payload arrived on */
+  uint8_t length; /**< Number of valid bytes in data: the dynamic payload length or the fixed payload size */
+  uint32_t timestamp; /**< millis() when the payload was read from the radio */
+  uint8_t data[32]; /**< Payload */
+};
+
 /**
  * Driver for nRF24L01(+) 2.4GHz Wireless Transceiver
  */
 
+#if defined (RF24_LINUX)
+struct RF24RegisterImage;
+struct RF24RadioProfile;
+struct RF24RadioState;
+#endif
+
 class RF24
 {
+#if defined (RF24_LINUX)
+  friend class RF24TxQueue;
+  friend class RF24Handle;
+  template <class Profile> friend class RF24Static;
+#endif
 private:
 #ifdef SOFTSPI
   SoftSPI<SOFT_SPI_MISO_PIN, SOFT_SPI_MOSI_PIN, SOFT_SPI_SCK_PIN, SPI_MODE> spi;
@@ -68,14 +125,43 @@ private:
   uint16_t csn_pin; /**< SPI Chip select */
   uint16_t spi_speed; /**< SPI Bus Speed */
 #if defined (RF24_LINUX) || defined (XMEGA_D3)
-  uint8_t spi_rxbuff[32+1] ; //SPI receive buffer (payload max 32 bytes)
-  uint8_t spi_txbuff[32+1] ; //SPI transmit buffer (payload max 32 bytes + 1 byte for the command)
+  uint8_t spi_rxbuff[32+1+2] ; //SPI receive buffer (payload max 32 bytes + 2 bytes of a command batched after it)
+  uint8_t spi_txbuff[32+1+2] ; //SPI transmit buffer (payload max 32 bytes + 1 byte for the command + 2 bytes batched after it)
 #endif  
   bool p_variant; /* False for RF24L01 and true for RF24L01P */
   uint8_t payload_size; /**< Fixed size of payloads */
+  uint8_t pipe_payload_size[6]; /**< Fixed size of payloads received on each pipe */
+  uint8_t tx_payload_size; /**< Fixed size of payloads sent to the writing pipe */
   bool dynamic_payloads_enabled; /**< Whether dynamic payloads are enabled. */
   uint8_t pipe0_reading_address[5]; /**< Last address set on pipe 0 for reading. */
   uint8_t addr_width; /**< The address width to use - 3,4 or 5 bytes. */
+  uint8_t last_status; /**< STATUS clocked out by the most recent SPI transaction. */
+#if defined (RF24_TX_POLICY)
+  RF24TimeoutPolicy timeout_policy; /**< See setTimeoutPolicy() */
+  uint8_t tx_retries; /**< SETUP_RETR as last set, for the deadlines of the write paths */
+  uint8_t tx_rate; /**< rf24_datarate_e as last set, for the deadlines of the write paths */
+#endif
+#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+  uint8_t tx_result; /**< rf24_tx_result_e of the last write */
+#endif
+#if defined (RF24_LINUX)
+  uint8_t tx_wait; /**< rf24_tx_wait_e, see setTxWait() */
+  uint8_t tx_len; /**< Length on air of the last payload loaded, sizes the waits */
+  bool tx_ack; /**< Whether the last payload loaded asks for an ack */
+  uint32_t spi_accesses; /**< Chip selects since construction */
+  uint32_t tx_spi_start; /**< spi_accesses when the running write path started */
+  RF24TxStats tx_stats; /**< See getTxStats() */
+#endif
+#if defined (RF24_IRQ_WAIT)
+  int irq_pin; /**< IRQ pin armed by attachIrq(), -1 if none */
+  bool tx_ds_cleared; /**< TX_DS cleared by tx_pause(), still to be reported by whatHappened() */
+#endif
+#if !defined (MINIMAL)
+  bool reg_cache_enabled; /**< Whether the register cache is in use. */
+  uint32_t reg_cache_valid; /**< One bit per cache slot holding the chip's value. */
+  uint8_t reg_cache[15]; /**< NRF_CONFIG to RF_SETUP, RX_PW_P0 to RX_PW_P5, DYNPD, FEATURE. */
+  uint8_t addr_cache[7][5]; /**< RX_ADDR_P0 to RX_ADDR_P5 and TX_ADDR. */
+#endif
   
 
 protected:
@@ -85,9 +171,15 @@ protected:
    * Common code for SPI transactions including CSN toggle
    *
    */
+#if defined (RF24_LINUX)
+  void beginTransaction(); // Called by RF24Static too
+
+  void endTransaction();
+#else
   inline void beginTransaction();
 
   inline void endTransaction();
+#endif
 
 public:
 
@@ -256,6 +348,20 @@ s   *
 
   void openWritingPipe(const uint8_t *address);
 
+  /**
+   * Open a pipe for writing, with its own static payload size
+   *
+   * Payloads sent to @p address are padded to @p size rather than to
+   * getPayloadSize(), which saves airtime when the receiving pipe was set
+   * to a smaller width with setPayloadSize(uint8_t, uint8_t). Both ends
+   * must agree on the width. Opening the writing pipe again without a size
+   * goes back to getPayloadSize().
+   *
+   * @param address The address of the pipe to open
+   * @param size The number of bytes in the payloads sent, up to 32
+   */
+  void openWritingPipe(const uint8_t *address, uint8_t size);
+
   /**
    * Open a pipe for reading
    *
@@ -328,6 +434,71 @@ s   *
    */
   bool available(uint8_t* pipe_num);
 
+  /**
+   * Read every payload waiting in the RX FIFO (up to three)
+   *
+   * Each frame records its pipe, length and the time it was read. RX_DR
+   * is cleared once, after the FIFO has been drained. On Linux backends
+   * with batched SPI the whole drain is a single syscall: the FIFO is read
+   * speculatively and reads that find it empty are skipped, a payload that
+   * arrives during the drain is still returned. One that arrives between
+   * the width and payload reads of a dynamic payload is returned with a
+   * length of 32, the chip gives no width for it. Backends
+   * with scatter/gather SPI read the payloads straight into @p out, so the
+   * data of frames past the count returned may be overwritten.
+   *
+   * @code
+   * RF24Frame frames[3];
+   * size_t count = radio.readBurst(frames, 3);
+   * for(size_t i = 0; i < count; i++){
+   *   handle(frames[i].pipe, frames[i].data, frames[i].length);
+   * }
+   * @endcode
+   * @param out Where to store the frames
+   * @param max Maximum number of frames to read
+   * @return Number of frames read, 0 if the RX FIFO was empty
+   */
+  size_t readBurst(RF24Frame* out, size_t max);
+
+#if defined (RF24_IRQ_WAIT)
+  /**
+   * Arm the GPIO wired to the radio's IRQ pin for waitForEvent()
+   *
+   * The pin is set up for falling edge detection, without a handler thread.
+   * Use maskIRQ() to choose which events pull the IRQ line low.
+   *
+   * @param pin The pin attached to IRQ on the RF module
+   * @return True if the pin could be set up
+   */
+  bool attachIrq(uint16_t pin);
+
+  /**
+   * Sleep until the radio raises an interrupt
+   *
+   * Blocks on the IRQ line armed with attachIrq() instead of polling, so an
+   * idle receiver costs no CPU and wakes as soon as the IRQ falls. Without
+   * an IRQ pin the STATUS register is polled every 100us instead.
+   *
+   * The flags that fired are cleared before returning. RX_DR is also
+   * reported while payloads are left in the RX FIFO, so a loop that reads
+   * only one payload per event does not stall:
+   * @code
+   * radio.attachIrq(24);
+   * radio.maskIRQ(1,1,0); // Only wake up for received payloads
+   * radio.startListening();
+   * while(1){
+   *   if(radio.waitForEvent(1000) & _BV(RX_DR)){
+   *     RF24Frame frames[3];
+   *     size_t count = radio.readBurst(frames, 3);
+   *   }
+   * }
+   * @endcode
+   * @param timeout Maximum time to wait in milliseconds, -1 to wait forever
+   * @return The RX_DR, TX_DS and MAX_RT bits of STATUS that were set (see nRF24L01.h), 0 on timeout
+   */
+  uint8_t waitForEvent(int timeout);
+#endif
+
   /**
    * Check if the radio needs to be read. Can be used to prevent data loss
    * @return True if all three 32-byte radio buffers are full
@@ -528,7 +699,8 @@ s   *
    * Call this when you get an interrupt to find out why
    *
    * Tells you what caused the interrupt, and clears the state of
-   * interrupts.
+   * interrupts. A TX_DS that a write path waiting with RF24_WAIT_IRQ
+   * cleared since the last call is reported too.
    *
    * @param[out] tx_ok The send was successful (TX_DS)
    * @param[out] tx_fail The send failed, too many retries (MAX_RT)
@@ -536,6 +708,164 @@ s   *
    */
   void whatHappened(bool& tx_ok,bool& tx_fail,bool& rx_ready);
 
+  /**
+   * STATUS as seen by the most recent SPI transaction
+   *
+   * The chip clocks out STATUS at the start of every command, so this
+   * value is refreshed by every call that talks to the radio and reading
+   * it costs no SPI traffic. It is only as fresh as the last call though,
+   * available() is the cheapest way to refresh it.
+   *
+   * @return Last seen value of the STATUS register
+   */
+  uint8_t lastStatus(void) const;
+
+  /**
+   * Pipe of the payload at the head of the RX FIFO, from lastStatus()
+   *
+   * @return Pipe number 0-5, or 7 if the RX FIFO was empty
+   */
+  uint8_t lastPipe(void) const;
+
+  /**
+   * TX FIFO full flag, from lastStatus()
+   *
+   * @return True if the TX FIFO was full
+   */
+  bool lastTxFull(void) const;
+
+  /**
+   * Interrupt flags from lastStatus(), without any SPI traffic
+   *
+   * Unlike whatHappened(), the flags are not cleared.
+   *
+   * @param[out] tx_ok The send was successful (TX_DS)
+   * @param[out] tx_fail The send failed, too many retries (MAX_RT)
+   * @param[out] rx_ready There is a message waiting to be read (RX_DR)
+   */
+  void lastFlags(bool& tx_ok,bool& tx_fail,bool& rx_ready) const;
+
+#if !defined (MINIMAL)
+  /**
+   * Keep a copy of the configuration registers in RAM
+   *
+   * With the cache enabled, setters stop reading a register just to flip
+   * some bits, and writes that would not change a register are skipped.
+   * Cached are NRF_CONFIG, EN_AA, EN_RXADDR, SETUP_AW, SETUP_RETR, RF_CH,
+   * RF_SETUP, RX_PW_Px, DYNPD, FEATURE and the pipe addresses.
+   *
+   * Call this before begin(), which fills the cache. Enabled later, the
+   * cache fills itself as registers are accessed.
+   *
+   * @note The cache assumes nobody else changes the chip. After a brown-out
+   * or a suspected reset, call verifyRegisterCache().
+   * @code
+   * radio.enableRegisterCache();
+   * radio.begin();
+   * @endcode
+   */
+  void enableRegisterCache(void);
+
+  /**
+   * Stop using the register cache, every access goes to the chip again
+   */
+  void disableRegisterCache(void);
+
+  /**
+   * Discard the cached values and read them all from the chip again
+   */
+  void reloadRegisterCache(void);
+
+  /**
+   * Compare the cached registers with the chip
+   *
+   * Use it periodically or after a brown-out to detect a chip that lost
+   * its configuration.
+   *
+   * @param restore On mismatch, write the cached values back to the chip.
+   * Otherwise the cache takes the chip's values.
+   * @return True if the chip matched the cache
+   */
+  bool verifyRegisterCache(bool restore = true);
+#endif
+
+#if defined (RF24_LINUX)
+  /**
+   * Read the single byte configuration registers, see RF24Registers.h
+   *
+   * Served from the register cache when it is enabled.
+   */
+  void readRegisters(RF24RegisterImage& image);
+
+  /**
+   * Write a whole configuration at once, see RF24Registers.h
+   *
+   * Registers the cache knows to hold their value already are skipped,
+   * the others go out in a single SPI batch on backends that have one.
+   * NRF_CONFIG is written last so the chip powers up or enters RX with the
+   * rest in place, followed by a Tpd2stby wait if it powers up.
+   *
+   * The address width, dynamic payloads, data rate and per-pipe payload
+   * sizes the driver keeps track of follow the image, a pipe with RX_PW 0
+   * takes the size of setPayloadSize(). That size stays the default, used
+   * for the pipes opened from now on.
+   *
+   * @note FEATURE and DYNPD need ACTIVATE on the original nRF24L01, which
+   * is not sent here.
+   */
+  void writeRegisters(const RF24RegisterImage& image);
+
+  /**
+   * Bring the radio to a declared configuration, see RF24RadioProfile
+   *
+   * Reads the registers and addresses the profile covers, in one SPI batch
+   * for those the register cache doesn't hold, then writes the ones that
+   * differ from the profile in a second batch, NRF_CONFIG last. Applying
+   * the profile the radio already has writes nothing.
+   *
+   * The payload sizes, address width, dynamic payloads and pipe 0 reading
+   * address the driver keeps track of follow the profile. Works in RX and
+   * in TX mode, startListening() and stopListening() keep working as after
+   * the equivalent setters and openReadingPipe() / openWritingPipe() calls.
+   *
+   * @note FEATURE and DYNPD need ACTIVATE on the original nRF24L01, which
+   * begin() sends but apply() doesn't.
+   */
+  void apply(const RF24RadioProfile& profile);
+
+  /**
+   * Capture the whole register file and the driver state
+   *
+   * Reads the chip, not the register cache, in one SPI batch on backends
+   * that have one.
+   */
+  void snapshot(RF24RadioState& state);
+
+  /**
+   * Check that the chip still holds a snapshot, a cheap way to detect a reset
+   *
+   * One SPI batch reads NRF_CONFIG to RF_SETUP. EN_RXADDR and PRIM_RX,
+   * which startListening() and stopListening() change, are not compared.
+   *
+   * @return False if the chip lost its configuration or doesn't answer
+   */
+  bool holdsState(const RF24RadioState& state);
+
+  /**
+   * Recover the radio from a failure without begin()
+   *
+   * Flushes the FIFOs, clears the interrupt flags and writes the whole
+   * snapshot back in one SPI batch, NRF_CONFIG last, without the settling
+   * delays of begin(). The Tpd2stby wait only happens if the chip powered
+   * down in the meantime. CE is set back to listening if the snapshot
+   * was taken in RX mode.
+   *
+   * @return True if the chip holds the snapshot afterwards, false if it
+   * doesn't answer and needs begin()
+   */
+  bool restore(const RF24RadioState& state);
+#endif
+
   /**
    * Non-blocking write to the open writing pipe used for buffered writes
    *
@@ -686,6 +1016,102 @@ s   *
   //#if defined (FAILURE_HANDLING)
     bool failureDetected; 
   //#endif
+
+#if defined (RF24_TX_POLICY)
+  /**
+   * Set how long write(), writeFast(), writeBlocking() and txStandBy()
+   * wait for the chip before declaring it hung
+   *
+   * A wait that sees neither TX_DS nor MAX_RT by its deadline is a
+   * timeout: failureDetected is set and getWriteResult() returns
+   * RF24_TX_TIMEOUT. A deadline is the time a 32 byte payload takes to
+   * reach MAX_RT with the retries of setRetries() at the rate of
+   * setDataRate(), for every payload waited on, plus the margin. With the
+   * retries begin() sets that is 28ms at 2Mbps and 46ms at 250kbps rather
+   * than 95ms, and a couple of ms with few retries. Deadlines are measured
+   * with micros(), monotonic on Linux. Only on Linux, and with
+   * FAILURE_HANDLING but not MINIMAL elsewhere: MINIMAL builds wait 95ms,
+   * builds without FAILURE_HANDLING wait without a deadline.
+   *
+   * @code
+   * RF24TimeoutPolicy policy = radio.getTimeoutPolicy();
+   * policy.notify = false; // The caller looks at getWriteResult(), nothing to print
+   * radio.setTimeoutPolicy(policy);
+   * @endcode
+   */
+  void setTimeoutPolicy(const RF24TimeoutPolicy& policy) { timeout_policy = policy; }
+
+  /** @return The policy set with setTimeoutPolicy() */
+  const RF24TimeoutPolicy& getTimeoutPolicy(void) { return timeout_policy; }
+#endif
+
+#if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
+  /**
+   * Deadline of a wait for @p payloads to be sent or to fail
+   *
+   * Always 95ms in MINIMAL builds off Linux.
+   *
+   * @see setTimeoutPolicy()
+   * @return Microseconds
+   */
+  uint32_t getTxDeadline(uint8_t payloads = 1);
+
+  /**
+   * Outcome of the last write(), writeFast(), writeBlocking() or txStandBy()
+   *
+   * Tells the payload that was not acknowledged (RF24_TX_MAX_RT) from the
+   * chip that didn't answer in time (RF24_TX_TIMEOUT) when they return 0.
+   */
+  rf24_tx_result_e getWriteResult(void) { return (rf24_tx_result_e) tx_result; }
+#endif
+
+#if defined (RF24_LINUX)
+  /**
+   * Choose how write(), writeFast(), writeBlocking() and txStandBy() wait
+   * for the chip while a payload is on air
+   *
+   * @li RF24_WAIT_SPIN reads STATUS back to back, the fastest to notice the
+   * end of a payload and the busiest bus. Default.
+   * @li RF24_WAIT_BACKOFF sleeps for the time the payload needs to be
+   * acked at best before the first look, then from its airtime doubling up
+   * to one retransmission, sized from setDataRate(), setRetries() and the
+   * length of the payload.
+   * @li RF24_WAIT_IRQ sleeps on the IRQ pin armed with attachIrq() until
+   * TX_DS or MAX_RT pulls it low, with the sleeps of RF24_WAIT_BACKOFF as
+   * timeouts. TX_DS and MAX_RT must not be masked with maskIRQ(), and a
+   * pending RX_DR keeps the line low, clear it before writing. The TX_DS
+   * of earlier payloads is cleared so that the line can fall again, and
+   * whatHappened() still reports it. Without an IRQ pin, or on platforms
+   * without RF24_IRQ_WAIT, it backs off instead.
+   *
+   * Linux only, where a sleep leaves the CPU to other processes. The
+   * others always spin.
+   *
+   * getTxStats() tells what each one costs on the bus:
+   * @code
+   * radio.setTxWait(RF24_WAIT_BACKOFF);
+   * radio.resetTxStats();
+   * for(int i = 0; i < 100; i++){ radio.write(&data, sizeof(data)); }
+   * RF24TxStats s = radio.getTxStats();
+   * printf("%.1f SPI accesses per payload\n", (float) s.spi / ( s.payloads - s.failed ));
+   * @endcode
+   */
+  void setTxWait(rf24_tx_wait_e wait) { tx_wait = wait; }
+
+  /** @return The strategy set with setTxWait() */
+  rf24_tx_wait_e getTxWait(void) { return (rf24_tx_wait_e) tx_wait; }
+
+  /**
+   * SPI accesses of the write paths since construction or resetTxStats()
+   *
+   * Payloads delivered are the payloads loaded less the failed ones, see
+   * setTxWait() to compare the cost of the wait strategies per payload.
+   */
+  RF24TxStats getTxStats(void) { return tx_stats; }
+
+  /** Restart the counters of getTxStats() */
+  void resetTxStats(void);
+#endif
     
   /**@}*/
 
@@ -738,12 +1164,35 @@ s   *
    * transmit the maximum payload size (32 bytes), no matter how much
    * was sent to write().
    *
+   * Sets the width of every reading pipe too, on the chip at once, also
+   * the pipes given their own with setPayloadSize(uint8_t, uint8_t).
+   * Call it after begin().
+   *
    * @todo Implement variable-sized payloads feature
    *
    * @param size The number of bytes in the payload
    */
   void setPayloadSize(uint8_t size);
 
+  /**
+   * Set the static payload size of one reading pipe
+   *
+   * Every byte of padding is airtime, 32us at 250kbps. Pipes that carry a
+   * smaller struct than the others can be given their own width, and
+   * read() pads or truncates to the width of the pipe the payload came in
+   * on. Takes effect at once, also on an open pipe. setPayloadSize(uint8_t)
+   * sets every pipe back to the same width.
+   *
+   * @code
+   * radio.setPayloadSize(1, sizeof(ActuatorData));
+   * radio.setPayloadSize(2, sizeof(ContextTag));
+   * @endcode
+   *
+   * @param pipe Which pipe, 0-5
+   * @param size The number of bytes in the payloads received on @p pipe, up to 32
+   */
+  void setPayloadSize(uint8_t pipe, uint8_t size);
+
   /**
    * Get Static Payload Size
    *
@@ -753,6 +1202,16 @@ s   *
    */
   uint8_t getPayloadSize(void);
 
+  /**
+   * Get the static payload size of one reading pipe
+   *
+   * @see setPayloadSize(uint8_t, uint8_t)
+   *
+   * @param pipe Which pipe, 0-5
+   * @return The number of bytes in the payloads received on @p pipe
+   */
+  uint8_t getPayloadSize(uint8_t pipe);
+
   /**
    * Get Dynamic Payload Size
    *
@@ -998,6 +1457,17 @@ s   *
    */
   void openWritingPipe(uint64_t address);
 
+  /**
+   * Open a pipe for writing, with its own static payload size
+   * @note For compatibility with old code only, see new function
+   *
+   * @see openWritingPipe(const uint8_t*, uint8_t)
+   *
+   * @param address The 40-bit address of the pipe to open.
+   * @param size The number of bytes in the payloads sent, up to 32
+   */
+  void openWritingPipe(uint64_t address, uint8_t size);
+
   /**
    * Empty the receive buffer
    *
@@ -1095,6 +1565,28 @@ private:
    */
   uint8_t read_payload(void* buf, uint8_t len);
 
+  #if defined (RF24_SPI_BATCH)
+  /**
+   * Read the receive payload, optionally clearing the interrupt flags
+   * in the same SPI batch
+   *
+   * @param buf Where to put the data
+   * @param len Maximum number of bytes to read
+   * @param clear_irq Also clear RX_DR, TX_DS and MAX_RT
+   * @return Value of status register before the flags were cleared
+   */
+  uint8_t read_payload(void* buf, uint8_t len, bool clear_irq);
+
+  /**
+   * Clear the interrupt flags, optionally flushing the TX FIFO in the
+   * same SPI batch
+   *
+   * @param flush Also flush the TX FIFO
+   * @return Value of status register before the flags were cleared
+   */
+  uint8_t clear_status(bool flush);
+  #endif
+
   /**
    * Retrieve the current status of the chip
    *
@@ -1160,10 +1652,99 @@ private:
    */
 
   uint8_t spiTrans(uint8_t cmd);
+
+#if !defined (MINIMAL)
+  /**
+   * Register cache helpers, see enableRegisterCache()
+   *
+   * cache_read() serves a read from the cache, cache_store() records what
+   * was read from or written to the chip, cache_write() returns true if a
+   * write would not change the register and can be skipped.
+   */
+  uint8_t* cache_slot(uint8_t reg, uint8_t& width, uint32_t& bit);
+  bool cache_read(uint8_t reg, uint8_t* buf, uint8_t len);
+  void cache_store(uint8_t reg, const uint8_t* buf, uint8_t len);
+  bool cache_write(uint8_t reg, const uint8_t* buf, uint8_t len);
+  void cache_drop(uint8_t reg);
+  void cache_fill(void);
+#endif
+
+#if defined (RF24_LINUX)
+  /**
+   * Register accesses of readRegisters(), writeRegisters() and apply()
+   *
+   * read_registers() fills data, from the cache or with one SPI batch for
+   * the rest, or all from the chip with @p chip set. write_registers()
+   * writes all of them in one SPI batch.
+   * image_state() updates the driver state from an image just written.
+   */
+  struct RegAccess
+  {
+    uint8_t reg;
+    uint8_t len; /**< Up to 5 bytes */
+    uint8_t data[5];
+  };
+  void read_registers(RegAccess* regs, uint8_t count, bool chip = false);
+  void write_registers(const RegAccess* regs, uint8_t count);
+  void image_state(const RF24RegisterImage& image, bool powering_up);
+#endif
   
   #if defined (FAILURE_HANDLING) || defined (RF24_LINUX)
 	void errNotify(void);
+
+  /**
+   * A write path ran past its deadline, see setTimeoutPolicy()
+   */
+  void tx_timeout(void);
   #endif
+
+  /**
+   * A write path starts, for getTxStats()
+   */
+#if defined (RF24_LINUX)
+  void tx_begin(void);
+#else
+  void tx_begin(void) {}
+#endif
+
+  /**
+   * A write path returns @p result
+   *
+   * @param result rf24_tx_result_e of the write
+   * @param loaded Whether it loaded a payload
+   * @return True for RF24_TX_OK
+   */
+  bool tx_end(uint8_t result, bool loaded);
+
+  /**
+   * Wait before the next look at the chip, as setTxWait() chose
+   *
+   * @param look Looks that found the payload still on air so far
+   */
+#if defined (RF24_LINUX)
+  void tx_pause(uint8_t look);
+#else
+  void tx_pause(uint8_t look) {}
+#endif
+
+  /**
+   * Wait for room in the TX FIFO, the first half of writeFast()
+   *
+   * @return False, with the write ended, if a payload failed meanwhile
+   */
+  bool tx_room(void);
+
+  /**
+   * Wait for the payload just loaded with CE high, the second half of write()
+   *
+   * @return The result of the write, ended
+   */
+  bool tx_complete(void);
+
+  /**
+   * readBurst() reading static payloads @p width bytes wide, or dynamic ones
+   */
+  size_t read_burst(RF24Frame* out, size_t max, uint8_t width, bool dynamic);
   
   /**@}*/
 
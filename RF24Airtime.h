@@ -0,0 +1,154 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24Airtime.h
+ *
+ * Airtime and link budget of Enhanced ShockBurst packets
+ */
+
+#ifndef __RF24_AIRTIME_H__
+#define __RF24_AIRTIME_H__
+
+#include "RF24.h"
+
+/**
+ * Timing of one payload over a link, from the settings of the sender
+ *
+ * Every value is computed from the packet layout and the state machine of
+ * the datasheet, the same model the Emulator driver runs:
+ *
+ * @li An attempt starts with Tstby2a (130us) while the PLL settles, only
+ * once per payload: retransmissions start as soon as the last one timed out.
+ * @li A packet is the preamble, the address, the 9 bit packet control
+ * field, the payload and the CRC, at the data rate.
+ * @li With auto-ack the receiver answers 130us after the end of the packet
+ * with an ack packet, the sender waits ARD from the end of its packet before
+ * it retransmits, and raises MAX_RT once ARC retransmissions went unanswered.
+ *
+ * Everything is constexpr, so a profile can be checked when it compiles:
+ *
+ * @code
+ * constexpr RF24Airtime tag(RF24_250KBPS, 5, RF24_CRC_16, sizeof(ContextTag), 5, 15);
+ * static_assert(tag.ackFits(), "ARD too short for the ack at 250kbps");
+ * static_assert(tag.packetsPerSecond(3) >= 10, "3 sensors can't send 10 tags per second");
+ * @endcode
+ *
+ * The write paths of RF24 derive their deadlines from it, see
+ * RF24::setTimeoutPolicy(), and RF24Handle sizes its TX windows with it.
+ * RF24RadioProfile and RF24Profile give the airtime of the links they
+ * configure. Written in C++11, it builds for every platform.
+ */
+struct RF24Airtime
+{
+  static constexpr uint32_t settle_us = 130; /**< Tstby2a, and the RX to TX turnaround before an ack */
+
+  rf24_datarate_e data_rate; /**< As setDataRate() */
+  uint8_t address_width; /**< Address width, 3 to 5 bytes */
+  rf24_crclength_e crc_length; /**< As setCRCLength(), auto-ack forces at least one byte */
+  uint8_t payload_size; /**< Payload length, the static width or the dynamic length */
+  uint8_t retry_delay; /**< As the delay of setRetries(), ( retry_delay + 1 ) * 250us */
+  uint8_t retry_count; /**< As the count of setRetries(), 0 to 15 */
+  bool auto_ack; /**< False for multicast writes or pipes without auto-ack */
+  uint8_t ack_payload_size; /**< Length of the payload the acks carry, 0 for none */
+
+  /**
+   * @param rate Air data rate
+   * @param width Address width, 3 to 5 bytes
+   * @param crc CRC length
+   * @param size Payload length, up to 32 bytes
+   * @param delay Retransmit delay, as setRetries()
+   * @param count Retransmissions, as setRetries()
+   * @param ack Whether the receiver acks the payload
+   * @param ack_size Length of the ack payloads, 0 for none
+   */
+  constexpr RF24Airtime(rf24_datarate_e rate, uint8_t width, rf24_crclength_e crc, uint8_t size,
+                        uint8_t delay = 5, uint8_t count = 15, bool ack = true, uint8_t ack_size = 0):
+    data_rate(rate), address_width(width < 3 ? 3 : width > 5 ? 5 : width), crc_length(crc),
+    payload_size(size > 32 ? 32 : size), retry_delay(delay & 0x0F), retry_count(count & 0x0F),
+    auto_ack(ack), ack_payload_size(ack_size > 32 ? 32 : ack_size)
+  {
+  }
+
+  /** @return Time on air of @p bits at the data rate, us rounded up */
+  constexpr uint32_t bitsUs(uint32_t bits) const
+  {
+    return data_rate == RF24_250KBPS ? bits * 4 : data_rate == RF24_2MBPS ? ( bits + 1 ) / 2 : bits;
+  }
+
+  /** @return Bytes of CRC on air */
+  constexpr uint8_t crcBytes() const
+  {
+    return crc_length == RF24_CRC_16 ? 2 : crc_length == RF24_CRC_8 || auto_ack ? 1 : 0;
+  }
+
+  /** @return Bits of a packet carrying @p size bytes: preamble, address, control field, payload, CRC */
+  constexpr uint32_t packetBits(uint8_t size) const
+  {
+    return 8 * ( 1 + address_width ) + 9 + 8 * size + 8 * crcBytes();
+  }
+
+  /** @return Time on air of the packet */
+  constexpr uint32_t packetUs() const { return bitsUs(packetBits(payload_size)); }
+
+  /** @return Time on air of the ack, 0 without auto-ack */
+  constexpr uint32_t ackUs() const { return auto_ack ? bitsUs(packetBits(ack_payload_size)) : 0; }
+
+  /** @return ARD, from the end of a packet to its retransmission */
+  constexpr uint32_t retransmitDelayUs() const { return ( retry_delay + 1 ) * 250UL; }
+
+  /** @return Whether the ack arrives within ARD, otherwise every payload ends in MAX_RT */
+  constexpr bool ackFits() const { return !auto_ack || settle_us + ackUs() <= retransmitDelayUs(); }
+
+  /** @return Packets put on air for one payload at most, retransmissions included */
+  constexpr uint8_t maxAttempts() const { return auto_ack ? retry_count + 1 : 1; }
+
+  /** @return Time one unanswered attempt takes: the packet, then ARD waiting for the ack */
+  constexpr uint32_t attemptUs() const { return packetUs() + ( auto_ack ? retransmitDelayUs() : 0 ); }
+
+  /** @return Time from CE high to TX_DS when the first attempt gets through */
+  constexpr uint32_t deliveryUs() const
+  {
+    return settle_us + packetUs() + ( auto_ack ? settle_us + ackUs() : 0 );
+  }
+
+  /** @return Time from CE high to TX_DS when only the last retransmission gets through */
+  constexpr uint32_t worstDeliveryUs() const
+  {
+    return deliveryUs() + ( maxAttempts() - 1 ) * attemptUs();
+  }
+
+  /** @return Time from CE high to MAX_RT when no attempt gets through */
+  constexpr uint32_t giveUpUs() const
+  {
+    return settle_us + maxAttempts() * attemptUs();
+  }
+
+  /**
+   * Payloads per second the channel carries when @p pipes senders share it
+   *
+   * Counts back to back deliveries without retransmission, the ceiling of
+   * a collision-free schedule. Senders that don't coordinate collide well
+   * before, plan for a fraction of it.
+   *
+   * @param pipes Senders sharing the channel at the same rate
+   * @return Payloads per second for each of them
+   */
+  constexpr uint32_t packetsPerSecond(uint8_t pipes = 1) const
+  {
+    return 1000000UL / ( deliveryUs() * ( pipes ? pipes : 1 ) );
+  }
+};
+
+// The model against the timings of the datasheet: 1 byte of preamble, a
+// 9 bit control field, 4us per bit at 250kbps and 0.5us at 2Mbps
+static_assert(RF24Airtime(RF24_1MBPS, 5, RF24_CRC_16, 32).packetUs() == 8 * ( 1 + 5 + 32 + 2 ) + 9, "packet layout");
+static_assert(RF24Airtime(RF24_250KBPS, 5, RF24_CRC_16, 0).ackUs() == 4 * ( 8 * ( 1 + 5 + 2 ) + 9 ), "250kbps");
+static_assert(RF24Airtime(RF24_2MBPS, 5, RF24_CRC_8, 32).packetUs() == ( 8 * ( 1 + 5 + 32 + 1 ) + 9 + 1 ) / 2, "2Mbps");
+// The datasheet asks for an ARD of at least 500us at 250kbps
+static_assert(!RF24Airtime(RF24_250KBPS, 5, RF24_CRC_16, 32, 0).ackFits() && RF24Airtime(RF24_250KBPS, 5, RF24_CRC_16, 32, 1).ackFits(), "ARD");
+
+#endif // __RF24_AIRTIME_H__
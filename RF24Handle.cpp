@@ -0,0 +1,369 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#include "RF24Handle.h"
+
+#if defined (RF24_LINUX)
+
+#include "nRF24L01.h"
+#include "RF24Airtime.h"
+
+#include <memory>
+#include <vector>
+
+static int64_t steadyMicros()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/****************************************************************************/
+
+RF24Handle::RF24Handle(RF24& _radio):
+  radio(_radio), head(&stub), tail(&stub), submitted(0), applied(0), rxCount(0), txCount(0), txFailed(0), failure(false), latency(5),
+  taken(0), txWindow(15000), rxGap(5000), windowEnd(0), windowDue(false), closeUs(500), payloadUs(500),
+  deafUs(0), windowCount(0), longestWindow(0), deferredCount(0), statsStart(steadyMicros())
+{
+  stub.next.store(NULL, std::memory_order_relaxed);
+}
+
+/****************************************************************************/
+
+RF24Handle::~RF24Handle()
+{
+  while ( Node* node = pop() ){
+    backlog.push_back(node);
+  }
+  for ( size_t i = 0; i < backlog.size(); i++ ){
+    Node* node = backlog[i];
+    if ( !node->command && node->callback ){
+      RF24TxResult result;
+      result.acked = false;
+      result.retries = RF24_TX_RETRIES_UNKNOWN;
+      result.address = node->address;
+      node->callback(result);
+    }
+    delete node;
+  }
+}
+
+/****************************************************************************/
+
+void RF24Handle::push(Node* node)
+{
+  node->next.store(NULL, std::memory_order_relaxed);
+  Node* prev = head.exchange(node, std::memory_order_acq_rel);
+  // Between the exchange and this store the owner sees the queue as cut at prev
+  prev->next.store(node, std::memory_order_release);
+}
+
+/****************************************************************************/
+
+RF24Handle::Node* RF24Handle::pop()
+{
+  Node* t = tail;
+  Node* next = t->next.load(std::memory_order_acquire);
+  if ( t == &stub ){
+    if ( !next ){
+      return NULL;
+    }
+    tail = next;
+    t = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if ( next ){
+    tail = next;
+    return t;
+  }
+  if ( t != head.load(std::memory_order_acquire) ){
+    // A producer is half way through push(), pick it up next time
+    return NULL;
+  }
+  // t is the last node: put the stub behind it so it can be handed out
+  push(&stub);
+  next = t->next.load(std::memory_order_acquire);
+  if ( next ){
+    tail = next;
+    return t;
+  }
+  return NULL;
+}
+
+/****************************************************************************/
+
+void RF24Handle::submit(Command command)
+{
+  Node* node = new Node();
+  node->command = command;
+  submitted.fetch_add(1, std::memory_order_relaxed);
+  push(node);
+}
+
+/****************************************************************************/
+
+void RF24Handle::send(uint64_t address, const void* buf, uint8_t len, Callback callback, bool multicast)
+{
+  Node* node = new Node();
+  node->callback = callback;
+  node->address = address;
+  node->len = rf24_min(len, 32);
+  node->attempts = 0;
+  memcpy(node->data, buf, node->len);
+  node->multicast = multicast;
+  submitted.fetch_add(1, std::memory_order_relaxed);
+  push(node);
+}
+
+/****************************************************************************/
+
+std::future<RF24TxResult> RF24Handle::sendAsync(uint64_t address, const void* buf, uint8_t len, bool multicast)
+{
+  std::shared_ptr<std::promise<RF24TxResult> > promise(new std::promise<RF24TxResult>());
+  send(address, buf, len, [promise](const RF24TxResult& result){ promise->set_value(result); }, multicast);
+  return promise->get_future();
+}
+
+/****************************************************************************/
+
+size_t RF24Handle::process()
+{
+  while ( Node* node = pop() ){
+    backlog.push_back(node);
+    taken++;
+  }
+
+  size_t count = 0;
+  while ( !backlog.empty() ){
+    if ( backlog.front()->command ){
+      std::unique_ptr<Node> node(backlog.front());
+      backlog.pop_front();
+      node->command(radio);
+      applied.fetch_add(1, std::memory_order_relaxed);
+      count++;
+      continue;
+    }
+    if ( !windowOpen() ){
+      break;
+    }
+    count += sendWindow();
+  }
+
+  failure.store(radio.failureDetected, std::memory_order_relaxed);
+  return count;
+}
+
+/****************************************************************************/
+
+bool RF24Handle::windowOpen()
+{
+  return !windowDue || (uint32_t)( micros() - windowEnd ) >= rxGap;
+}
+
+/****************************************************************************/
+
+size_t RF24Handle::sendWindow()
+{
+  // The link settings the airtime of every payload is sized from
+  uint8_t retr = radio.read_register(SETUP_RETR);
+  bool autoAck = radio.read_register(EN_AA) & _BV(ENAA_P0);
+  rf24_datarate_e rate = radio.getDataRate();
+  rf24_crclength_e crc = radio.getCRCLength();
+
+  struct Done
+  {
+    Callback callback;
+    RF24TxResult result;
+  };
+  std::vector<Done> done;
+
+  // Between two looks at STATUS while a payload is in flight
+  const uint32_t pollUs = 100;
+  uint32_t overhead = 0; // Largest SPI and scheduling cost of a payload here
+
+  uint32_t start = micros();
+  radio.stopListening();
+
+  while ( !backlog.empty() && !backlog.front()->command ){
+    Node* node = backlog.front();
+    uint32_t now = micros();
+
+    uint8_t len = radio.dynamic_payloads_enabled ? node->len : radio.tx_payload_size;
+    RF24Airtime air(rate, radio.addr_width, crc, len, retr >> ARD, retr & 0x0F, autoAck && !node->multicast);
+    uint8_t spent = rf24_min( node->attempts, air.maxAttempts() - 1 );
+    uint8_t left = air.maxAttempts() - spent;
+    uint8_t attempts = left;
+    if ( txWindow ){
+      // What is left of the window once the way back to RX is paid for,
+      // and what one payload costs besides its attempts
+      uint32_t used = ( now - start ) + closeUs;
+      uint32_t room = txWindow - rf24_min( txWindow, used );
+      uint32_t fixed = rf24_max( overhead, payloadUs );
+      fixed += RF24Airtime::settle_us + pollUs;
+      uint32_t fit = room > fixed ? ( room - fixed ) / air.attemptUs() : 0;
+      if ( fit < left ){
+        // A payload is never cut short on air: retransmitted after a flush
+        // it would get a new PID, and a receiver that got it but whose ack
+        // was lost would take it twice. The first payload of a window makes
+        // progress with the retransmissions that fit, at least one, and
+        // picks up in the next window after MAX_RT; the others wait for it.
+        if ( !done.empty() ){
+          break;
+        }
+        attempts = fit ? fit : 1;
+      }
+    }
+
+    if ( node->address ){
+      radio.openWritingPipe(node->address);
+    }
+    // ARC counts the retransmissions of this window only
+    bool limited = attempts < air.maxAttempts();
+    if ( limited ){
+      radio.write_register(SETUP_RETR, ( retr & 0xF0 ) | ( attempts - 1 ));
+    }
+    // Without a window, twice the worst case means the chip is stuck
+    uint32_t limit = 2 * air.giveUpUs();
+
+    radio.startFastWrite(node->data, node->len, node->multicast);
+    uint8_t status;
+    while ( !( ( status = radio.get_status() ) & ( _BV(TX_DS) | _BV(MAX_RT) ) ) ){
+      if ( (uint32_t)( micros() - now ) >= limit ){
+        break;
+      }
+      delayMicroseconds(pollUs);
+    }
+    radio.ce(LOW);
+    uint8_t arc = ( radio.read_register(OBSERVE_TX) >> ARC_CNT ) & 0x0F;
+    // A flag raised since the last look is still in the status clocked out here
+    status |= radio.write_register(NRF_STATUS, _BV(TX_DS) | _BV(MAX_RT));
+    if ( !( status & _BV(TX_DS) ) ){
+      radio.flush_tx();
+    }
+    if ( limited ){
+      radio.write_register(SETUP_RETR, retr);
+    }
+
+    // Time not spent on air, for sizing the next payloads
+    uint32_t onAir = ( status & _BV(TX_DS) ) ? air.deliveryUs() + arc * air.attemptUs()
+                                             : RF24Airtime::settle_us + ( arc + 1 ) * air.attemptUs();
+    uint32_t took = micros() - now;
+    if ( took > onAir + overhead ){
+      overhead = took - onAir;
+    }
+
+    node->attempts += arc + 1;
+    if ( ( status & _BV(MAX_RT) ) && attempts < left ){
+      // Out of time: the retransmissions left go to the next window
+      break;
+    }
+
+    backlog.pop_front();
+    std::unique_ptr<Node> owned(node);
+    Done d;
+    d.callback = node->callback;
+    d.result.acked = status & _BV(TX_DS);
+    d.result.retries = rf24_min( node->attempts - 1, 15 );
+    d.result.address = node->address;
+    done.push_back(d);
+  }
+
+  // Back to RX before anything else, the callbacks run while listening
+  uint32_t closing = micros();
+  radio.startListening();
+  uint32_t end = micros();
+  uint32_t deaf = end - start;
+  closeUs = end - closing;
+  if ( overhead ){
+    payloadUs = overhead;
+  }
+
+  windowDue = !backlog.empty() && !backlog.front()->command;
+  if ( windowDue ){
+    windowEnd = end;
+    deferredCount.fetch_add(1, std::memory_order_relaxed);
+  }
+  deafUs.fetch_add(deaf, std::memory_order_relaxed);
+  windowCount.fetch_add(1, std::memory_order_relaxed);
+  if ( deaf > longestWindow.load(std::memory_order_relaxed) ){
+    longestWindow.store(deaf, std::memory_order_relaxed);
+  }
+
+  for ( size_t i = 0; i < done.size(); i++ ){
+    txCount.fetch_add(1, std::memory_order_relaxed);
+    if ( !done[i].result.acked ){
+      txFailed.fetch_add(1, std::memory_order_relaxed);
+    }
+    if ( done[i].callback ){
+      done[i].callback(done[i].result);
+    }
+    applied.fetch_add(1, std::memory_order_relaxed);
+  }
+  return done.size();
+}
+
+/****************************************************************************/
+
+RF24HandleStats RF24Handle::stats() const
+{
+  RF24HandleStats s;
+  uint64_t total = steadyMicros() - statsStart.load(std::memory_order_relaxed);
+  s.deaf_us = deafUs.load(std::memory_order_relaxed);
+  s.listening_us = total > s.deaf_us ? total - s.deaf_us : 0;
+  s.windows = windowCount.load(std::memory_order_relaxed);
+  s.longest_window_us = longestWindow.load(std::memory_order_relaxed);
+  s.deferred = deferredCount.load(std::memory_order_relaxed);
+  return s;
+}
+
+/****************************************************************************/
+
+void RF24Handle::resetStats()
+{
+  statsStart.store(steadyMicros(), std::memory_order_relaxed);
+  deafUs.store(0, std::memory_order_relaxed);
+  windowCount.store(0, std::memory_order_relaxed);
+  longestWindow.store(0, std::memory_order_relaxed);
+  deferredCount.store(0, std::memory_order_relaxed);
+}
+
+/****************************************************************************/
+
+size_t RF24Handle::receive(RF24Frame* out, size_t max, int timeout)
+{
+  process();
+
+  uint32_t start = millis();
+  for(;;){
+    int left = timeout - (int)( millis() - start );
+    if ( left < 0 ){
+      left = 0;
+    }
+    int slice = left < latency ? left : latency;
+    if ( windowDue ){
+      // Wake up in time for the next TX window
+      uint32_t since = micros() - windowEnd;
+      int wait = since >= rxGap ? 0 : (int)( rxGap - since + 999 ) / 1000;
+      if ( wait < slice ){
+        slice = wait;
+      }
+    }
+
+    if ( radio.waitForEvent(slice) & _BV(RX_DR) ){
+      break;
+    }
+    if ( left <= slice || submitted.load(std::memory_order_relaxed) != taken || ( windowDue && windowOpen() ) ){
+      // Timed out, or something to apply before waiting any longer
+      failure.store(radio.failureDetected, std::memory_order_relaxed);
+      return 0;
+    }
+  }
+
+  size_t count = radio.readBurst(out, max);
+  rxCount.fetch_add(count, std::memory_order_relaxed);
+  failure.store(radio.failureDetected, std::memory_order_relaxed);
+  return count;
+}
+
+#endif // RF24_LINUX
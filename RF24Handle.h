@@ -0,0 +1,272 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24Handle.h
+ *
+ * Class declaration for RF24Handle, sharing one radio between threads on Linux
+ */
+
+#ifndef __RF24_HANDLE_H__
+#define __RF24_HANDLE_H__
+
+#include "RF24.h"
+#include "RF24TxQueue.h"
+
+#if defined (RF24_LINUX)
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+
+/**
+ * Time a radio shared through RF24Handle spent in RX and in TX windows
+ */
+struct RF24HandleStats
+{
+  uint64_t listening_us; /**< Time in RX mode, able to hear uplinks */
+  uint64_t deaf_us; /**< Time out of RX in TX windows */
+  uint64_t windows; /**< TX windows opened */
+  uint32_t longest_window_us; /**< Longest time out of RX in one window */
+  uint64_t deferred; /**< Windows closed with payloads left for the next one */
+};
+
+/**
+ * Thread-safe handle to a radio driven by a single owner thread
+ *
+ * RF24 is not thread-safe: every call goes through the shared SPI buffers
+ * and updates driver state. With a handle, only the owner thread (the one
+ * running the RX loop) talks to the radio. Other threads submit payloads
+ * to send and configuration changes, which the owner applies between two
+ * RX drains in the order they were submitted.
+ *
+ * Submission is a lock-free multi-producer single-consumer queue: neither
+ * the submitting threads nor the owner take a mutex to pass commands, and
+ * the counters below can be read from any thread at any time.
+ *
+ * While the owner waits for payloads it looks at the queue every
+ * setCommandLatency() milliseconds, which bounds how long a submitted
+ * command waits when the air is quiet.
+ *
+ * The radio is half-duplex: while it sends it hears none of the uplink
+ * pipes. Payloads are sent in TX windows that leave RX once for as many
+ * queued payloads as fit in setTxWindow(), then go straight back to RX.
+ * A payload only starts when all of its retransmissions, the SPI traffic
+ * around it and the way back to RX fit in what is left of the window, and
+ * is never cut short once on air. The first payload of a window gets the
+ * retransmissions that fit and, after MAX_RT, picks up in the next window
+ * with those it has left, so a payload to an unreachable node can't keep
+ * the hub deaf for its whole ARC. It goes on air again as a new packet: a
+ * receiver that got it but whose ack was lost takes it twice. Every window
+ * sends at least one attempt, so only a window shorter than one attempt
+ * is overrun. When payloads are left over, the hub listens for at least
+ * setRxGap() before the next window, so that uplinks retried while it was
+ * deaf get through. stats() reports the time spent listening and deaf.
+ *
+ * @code
+ * RF24Handle handle(radio);
+ *
+ * // Owner thread, radio configured and listening
+ * while(running){
+ *   RF24Frame frames[3];
+ *   size_t n = handle.receive(frames, 3, 100);
+ *   ...
+ * }
+ *
+ * // Any other thread
+ * handle.send(actuator, &cmd, sizeof(cmd), [](const RF24TxResult& r){ ... });
+ * handle.submit([](RF24& radio){ radio.setChannel(90); });
+ * @endcode
+ */
+class RF24Handle
+{
+public:
+
+  typedef std::function<void(RF24&)> Command;
+  typedef std::function<void(const RF24TxResult&)> Callback;
+
+  /**
+   * @param radio Radio to share, configured and listening
+   */
+  RF24Handle(RF24& radio);
+
+  /**
+   * Payloads still queued are reported as not acked, commands are dropped
+   */
+  ~RF24Handle();
+
+  /**
+   * @name Any thread
+   *
+   * Lock-free, these never wait for the owner.
+   */
+  /**@{*/
+
+  /**
+   * Run @p command on the owner thread
+   *
+   * The radio is listening when the command runs, a command that stops
+   * listening must start it again.
+   */
+  void submit(Command command);
+
+  /**
+   * Send a payload from the owner thread, reporting its outcome to a callback
+   *
+   * Consecutive payloads are sent without going back to RX in between.
+   * The callback runs on the owner thread and must not use the radio.
+   *
+   * @param address Writing pipe to send to, 0 for the one currently open.
+   * Static payloads to an address are padded to getPayloadSize(), those to
+   * the open pipe to the size it was opened with, see
+   * RF24::openWritingPipe(uint64_t, uint8_t)
+   * @param buf Payload, copied
+   * @param len Length of the payload, up to 32 bytes
+   * @param callback Called once with the outcome
+   * @param multicast Send without requesting an acknowledgement
+   */
+  void send(uint64_t address, const void* buf, uint8_t len, Callback callback, bool multicast = false);
+
+  /**
+   * Send a payload from the owner thread, reporting its outcome through a future
+   *
+   * Named apart from send(), which a lambda without captures would
+   * otherwise match as the bool of this one.
+   *
+   * @see send(uint64_t, const void*, uint8_t, Callback, bool)
+   */
+  std::future<RF24TxResult> sendAsync(uint64_t address, const void* buf, uint8_t len, bool multicast = false);
+
+  /** @return Commands and payloads submitted but not applied yet */
+  size_t pending() const { return submitted.load(std::memory_order_relaxed) - applied.load(std::memory_order_relaxed); }
+
+  /** @return Payloads received by the owner so far */
+  uint64_t received() const { return rxCount.load(std::memory_order_relaxed); }
+
+  /** @return Payloads sent so far */
+  uint64_t sent() const { return txCount.load(std::memory_order_relaxed); }
+
+  /** @return Payloads sent so far that were not acked */
+  uint64_t failed() const { return txFailed.load(std::memory_order_relaxed); }
+
+  /** @return failureDetected of the radio as of the owner's last drain */
+  bool failureDetected() const { return failure.load(std::memory_order_relaxed); }
+
+  /** @return Time spent listening and in TX windows since construction or resetStats() */
+  RF24HandleStats stats() const;
+
+  /** Restart the counters of stats() */
+  void resetStats();
+
+  /**@}*/
+
+  /**
+   * @name Owner thread
+   */
+  /**@{*/
+
+  /**
+   * Apply every command and payload submitted so far
+   *
+   * Payloads that don't fit in the current TX window, and everything
+   * submitted after them, wait for the next window.
+   *
+   * @return Number of commands and payloads applied
+   */
+  size_t process();
+
+  /**
+   * One iteration of the RX loop: apply what was submitted, wait up to
+   * @p timeout ms for payloads, then drain the RX FIFO
+   *
+   * Returns early, with no payload, to apply commands submitted while
+   * waiting or to open the next TX window.
+   *
+   * @param out Frames received
+   * @param max Size of @p out
+   * @param timeout Milliseconds to wait, 0 for none
+   * @return Number of frames stored in @p out
+   */
+  size_t receive(RF24Frame* out, size_t max, int timeout);
+
+  /**
+   * Longest time receive() waits before looking at the queue. Default: 5ms
+   */
+  void setCommandLatency(int ms) { latency = ms > 0 ? ms : 1; }
+
+  /**
+   * Longest time out of RX to send queued payloads, 0 to send every
+   * queued payload at once. Default: 15ms, well below the ~35ms a sensor
+   * keeps retrying with 15 retries and a 1500us delay at 250kbps
+   */
+  void setTxWindow(uint32_t us) { txWindow = us; }
+
+  /**
+   * Shortest time in RX between two TX windows when payloads are left
+   * over. Default: 5ms
+   */
+  void setRxGap(uint32_t us) { rxGap = us; }
+
+  /**@}*/
+
+private:
+
+  /** Entry of the submission queue, either a command or a payload */
+  struct Node
+  {
+    std::atomic<Node*> next;
+    Command command;
+    Callback callback;
+    uint64_t address;
+    uint8_t data[32];
+    uint8_t len;
+    bool multicast;
+    uint8_t attempts; /**< Attempts spent in earlier windows */
+  };
+
+  RF24& radio;
+
+  // Intrusive MPSC queue (D. Vyukov): producers swap the head, the owner
+  // walks from the tail. The stub keeps the queue from ever being empty.
+  std::atomic<Node*> head;
+  Node* tail;
+  Node stub;
+
+  std::atomic<uint64_t> submitted;
+  std::atomic<uint64_t> applied;
+  std::atomic<uint64_t> rxCount;
+  std::atomic<uint64_t> txCount;
+  std::atomic<uint64_t> txFailed;
+  std::atomic<bool> failure;
+  int latency;
+
+  // Owner side: what was taken off the queue but waits for a TX window
+  std::deque<Node*> backlog;
+  uint64_t taken;
+  uint32_t txWindow;
+  uint32_t rxGap;
+  uint32_t windowEnd; /**< micros() when the last window left payloads over */
+  bool windowDue; /**< Payloads wait for the next window */
+  uint32_t closeUs; /**< Time startListening() took at the end of the last window */
+  uint32_t payloadUs; /**< Largest time a payload of the last window spent off air */
+
+  std::atomic<uint64_t> deafUs;
+  std::atomic<uint64_t> windowCount;
+  std::atomic<uint32_t> longestWindow;
+  std::atomic<uint64_t> deferredCount;
+  std::atomic<int64_t> statsStart; /**< steady_clock of the last resetStats(), us */
+
+  void push(Node* node);
+  Node* pop();
+  bool windowOpen();
+  size_t sendWindow();
+};
+
+#endif // RF24_LINUX
+
+#endif // __RF24_HANDLE_H__
@@ -0,0 +1,443 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24Registers.h
+ *
+ * Typed description of the nRF24L01 configuration registers on Linux
+ */
+
+#ifndef __RF24_REGISTERS_H__
+#define __RF24_REGISTERS_H__
+
+#include "RF24.h"
+#include "RF24Airtime.h"
+
+#if defined (RF24_LINUX)
+
+#include "nRF24L01.h"
+
+/**
+ * Reached only when a field is given a value it can't hold, or set twice
+ * in one composition. Not constexpr, so a constant expression that gets
+ * here fails to compile. At run time the value is masked to the field.
+ */
+inline void rf24_register_error(const char*) {}
+
+/**
+ * Value of some of the bits of register @p Reg
+ *
+ * Values of the same register combine with |, values of two different
+ * registers don't compile. apply() merges the bits set into the current
+ * content of the register, leaving the others alone.
+ *
+ * @code
+ * constexpr RF24RegValue<NRF_CONFIG> on = RF24Reg::Config::PwrUp(1) | RF24Reg::crc(RF24_CRC_16);
+ * write_register(NRF_CONFIG, on.apply(read_register(NRF_CONFIG)));
+ * @endcode
+ */
+template <uint8_t Reg>
+struct RF24RegValue
+{
+  static constexpr uint8_t reg = Reg; /**< Register address */
+
+  uint8_t value; /**< Bits set, within mask */
+  uint8_t mask; /**< Bits this value defines */
+
+  constexpr RF24RegValue(): value(0), mask(0) {}
+  constexpr RF24RegValue(uint8_t _value, uint8_t _mask): value(_value & _mask), mask(_mask) {}
+
+  /** Both values at once, they must not define the same bits */
+  constexpr RF24RegValue operator|(RF24RegValue other) const
+  {
+    return ( mask & other.mask ) ? ( rf24_register_error("field set twice"), RF24RegValue(value | other.value, mask | other.mask) )
+                                 : RF24RegValue(value | other.value, mask | other.mask);
+  }
+
+  /** @return @p current with the bits of this value replaced */
+  constexpr uint8_t apply(uint8_t current) const { return ( current & ~mask ) | value; }
+};
+
+/**
+ * @p Width bits of register @p Reg, starting at bit @p Shift
+ *
+ * Constructing a field gives the value of those bits, get() extracts the
+ * field from a whole register.
+ */
+template <uint8_t Reg, uint8_t Shift, uint8_t Width = 1>
+struct RF24Field : RF24RegValue<Reg>
+{
+  static_assert(Shift + Width <= 8, "field past the end of the register");
+
+  static constexpr uint8_t max = ( 1 << Width ) - 1; /**< Largest value the field holds */
+  static constexpr uint8_t bits = max << Shift; /**< Mask of the field in the register */
+
+  constexpr explicit RF24Field(uint8_t v):
+    RF24RegValue<Reg>(( v > max ? ( rf24_register_error("value out of range"), v ) : v ) << Shift, bits) {}
+
+  /** @return The field in the register value @p current */
+  static constexpr uint8_t get(uint8_t current) { return ( current & bits ) >> Shift; }
+};
+
+/**
+ * Fields of the configuration registers, named after the datasheet
+ */
+namespace RF24Reg
+{
+  namespace Config
+  {
+    typedef RF24Field<NRF_CONFIG, MASK_RX_DR> MaskRxDr;
+    typedef RF24Field<NRF_CONFIG, MASK_TX_DS> MaskTxDs;
+    typedef RF24Field<NRF_CONFIG, MASK_MAX_RT> MaskMaxRt;
+    typedef RF24Field<NRF_CONFIG, EN_CRC> EnCrc;
+    typedef RF24Field<NRF_CONFIG, CRCO> Crco;
+    typedef RF24Field<NRF_CONFIG, PWR_UP> PwrUp;
+    typedef RF24Field<NRF_CONFIG, PRIM_RX> PrimRx;
+  }
+  namespace EnAA
+  {
+    typedef RF24Field<EN_AA, ENAA_P0, 6> Pipes; /**< One bit per pipe */
+  }
+  namespace EnRxAddr
+  {
+    typedef RF24Field<EN_RXADDR, ERX_P0, 6> Pipes; /**< One bit per pipe */
+  }
+  namespace SetupAw
+  {
+    typedef RF24Field<SETUP_AW, AW, 2> Aw; /**< Address width minus 2 */
+  }
+  namespace SetupRetr
+  {
+    typedef RF24Field<SETUP_RETR, ARD, 4> Ard; /**< Retransmit delay, (Ard + 1) * 250us */
+    typedef RF24Field<SETUP_RETR, ARC, 4> Arc; /**< Retransmissions */
+  }
+  namespace RfCh
+  {
+    typedef RF24Field<RF_CH, 0, 7> Channel;
+  }
+  namespace RfSetup
+  {
+    typedef RF24Field<RF_SETUP, 7> ContWave;
+    typedef RF24Field<RF_SETUP, RF_DR_LOW> RfDrLow;
+    typedef RF24Field<RF_SETUP, PLL_LOCK> PllLock;
+    typedef RF24Field<RF_SETUP, RF_DR_HIGH> RfDrHigh;
+    typedef RF24Field<RF_SETUP, RF_PWR_LOW, 2> RfPwr;
+    typedef RF24Field<RF_SETUP, LNA_HCURR> LnaHcurr; /**< LNA gain on the nRF24L01, extra PA bit on the Si24R1 */
+  }
+  namespace Status
+  {
+    typedef RF24Field<NRF_STATUS, RX_DR> RxDr; /**< Cleared by writing 1 */
+    typedef RF24Field<NRF_STATUS, TX_DS> TxDs; /**< Cleared by writing 1 */
+    typedef RF24Field<NRF_STATUS, MAX_RT> MaxRt; /**< Cleared by writing 1 */
+  }
+  namespace Dynpd
+  {
+    typedef RF24Field<DYNPD, DPL_P0, 6> Pipes; /**< One bit per pipe */
+  }
+  namespace Feature
+  {
+    typedef RF24Field<FEATURE, EN_DPL> EnDpl;
+    typedef RF24Field<FEATURE, EN_ACK_PAY> EnAckPay;
+    typedef RF24Field<FEATURE, EN_DYN_ACK> EnDynAck;
+  }
+
+  /** Width of static payloads on pipe @p Pipe */
+  template <uint8_t Pipe>
+  struct RxPw
+  {
+    static_assert(Pipe < 6, "pipes are 0 to 5");
+    typedef RF24Field<RX_PW_P0 + Pipe, 0, 6> Width;
+  };
+
+  /** EN_CRC and CRCO for @p length, as setCRCLength() */
+  constexpr RF24RegValue<NRF_CONFIG> crc(rf24_crclength_e length)
+  {
+    return Config::EnCrc(length != RF24_CRC_DISABLED) | Config::Crco(length == RF24_CRC_16);
+  }
+
+  /** RF_DR_LOW and RF_DR_HIGH for @p speed, as setDataRate() */
+  constexpr RF24RegValue<RF_SETUP> dataRate(rf24_datarate_e speed)
+  {
+    return RfSetup::RfDrLow(speed == RF24_250KBPS) | RfSetup::RfDrHigh(speed == RF24_2MBPS);
+  }
+
+  /** RF_PWR and the LNA bit for @p level, as setPALevel() */
+  constexpr RF24RegValue<RF_SETUP> paLevel(uint8_t level)
+  {
+    return RfSetup::RfPwr(level > RF24_PA_MAX ? (uint8_t) RF24_PA_MAX : level) | RfSetup::LnaHcurr(1);
+  }
+
+  /** SETUP_RETR for @p delay (in 250us steps after the first) and @p count, as setRetries() */
+  constexpr RF24RegValue<SETUP_RETR> retries(uint8_t delay, uint8_t count)
+  {
+    return SetupRetr::Ard(delay) | SetupRetr::Arc(count);
+  }
+
+  /** SETUP_AW for addresses of @p width bytes, 3 to 5 */
+  constexpr RF24RegValue<SETUP_AW> addressWidth(uint8_t width)
+  {
+    return SetupAw::Aw(width >= 3 && width <= 5 ? width - 2 : ( rf24_register_error("addresses are 3 to 5 bytes"), 3 ));
+  }
+
+  // The fields above against the bit mnemonics, and against register
+  // values RF24 has always written
+  static_assert(Config::PwrUp(1).value == _BV(PWR_UP) && Config::PrimRx(1).value == _BV(PRIM_RX), "CONFIG layout");
+  static_assert(crc(RF24_CRC_16).value == 0x0C && crc(RF24_CRC_8).value == 0x08 && crc(RF24_CRC_DISABLED).mask == 0x0C, "CRC bits");
+  static_assert(dataRate(RF24_250KBPS).value == 0x20 && dataRate(RF24_2MBPS).value == 0x08 && dataRate(RF24_1MBPS).mask == 0x28, "data rate bits");
+  static_assert(paLevel(RF24_PA_HIGH).value == 0x05 && paLevel(RF24_PA_ERROR).value == 0x07, "PA bits");
+  static_assert(retries(5, 15).value == 0x5F && addressWidth(5).value == 0x03, "SETUP_RETR and SETUP_AW layout");
+}
+
+/**
+ * The single byte configuration registers, as a value
+ *
+ * Holds NRF_CONFIG to RF_SETUP, RX_PW_P0 to RX_PW_P5, DYNPD and FEATURE:
+ * everything the register cache keeps but the addresses. Images are built
+ * at compile time with with(), starting from reset() or from the chip with
+ * RF24::readRegisters(), and written in one pass with RF24::writeRegisters().
+ *
+ * @code
+ * constexpr RF24RegisterImage hub = RF24RegisterImage::reset()
+ *   .with(RF24Reg::Config::PwrUp(1) | RF24Reg::crc(RF24_CRC_16) | RF24Reg::Config::MaskTxDs(1) | RF24Reg::Config::MaskMaxRt(1))
+ *   .with(RF24Reg::dataRate(RF24_250KBPS) | RF24Reg::paLevel(RF24_PA_HIGH))
+ *   .with(RF24Reg::retries(5, 15))
+ *   .with(RF24Reg::RfCh::Channel(76));
+ * radio.writeRegisters(hub);
+ * @endcode
+ */
+struct RF24RegisterImage
+{
+  static constexpr uint8_t count = 15; /**< Registers in an image */
+
+  uint8_t values[count]; /**< In the order of slot() */
+
+  /** @return Index of @p reg in values, -1 if it isn't part of an image */
+  static constexpr int8_t slot(uint8_t reg)
+  {
+    return reg <= RF_SETUP ? reg
+         : reg >= RX_PW_P0 && reg <= RX_PW_P5 ? reg - RX_PW_P0 + 7
+         : reg == DYNPD || reg == FEATURE ? reg - DYNPD + 13
+         : -1;
+  }
+
+  /** @return Register at index @p i of values */
+  static constexpr uint8_t reg(uint8_t i)
+  {
+    return i < 7 ? i : i < 13 ? RX_PW_P0 + i - 7 : DYNPD + i - 13;
+  }
+
+  /** Content of the registers after a power on reset, per the nRF24L01+ datasheet */
+  static constexpr RF24RegisterImage reset()
+  {
+    return RF24RegisterImage{ { 0x08, 0x3F, 0x03, 0x03, 0x03, 0x02, 0x0E, 0, 0, 0, 0, 0, 0, 0, 0 } };
+  }
+
+  /** @return Content of @p reg */
+  constexpr uint8_t get(uint8_t reg) const { return values[slot(reg)]; }
+
+  /** @return This image with the bits of @p v replaced */
+  template <uint8_t Reg>
+  constexpr RF24RegisterImage with(RF24RegValue<Reg> v) const
+  {
+    static_assert(slot(Reg) >= 0, "register not part of an image");
+    RF24RegisterImage image = *this;
+    image.values[slot(Reg)] = v.apply(values[slot(Reg)]);
+    return image;
+  }
+};
+
+/**
+ * A whole radio configuration, declared as plain values
+ *
+ * Where RF24Profile fixes a configuration at compile time for RF24Static,
+ * a radio profile is an ordinary value: fill in the fields that differ
+ * from the defaults, which are what begin() leaves in the chip, and hand
+ * it to RF24::apply(). apply() compares the profile with the registers
+ * and only writes the ones that differ, all in one SPI batch, so applying
+ * a profile again after a failure, or changing the channel of a radio
+ * already set up, costs a few bytes on the bus.
+ *
+ * @code
+ * RF24RadioProfile hub;
+ * hub.data_rate = RF24_250KBPS;
+ * hub.pa_level = RF24_PA_HIGH;
+ * hub.irq_mask = _BV(MASK_TX_DS) | _BV(MASK_MAX_RT);
+ * hub.writing_address = pipes[0];
+ * hub.reading_pipes = 0x3E;
+ * for(uint8_t i = 1; i < 6; i++)
+ *   hub.reading_addresses[i] = pipes[i];
+ * radio.begin();
+ * radio.apply(hub);
+ * @endcode
+ */
+struct RF24RadioProfile
+{
+  uint8_t channel = 76; /**< RF channel, 0 to 125 */
+  rf24_datarate_e data_rate = RF24_1MBPS; /**< Air data rate */
+  uint8_t pa_level = RF24_PA_MAX; /**< One of rf24_pa_dbm_e */
+  rf24_crclength_e crc_length = RF24_CRC_16; /**< The chip forces a CRC on pipes with auto-ack */
+  uint8_t retry_delay = 5; /**< Retransmit delay, ( retry_delay + 1 ) * 250us */
+  uint8_t retry_count = 15; /**< Retransmissions, 0 to 15 */
+  uint8_t address_width = 5; /**< Address width, 3 to 5 bytes */
+  uint8_t payload_size = 32; /**< Width of static payloads on the pipes used */
+  uint8_t pipe_payload_sizes[6] = { 0, 0, 0, 0, 0, 0 }; /**< Width on each reading pipe, 0 for payload_size */
+  uint8_t writing_payload_size = 0; /**< Width of the payloads sent, 0 for payload_size */
+  uint8_t auto_ack = 0x3F; /**< One bit per pipe */
+  uint8_t dynamic_payloads = 0; /**< One bit per pipe, each needs auto-ack on its pipe */
+  uint8_t irq_mask = 0; /**< MASK_RX_DR, MASK_TX_DS and MASK_MAX_RT bits of NRF_CONFIG, as maskIRQ() */
+  uint64_t writing_address = 0; /**< As openWritingPipe(), 0 to leave the writing pipe alone */
+  uint8_t reading_pipes = 0x03; /**< One bit per pipe open for reading */
+  uint64_t reading_addresses[6] = { 0xE7E7E7E7E7ULL, 0xC2C2C2C2C2ULL, 0xC3, 0xC4, 0xC5, 0xC6 }; /**< Pipes 2 to 5 only use the LSB */
+
+  /** @return Width of static payloads received on @p pipe */
+  constexpr uint8_t pipeWidth(uint8_t pipe) const
+  {
+    uint8_t width = pipe_payload_sizes[pipe] ? pipe_payload_sizes[pipe] : payload_size;
+    return width > 32 ? 32 : width;
+  }
+
+  /** @return Width of static payloads sent to the writing address */
+  constexpr uint8_t writingWidth() const
+  {
+    uint8_t width = writing_payload_size ? writing_payload_size : payload_size;
+    return width > 32 ? 32 : width;
+  }
+
+  /** @return Airtime of the payloads sent to the writing address */
+  constexpr RF24Airtime writingAirtime() const
+  {
+    return RF24Airtime(data_rate, address_width, crc_length, dynamic_payloads & 1 ? 32 : writingWidth(),
+                       retry_delay, retry_count, auto_ack & 1);
+  }
+
+  /** @return Airtime of the payloads received on @p pipe, from a sender with the same settings */
+  constexpr RF24Airtime pipeAirtime(uint8_t pipe) const
+  {
+    return RF24Airtime(data_rate, address_width, crc_length, dynamic_payloads >> pipe & 1 ? 32 : pipeWidth(pipe),
+                       retry_delay, retry_count, auto_ack >> pipe & 1);
+  }
+
+  /** @return Whether pipe 0 holds the writing address rather than its reading address in @p current */
+  constexpr bool pipe0Writes(const RF24RegisterImage& current) const
+  {
+    return writing_address && !( current.get(NRF_CONFIG) & _BV(PRIM_RX) && reading_pipes & 1 );
+  }
+
+  /**
+   * The registers of @p current with this profile applied
+   *
+   * PWR_UP and PRIM_RX are kept, as are the FEATURE bits for ack payloads
+   * and no-ack writes. Pipe 0 is open while out of RX when there is a
+   * writing address, to receive the acks, like after stopListening().
+   */
+  constexpr RF24RegisterImage image(const RF24RegisterImage& current) const
+  {
+    RF24RegisterImage image = current
+      .with(RF24Reg::crc(crc_length) | RF24Reg::Config::MaskRxDr(( irq_mask >> MASK_RX_DR ) & 1)
+            | RF24Reg::Config::MaskTxDs(( irq_mask >> MASK_TX_DS ) & 1) | RF24Reg::Config::MaskMaxRt(( irq_mask >> MASK_MAX_RT ) & 1))
+      .with(RF24Reg::EnAA::Pipes(auto_ack & 0x3F))
+      .with(RF24Reg::EnRxAddr::Pipes(( reading_pipes | ( writing_address && !( current.get(NRF_CONFIG) & _BV(PRIM_RX) ) ) ) & 0x3F))
+      .with(RF24Reg::addressWidth(address_width))
+      .with(RF24Reg::retries(retry_delay, retry_count))
+      .with(RF24Reg::RfCh::Channel(channel > 125 ? 125 : channel))
+      .with(RF24Reg::dataRate(data_rate) | RF24Reg::paLevel(pa_level))
+      .with(RF24Reg::Dynpd::Pipes(dynamic_payloads & 0x3F))
+      .with(RF24Reg::Feature::EnDpl(dynamic_payloads != 0));
+    for ( uint8_t pipe = 0; pipe < 6; pipe++ ){
+      if ( ( reading_pipes >> pipe & 1 ) || ( pipe == 0 && writing_address ) ){
+        image.values[RF24RegisterImage::slot(RX_PW_P0 + pipe)] = pipeWidth(pipe);
+      }
+    }
+    return image;
+  }
+};
+
+/**
+ * Snapshot of a radio: its register file and what the driver keeps about it
+ *
+ * Taken with RF24::snapshot() once the radio is configured, and written
+ * back with RF24::restore() to recover from a failure without begin().
+ *
+ * @code
+ * radio.startListening();
+ * RF24RadioState state;
+ * radio.snapshot(state);
+ * ...
+ * if(radio.failureDetected){
+ *   radio.failureDetected = false;
+ *   if(!radio.restore(state)){
+ *     // The chip doesn't answer, start over with begin()
+ *   }
+ * }
+ * @endcode
+ */
+struct RF24RadioState
+{
+  static const size_t binary_size = 65; /**< Bytes written by toBinary() */
+  static const uint32_t driver_bit = 1UL << 31; /**< Bit of diff() for the driver side fields */
+
+  RF24RegisterImage registers; /**< Configuration registers */
+  uint8_t addresses[7][5]; /**< RX_ADDR_P0 to RX_ADDR_P5 then TX_ADDR, pipes 2 to 5 only use the first byte */
+  uint8_t status; /**< NRF_STATUS, not restored */
+  uint8_t observe_tx; /**< OBSERVE_TX, not restored */
+  uint8_t rpd; /**< RPD, not restored */
+  uint8_t fifo_status; /**< FIFO_STATUS, not restored */
+  uint8_t payload_size; /**< Driver side, see RF24::setPayloadSize() */
+  uint8_t tx_payload_size; /**< Driver side, see RF24::openWritingPipe(const uint8_t*, uint8_t) */
+  uint8_t pipe0_reading_address[5]; /**< Driver side, restored to pipe 0 by RF24::startListening() */
+  bool p_variant; /**< Driver side, see RF24::isPVariant() */
+
+  /**
+   * Fixed binary layout, for storing or sending a snapshot
+   *
+   * @param buf At least binary_size bytes
+   * @return binary_size
+   */
+  size_t toBinary(uint8_t* buf) const;
+
+  /**
+   * Load a snapshot written by toBinary()
+   *
+   * @return False if @p buf doesn't hold one, the state is left alone
+   */
+  bool fromBinary(const uint8_t* buf, size_t len);
+
+  /**
+   * One line JSON object, registers by datasheet name then the driver side
+   *
+   * @return Length of the whole text, like snprintf(): @p buf was too
+   * small if it is @p size or more
+   */
+  size_t toJSON(char* buf, size_t size) const;
+
+  /**
+   * The printDetails() report of this snapshot
+   *
+   * @return Length of the whole text, like snprintf()
+   */
+  size_t format(char* buf, size_t size) const;
+
+  /**
+   * Registers that differ from @p other
+   *
+   * @return One bit per register address, driver_bit for the driver side
+   */
+  uint32_t diff(const RF24RadioState& other) const;
+
+  /**
+   * The differences with @p other as text, "RF_CH 0x4c -> 0x02, ..."
+   *
+   * @return Length of the whole text, like snprintf(), 0 if the states match
+   */
+  size_t formatDiff(const RF24RadioState& other, char* buf, size_t size) const;
+
+  /** @return Datasheet name of register @p reg, NULL if there is none at that address */
+  static const char* registerName(uint8_t reg);
+};
+
+#endif // RF24_LINUX
+
+#endif // __RF24_REGISTERS_H__
@@ -0,0 +1,184 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24Ring.h
+ *
+ * Class declaration for RF24Ring, a fixed size queue between two threads on Linux
+ */
+
+#ifndef __RF24_RING_H__
+#define __RF24_RING_H__
+
+#include "RF24.h"
+
+#if defined (RF24_LINUX)
+
+#include <atomic>
+
+/** Size of a cache line, RF24Ring keeps each side's indices on its own */
+#define RF24_CACHE_LINE 64
+
+/**
+ * Counters of an RF24Ring, readable from any thread
+ */
+struct RF24RingStats
+{
+  uint64_t pushed; /**< Items accepted by push() */
+  uint64_t popped; /**< Items handed to the consumer */
+  uint64_t dropped; /**< Items push() refused because the ring was full */
+  uint32_t high_water; /**< Most items queued at once */
+};
+
+/**
+ * Lock-free single-producer single-consumer ring of @p N items
+ *
+ * Passes items from one thread to another without a mutex and without
+ * allocating: the storage is part of the ring, so memory stays the same
+ * however long the program runs. push() never waits: when the ring is full
+ * the item pushed is dropped and counted, and the consumer still gets the
+ * oldest ones. A producer that would rather keep the latest data, such as
+ * the last reading of each sensor, keeps it on its side until there is
+ * room again.
+ *
+ * Exactly one thread may call push() and exactly one other thread pop().
+ * Each side keeps its index, and a cached copy of the other side's, on a
+ * cache line of its own so the two threads don't bounce a line between
+ * cores on every item.
+ *
+ * @code
+ * RF24Ring<RF24Frame, 64> frames;
+ *
+ * // Radio thread
+ * if(!frames.push(frame)){
+ *   // Full, frame dropped
+ * }
+ *
+ * // Decoding thread
+ * RF24Frame frame;
+ * while(frames.pop(frame)){ ... }
+ * @endcode
+ *
+ * @tparam T Item type, copied in and out
+ * @tparam N Capacity, a power of two
+ */
+template <typename T, uint32_t N>
+class RF24Ring
+{
+public:
+
+  RF24Ring():
+    write(0), readCache(0), pushCount(0), dropCount(0), highWater(0), read(0), writeCache(0), popCount(0)
+  {
+  }
+
+  /**
+   * @name Producer thread
+   */
+  /**@{*/
+
+  /**
+   * Queue a copy of @p item, never waits
+   *
+   * @return False if the ring is full and @p item was dropped
+   */
+  bool push(const T& item)
+  {
+    uint32_t w = write.load(std::memory_order_relaxed);
+    if ( w - readCache == N ){
+      // Only look at the consumer's index when the cached one says full
+      readCache = read.load(std::memory_order_acquire);
+      if ( w - readCache == N ){
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    items[w & ( N - 1 )] = item;
+    write.store(w + 1, std::memory_order_release);
+    pushCount.fetch_add(1, std::memory_order_relaxed);
+    uint32_t used = w + 1 - readCache;
+    if ( used > highWater.load(std::memory_order_relaxed) ){
+      highWater.store(used, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /**@}*/
+
+  /**
+   * @name Consumer thread
+   */
+  /**@{*/
+
+  /**
+   * Take the oldest item, never waits
+   *
+   * @return False if the ring is empty
+   */
+  bool pop(T& item)
+  {
+    uint32_t r = read.load(std::memory_order_relaxed);
+    if ( r == writeCache ){
+      writeCache = write.load(std::memory_order_acquire);
+      if ( r == writeCache ){
+        return false;
+      }
+    }
+    item = items[r & ( N - 1 )];
+    // Hands the slot back to the producer
+    read.store(r + 1, std::memory_order_release);
+    popCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**@}*/
+
+  /**
+   * @name Any thread
+   */
+  /**@{*/
+
+  /** @return Items queued, may be stale by the time it returns */
+  uint32_t size() const { return write.load(std::memory_order_acquire) - read.load(std::memory_order_acquire); }
+
+  /** @return Number of items the ring holds */
+  static uint32_t capacity() { return N; }
+
+  /** @return Counters since construction */
+  RF24RingStats stats() const
+  {
+    RF24RingStats s;
+    s.pushed = pushCount.load(std::memory_order_relaxed);
+    s.dropped = dropCount.load(std::memory_order_relaxed);
+    s.popped = popCount.load(std::memory_order_relaxed);
+    s.high_water = highWater.load(std::memory_order_relaxed);
+    return s;
+  }
+
+  /**@}*/
+
+private:
+
+  static_assert(N >= 2 && ( N & ( N - 1 ) ) == 0, "RF24Ring capacity must be a power of two");
+
+  // Producer side
+  alignas(RF24_CACHE_LINE) std::atomic<uint32_t> write;
+  uint32_t readCache;
+  std::atomic<uint64_t> pushCount;
+  std::atomic<uint64_t> dropCount;
+  std::atomic<uint32_t> highWater;
+
+  // Consumer side
+  alignas(RF24_CACHE_LINE) std::atomic<uint32_t> read;
+  uint32_t writeCache;
+  std::atomic<uint64_t> popCount;
+
+  alignas(RF24_CACHE_LINE) T items[N];
+};
+
+#endif // RF24_LINUX
+
+#endif // __RF24_RING_H__
@@ -0,0 +1,294 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24Static.h
+ *
+ * Class declaration for RF24Static, a driver specialized for one fixed configuration on Linux
+ */
+
+#ifndef __RF24_STATIC_H__
+#define __RF24_STATIC_H__
+
+#include "RF24.h"
+#include "RF24Airtime.h"
+
+#if defined (RF24_LINUX)
+
+#include "nRF24L01.h"
+
+/**
+ * Fixed radio configuration, the template parameter of RF24Static
+ *
+ * Every value is a compile-time constant, checked when the profile is used.
+ *
+ * @tparam PayloadSize Width of static payloads, the largest payload accepted with dynamic payloads
+ * @tparam DynamicPayloads Whether every pipe uses dynamic payloads
+ * @tparam AddressWidth Address width, 3 to 5 bytes
+ * @tparam DataRate Air data rate
+ * @tparam CRCLength CRC length, RF24_CRC_DISABLED is not allowed with auto-ack
+ */
+template <uint8_t PayloadSize = 32, bool DynamicPayloads = false, uint8_t AddressWidth = 5,
+          rf24_datarate_e DataRate = RF24_250KBPS, rf24_crclength_e CRCLength = RF24_CRC_16>
+struct RF24Profile
+{
+  static_assert(PayloadSize >= 1 && PayloadSize <= 32, "payloads are 1 to 32 bytes");
+  static_assert(AddressWidth >= 3 && AddressWidth <= 5, "addresses are 3 to 5 bytes");
+  static_assert(CRCLength != RF24_CRC_DISABLED, "auto-ack needs a CRC");
+
+  static constexpr uint8_t payload_size = PayloadSize;
+  static constexpr bool dynamic_payloads = DynamicPayloads;
+  static constexpr uint8_t address_width = AddressWidth;
+  static constexpr rf24_datarate_e data_rate = DataRate;
+  static constexpr rf24_crclength_e crc_length = CRCLength;
+
+  /** @return Airtime of a full payload with auto-ack, dynamic payloads counted at their largest */
+  static constexpr RF24Airtime airtime(uint8_t retry_delay = 5, uint8_t retry_count = 15)
+  {
+    return RF24Airtime(DataRate, AddressWidth, CRCLength, PayloadSize, retry_delay, retry_count);
+  }
+};
+
+/** The PI2-Irri field profile: 250kbps, CRC16, 5 byte addresses and 32 byte static payloads */
+typedef RF24Profile<> RF24ProfileIrri;
+
+/**
+ * Driver specialized at compile time for one RF24Profile
+ *
+ * RF24 decides at run time, on every packet, whether payloads are dynamic
+ * and how much padding a static payload needs. Most deployments never
+ * change these after begin(), so RF24Static takes them from its profile
+ * instead. Its write(), writeFast(), read() and readBurst() load and fetch
+ * payloads with the widths known at compile time, so that the padding and
+ * dynamic payload branches fold away, around the same waits as RF24's.
+ * There is no virtual call: through an RF24 reference or pointer the same
+ * radio works with RF24's run-time widths, which the profile also set. The
+ * typed write() and read() check the size of the payload at compile time.
+ *
+ * begin() applies the whole profile. Everything else is inherited from
+ * RF24 and keeps working on the same radio. The setters the profile fixes
+ * are not available: setPayloadSize(), enableDynamicPayloads(),
+ * disableDynamicPayloads(), setAddressWidth() and the openWritingPipe()
+ * overloads that take a payload size.
+ *
+ * The SPI backend is the one chosen with ./configure --driver, like for
+ * RF24. The payload paths use its scatter/gather and batched transfers
+ * when it has them.
+ *
+ * @code
+ * RF24Static<RF24ProfileIrri> radio(26, 22);
+ * radio.begin();
+ * radio.openWritingPipe(pipes[2]);
+ * ContextTag tag = { 42, 21.5, 90 };
+ * radio.write(tag); // Fails to compile if a ContextTag doesn't fit in a payload
+ * @endcode
+ *
+ * @tparam Profile An RF24Profile
+ */
+template <class Profile>
+class RF24Static : public RF24
+{
+public:
+
+  /**
+   * @param _cepin The pin attached to Chip Enable on the RF module
+   * @param _cspin The pin attached to Chip Select
+   */
+  RF24Static(uint16_t _cepin, uint16_t _cspin): RF24(_cepin, _cspin) {}
+
+  /**
+   * @param _cepin The pin attached to Chip Enable on the RF module
+   * @param _cspin The pin attached to Chip Select
+   * @param spispeed SPI speed, see RF24::RF24(uint16_t, uint16_t, uint32_t)
+   */
+  RF24Static(uint16_t _cepin, uint16_t _cspin, uint32_t spispeed): RF24(_cepin, _cspin, spispeed) {}
+
+  /**
+   * Begin operation of the chip and apply the profile
+   *
+   * @return False if the chip did not respond or does not support the data rate
+   */
+  bool begin(void)
+  {
+    if ( !RF24::begin() ){
+      return false;
+    }
+    RF24::setAddressWidth(Profile::address_width);
+    RF24::setPayloadSize(Profile::payload_size);
+    if ( Profile::dynamic_payloads ){
+      RF24::enableDynamicPayloads();
+    }
+    setCRCLength(Profile::crc_length);
+    return setDataRate(Profile::data_rate);
+  }
+
+  using RF24::openWritingPipe;
+
+  /** Not available, payloads are padded to the width of the profile */
+  void openWritingPipe(const uint8_t* address, uint8_t size) = delete;
+  /** Not available, payloads are padded to the width of the profile */
+  void openWritingPipe(uint64_t address, uint8_t size) = delete;
+
+  /** @return Width of static payloads, or the largest dynamic payload */
+  static constexpr uint8_t getPayloadSize(void) { return Profile::payload_size; }
+
+  /**
+   * Blocking write, see RF24::write()
+   */
+  bool write(const void* buf, uint8_t len, const bool multicast = false)
+  {
+    tx_begin();
+    fixed_write_payload(buf, len, multicast ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD);
+    ce(HIGH);
+    return tx_complete();
+  }
+
+  /**
+   * Blocking write of a whole struct, which must fit in a payload
+   */
+  template <typename T>
+  bool write(const T& payload)
+  {
+    static_assert(sizeof(T) <= Profile::payload_size, "payload larger than the profile allows");
+    return write(&payload, sizeof(T));
+  }
+
+  /**
+   * Load a payload once the TX FIFO has room, see RF24::writeFast()
+   */
+  bool writeFast(const void* buf, uint8_t len, const bool multicast = false)
+  {
+    tx_begin();
+    if ( !tx_room() ){
+      return false;
+    }
+    fixed_write_payload(buf, len, multicast ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD);
+    ce(HIGH);
+    return tx_end(RF24_TX_OK, true);
+  }
+
+  /**
+   * Read the next payload and clear the interrupt flags, see RF24::read()
+   */
+  void read(void* buf, uint8_t len)
+  {
+    fixed_read_payload(buf, len, true);
+  }
+
+  /**
+   * Read the next payload into a whole struct, which must fit in a payload
+   */
+  template <typename T>
+  void read(T& payload)
+  {
+    static_assert(sizeof(T) <= Profile::payload_size, "payload larger than the profile allows");
+    read(&payload, sizeof(T));
+  }
+
+  /**
+   * Read every payload waiting in the RX FIFO, see RF24::readBurst()
+   */
+  size_t readBurst(RF24Frame* out, size_t max)
+  {
+    return read_burst(out, max, Profile::payload_size, Profile::dynamic_payloads);
+  }
+
+private:
+
+  // RF24::write_payload() with the widths of the profile
+  uint8_t fixed_write_payload(const void* buf, uint8_t len, const uint8_t writeType)
+  {
+    const uint8_t data_len = rf24_min(len, Profile::payload_size);
+    const uint8_t blank_len = Profile::dynamic_payloads ? 0 : Profile::payload_size - data_len;
+    uint8_t status;
+    tx_len = data_len + blank_len;
+    tx_ack = writeType == W_TX_PAYLOAD;
+
+    #if defined (RF24_SPI_SEGMENTS)
+    static const uint8_t blanks[32] = { 0 };
+    SPISegment segs[3];
+    uint8_t count = 0;
+    segs[count++] = { &writeType, &status, 1 };
+    if ( data_len ) segs[count++] = { buf, NULL, data_len };
+    if ( blank_len ) segs[count++] = { blanks, NULL, blank_len };
+    beginTransaction();
+    spi.transferSegments(segs, count);
+    endTransaction();
+    #else
+    spi_txbuff[0] = writeType;
+    memcpy(spi_txbuff + 1, buf, data_len);
+    memset(spi_txbuff + 1 + data_len, 0, blank_len);
+    beginTransaction();
+    spi.transfernb( (char *) spi_txbuff, (char *) spi_rxbuff, 1 + data_len + blank_len);
+    endTransaction();
+    status = spi_rxbuff[0];
+    #endif
+
+    last_status = status;
+    return status;
+  }
+
+  // RF24::read_payload() with the widths of the profile, clearing the
+  // interrupt flags in the same SPI batch on backends that have one
+  uint8_t fixed_read_payload(void* buf, uint8_t len, bool clear_irq)
+  {
+    const uint8_t data_len = rf24_min(len, Profile::payload_size);
+    const uint8_t blank_len = Profile::dynamic_payloads ? 0 : Profile::payload_size - data_len;
+    uint8_t status;
+
+    beginTransaction();
+    #if defined (RF24_SPI_BATCH)
+    uint8_t clear[2] = { W_REGISTER | ( REGISTER_MASK & NRF_STATUS ), _BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS) };
+    spi.beginBatch();
+    #if defined (RF24_SPI_SEGMENTS)
+    const uint8_t command = R_RX_PAYLOAD;
+    SPISegment segs[3];
+    uint8_t count = 0;
+    segs[count++] = { &command, &status, 1 };
+    if ( data_len ) segs[count++] = { NULL, buf, data_len };
+    if ( blank_len ) segs[count++] = { NULL, NULL, blank_len };
+    spi.batchSegments(segs, count);
+    #else
+    spi_txbuff[0] = R_RX_PAYLOAD;
+    memset(spi_txbuff + 1, RF24_NOP, data_len + blank_len);
+    spi.batch( (char *) spi_txbuff, (char *) spi_rxbuff, 1 + data_len + blank_len);
+    #endif
+    if ( clear_irq ){
+      spi.batch( (char *) clear, (char *) clear, 2);
+    }
+    spi.endBatch();
+    #else
+    spi_txbuff[0] = R_RX_PAYLOAD;
+    memset(spi_txbuff + 1, RF24_NOP, data_len + blank_len);
+    spi.transfernb( (char *) spi_txbuff, (char *) spi_rxbuff, 1 + data_len + blank_len);
+    #endif
+    endTransaction();
+
+    #if !defined (RF24_SPI_BATCH) || !defined (RF24_SPI_SEGMENTS)
+    memcpy(buf, spi_rxbuff + 1, data_len);
+    status = spi_rxbuff[0];
+    #endif
+    last_status = status;
+    if ( clear_irq ){
+      #if defined (RF24_SPI_BATCH)
+      last_status &= ~( _BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS) );
+      #else
+      write_register(NRF_STATUS, _BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS));
+      #endif
+    }
+    return status;
+  }
+
+  // Fixed by the profile
+  using RF24::setPayloadSize;
+  using RF24::enableDynamicPayloads;
+  using RF24::disableDynamicPayloads;
+  using RF24::setAddressWidth;
+};
+
+#endif // RF24_LINUX
+
+#endif // __RF24_STATIC_H__
@@ -0,0 +1,260 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+#include "RF24TxQueue.h"
+
+#if defined (RF24_LINUX)
+
+#include "nRF24L01.h"
+
+#include <memory>
+
+/****************************************************************************/
+
+RF24TxQueue::RF24TxQueue(RF24& _radio):
+  radio(_radio), address(0), pollInterval(100), outstanding(0), running(false), stopping(false), ceHigh(false)
+{
+}
+
+/****************************************************************************/
+
+RF24TxQueue::~RF24TxQueue()
+{
+  end();
+}
+
+/****************************************************************************/
+
+bool RF24TxQueue::begin()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if ( running ){
+    return false;
+  }
+  running = true;
+  stopping = false;
+  ceHigh = false;
+  address = 0;
+  worker = std::thread(&RF24TxQueue::run, this);
+  return true;
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::end()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( !running ){
+      return;
+    }
+    stopping = true;
+  }
+  wake.notify_one();
+  worker.join();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  running = false;
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::send(uint64_t address, const void* buf, uint8_t len, Callback callback, bool multicast)
+{
+  Message m;
+  m.address = address;
+  m.len = rf24_min(len, 32);
+  memcpy(m.data, buf, m.len);
+  m.multicast = multicast;
+  m.callback = callback;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(m);
+    outstanding++;
+  }
+  wake.notify_one();
+}
+
+/****************************************************************************/
+
+std::future<RF24TxResult> RF24TxQueue::sendAsync(uint64_t address, const void* buf, uint8_t len, bool multicast)
+{
+  std::shared_ptr<std::promise<RF24TxResult> > promise(new std::promise<RF24TxResult>());
+  send(address, buf, len, [promise](const RF24TxResult& result){ promise->set_value(result); }, multicast);
+  return promise->get_future();
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while ( outstanding ){
+    idle.wait(lock);
+  }
+}
+
+/****************************************************************************/
+
+size_t RF24TxQueue::pending()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return outstanding;
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::setPollInterval(uint32_t us)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  pollInterval = us;
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::run()
+{
+  for(;;){
+    uint32_t interval;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while ( queue.empty() && inflight.empty() && !stopping ){
+        if ( ceHigh ){
+          // Nothing left to send, drop from standby-II to standby-I
+          lock.unlock();
+          radio.ce(LOW);
+          ceHigh = false;
+          lock.lock();
+          continue;
+        }
+        wake.wait(lock);
+      }
+      if ( queue.empty() && inflight.empty() ){
+        break;
+      }
+      interval = pollInterval;
+    }
+
+    fill();
+    if ( !inflight.empty() ){
+      delayMicroseconds(interval);
+      poll();
+    }
+  }
+
+  if ( ceHigh ){
+    radio.ce(LOW);
+    ceHigh = false;
+  }
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::fill()
+{
+  // Two payloads: one on air and the next behind it, so that the FIFO
+  // level always tells how many completed, see poll()
+  while ( inflight.size() < 2 ){
+    Message m;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if ( queue.empty() ){
+        break;
+      }
+      // The FIFO is sent to a single address: let it drain before switching
+      uint64_t next = queue.front().address;
+      if ( next && next != address && !inflight.empty() ){
+        break;
+      }
+      m = queue.front();
+      queue.pop_front();
+    }
+
+    if ( m.address && m.address != address ){
+      radio.openWritingPipe(m.address);
+      address = m.address;
+    }
+    radio.startFastWrite(m.data, m.len, m.multicast, !ceHigh);
+    ceHigh = true;
+    inflight.push_back(m);
+  }
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::poll()
+{
+  // TX_DS is a single flag and may stand for both payloads in flight. It
+  // is only cleared here, after counting, so while it is set a completion
+  // is left to count. FIFO_STATUS, read with STATUS, only tells empty from
+  // not empty, which is exact with at most two payloads in flight.
+  uint8_t fifo = radio.read_register(FIFO_STATUS);
+  uint8_t status = radio.last_status;
+
+  if ( status & _BV(MAX_RT) ){
+    // TX is halted. Behind a set TX_DS the head was acked and the payload
+    // after it failed, otherwise the head failed and the payload behind it
+    // never went on air.
+    uint8_t arc = ( radio.read_register(OBSERVE_TX) >> ARC_CNT ) & 0x0F;
+    if ( ( status & _BV(TX_DS) ) && inflight.size() > 1 ){
+      complete(1, true, RF24_TX_RETRIES_UNKNOWN);
+    }
+    complete(1, false, arc);
+    radio.flush_tx();
+    radio.write_register(NRF_STATUS, _BV(MAX_RT) | _BV(TX_DS));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while ( !inflight.empty() ){
+      queue.push_front(inflight.back());
+      inflight.pop_back();
+    }
+    return;
+  }
+
+  if ( status & _BV(TX_DS) ){
+    if ( !( fifo & _BV(TX_EMPTY) ) ){
+      // Clear, then look again: a payload that completed in between left
+      // the FIFO, one that completes later raises TX_DS again
+      radio.write_register(NRF_STATUS, _BV(TX_DS));
+      fifo = radio.read_register(FIFO_STATUS);
+    }
+    size_t done = ( fifo & _BV(TX_EMPTY) ) ? inflight.size() : 1;
+    uint8_t arc = RF24_TX_RETRIES_UNKNOWN;
+    if ( done == inflight.size() ){
+      // Nothing on air: ARC_CNT is the last payload's, and the flag of a
+      // payload that completed after the first look is cleared safely
+      arc = ( radio.read_register(OBSERVE_TX) >> ARC_CNT ) & 0x0F;
+      radio.write_register(NRF_STATUS, _BV(TX_DS));
+    }
+    complete(done, true, arc);
+  }
+}
+
+/****************************************************************************/
+
+void RF24TxQueue::complete(size_t count, bool acked, uint8_t retries)
+{
+  for ( size_t i = 0; i < count && !inflight.empty(); i++ ){
+    Message m = inflight.front();
+    inflight.pop_front();
+
+    RF24TxResult result;
+    result.acked = acked;
+    result.retries = ( i + 1 == count ) ? retries : RF24_TX_RETRIES_UNKNOWN;
+    result.address = m.address;
+    if ( m.callback ){
+      m.callback(result);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( --outstanding == 0 ){
+      idle.notify_all();
+    }
+  }
+}
+
+#endif // RF24_LINUX
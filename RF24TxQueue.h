@@ -0,0 +1,181 @@
+/*
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file RF24TxQueue.h
+ *
+ * Class declaration for RF24TxQueue, asynchronous transmission on Linux
+ */
+
+#ifndef __RF24_TX_QUEUE_H__
+#define __RF24_TX_QUEUE_H__
+
+#include "RF24.h"
+
+#if defined (RF24_LINUX)
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/** RF24TxResult::retries value when the retransmission count could not be observed */
+#define RF24_TX_RETRIES_UNKNOWN 0xFF
+
+/**
+ * Outcome of one payload sent through RF24TxQueue
+ */
+struct RF24TxResult
+{
+  bool acked; /**< TX_DS: acknowledged, or sent for a multicast payload. False on MAX_RT or if the queue was stopped first */
+  uint8_t retries; /**< ARC_CNT of the payload, or RF24_TX_RETRIES_UNKNOWN */
+  uint64_t address; /**< Writing pipe the payload was sent to, 0 for the pipe open when queued */
+};
+
+/**
+ * Asynchronous, pipelined transmission
+ *
+ * A worker thread keeps two queued payloads in the TX FIFO of the radio,
+ * one on air and the next behind it, and reports the outcome of every
+ * payload through a callback or a future. CE stays high between them, so
+ * a sender streams back to back packets without the TX settling time
+ * write() spends on every payload. Two is the deepest the FIFO can be
+ * filled while its level still tells how many payloads completed since
+ * the last look, so outcomes are exact however late the worker looks.
+ *
+ * While the queue is running the worker owns the radio: call stopListening()
+ * before begin() and do not use the radio from other threads until end().
+ *
+ * Payloads are sent in the order they are queued. The nRF24L01 sends the
+ * whole FIFO to one address, so a payload for another address waits until
+ * the FIFO has drained before the writing pipe is switched.
+ *
+ * Retransmission counts can only be read for the payload at the tail of the
+ * FIFO, as the chip resets ARC_CNT when the next payload starts. Payloads
+ * followed by another one report RF24_TX_RETRIES_UNKNOWN unless they failed.
+ *
+ * @code
+ * RF24TxQueue queue(radio);
+ * radio.stopListening();
+ * queue.begin();
+ * for(int i = 0; i < 3; i++){
+ *   queue.send(actuators[i], &cmd, sizeof(cmd), [](const RF24TxResult& r){
+ *     printf("%s after %d retries\n", r.acked ? "acked" : "failed", r.retries);
+ *   });
+ * }
+ * std::future<RF24TxResult> last = queue.sendAsync(actuators[0], &cmd, sizeof(cmd));
+ * bool ok = last.get().acked;
+ * queue.end();
+ * @endcode
+ */
+class RF24TxQueue
+{
+public:
+
+  typedef std::function<void(const RF24TxResult&)> Callback;
+
+  /**
+   * @param radio Radio to transmit with, already configured
+   */
+  RF24TxQueue(RF24& radio);
+
+  /**
+   * Stops the worker, see end()
+   */
+  ~RF24TxQueue();
+
+  /**
+   * Start the worker thread
+   *
+   * @return False if it is already running
+   */
+  bool begin();
+
+  /**
+   * Send every queued payload, then stop the worker
+   *
+   * The radio is left in standby-I with an empty TX FIFO.
+   */
+  void end();
+
+  /**
+   * Queue a payload, reporting its outcome to a callback
+   *
+   * The callback runs on the worker thread and must not use the radio.
+   *
+   * @param address Writing pipe to send to, 0 for the one currently open
+   * @param buf Payload, copied
+   * @param len Length of the payload, up to 32 bytes
+   * @param callback Called once with the outcome
+   * @param multicast Send without requesting an acknowledgement
+   */
+  void send(uint64_t address, const void* buf, uint8_t len, Callback callback, bool multicast = false);
+
+  /**
+   * Queue a payload, reporting its outcome through a future
+   *
+   * Named apart from send(), which a lambda without captures would
+   * otherwise match as the bool of this one.
+   *
+   * @see send(uint64_t, const void*, uint8_t, Callback, bool)
+   */
+  std::future<RF24TxResult> sendAsync(uint64_t address, const void* buf, uint8_t len, bool multicast = false);
+
+  /**
+   * Wait until every payload queued so far has completed
+   */
+  void flush();
+
+  /**
+   * @return Number of payloads queued or in the TX FIFO
+   */
+  size_t pending();
+
+  /**
+   * Time between two looks at the radio while payloads are in flight
+   *
+   * Below the airtime of one packet, the next payload is loaded before the
+   * one on air completes and the air stays busy. Longer intervals cost
+   * throughput, not accuracy. Default: 100us
+   */
+  void setPollInterval(uint32_t us);
+
+private:
+
+  struct Message
+  {
+    uint64_t address;
+    uint8_t data[32];
+    uint8_t len;
+    bool multicast;
+    Callback callback;
+  };
+
+  RF24& radio;
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable wake; /**< Work was queued or the worker is asked to stop */
+  std::condition_variable idle; /**< Everything queued has completed */
+  std::deque<Message> queue; /**< Waiting for room in the TX FIFO */
+  std::deque<Message> inflight; /**< In the TX FIFO, oldest first (worker only) */
+  uint64_t address; /**< Writing pipe currently open (worker only) */
+  uint32_t pollInterval;
+  size_t outstanding; /**< Queued or in flight */
+  bool running;
+  bool stopping;
+  bool ceHigh;
+
+  void run();
+  void fill();
+  void poll();
+  void complete(size_t count, bool acked, uint8_t retries);
+};
+
+#endif // RF24_LINUX
+
+#endif // __RF24_TX_QUEUE_H__
@@ -163,4 +163,10 @@
   #endif // !defined (ARDUINO) || defined (ESP_PLATFORM) || defined (__arm__) || defined (__ARDUINO_X86__) && !defined (XMEGA)
 #endif //Everything else
 
+// Deadlines sized from the link, see RF24::setTimeoutPolicy(). MINIMAL
+// builds wait 95ms like older releases.
+#if defined (RF24_LINUX) || ( defined (FAILURE_HANDLING) && !defined (MINIMAL) )
+  #define RF24_TX_POLICY
+#endif
+
 #endif // __RF24_CONFIG_H__
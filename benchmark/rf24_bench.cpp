@@ -0,0 +1,360 @@
+/*
+* Driver micro-benchmark: what each public RF24 call costs on the SPI bus
+* (Emulator driver only, built and run by make benchmark).
+*
+* Every call runs against an emulated chip, whose SPI layer counts the
+* transactions, the bytes clocked and the calls that would enter the kernel
+* on a real Linux backend (ioctl, GPIO writes). Each call is timed and
+* counted alone: what it needs beforehand, such as a payload in the RX FIFO
+* or the radio listening, is set up outside the measurement, mostly by a
+* second radio, and the configuration is set back before each call. The
+* suite runs with the register cache off, then on. The write paths wait
+* on the IRQ line (see RF24::setTxWait()), so what they cost doesn't
+* depend on how fast the machine polls.
+*
+* The SPI counts are exact and repeatable, so a run can be checked against
+* the CSV of an earlier one: every call that got more expensive on the bus
+* is reported and the exit status is 1. Wall times include the emulator
+* and the settling delays of the driver, compare them on the same machine.
+*
+* Usage: rf24_bench [--json] [--iterations N] [--output file] [--baseline file.csv]
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <unistd.h>
+#include <fcntl.h>
+#include "../RF24.h"
+#include "../RF24Registers.h"
+#include "../utility/Emulator/medium.h"
+
+using namespace std;
+
+const uint64_t hubAddress = 0xF0F0F0F0E1LL;
+const uint64_t nodeAddress = 0xF0F0F0F0D2LL;
+
+// The radio measured, and a peer on another bus that feeds or drains it
+RF24 radio(26,22);
+RF24 peer(500,600);
+uint8_t payload[32];
+
+/** One public call, with what it needs set up beforehand */
+struct Case
+{
+	const char* name;
+	function<void(int)> prepare; /**< Not measured, may be empty */
+	function<void(int)> call; /**< Measured, once per iteration */
+	bool slow; /**< Sleeps for ms (begin(), powerUp()...), run fewer times */
+};
+
+/** Cost of one call, averaged over the iterations */
+struct Result
+{
+	string name;
+	bool cache;
+	int iterations;
+	double wall_us;
+	double wall_min_us;
+	double transactions;
+	double bytes;
+	double syscalls;
+	double ce_writes;
+};
+
+void configure(RF24& r, uint64_t reading, uint64_t writing)
+{
+	r.setAutoAck(true);
+	r.setDataRate(RF24_1MBPS);
+	r.setPALevel(RF24_PA_HIGH);
+	r.setChannel(76);
+	r.setCRCLength(RF24_CRC_16);
+	r.setRetries(5,15);
+	r.enableDynamicAck();
+	r.openReadingPipe(1, reading);
+	r.openWritingPipe(writing);
+}
+
+void listen()
+{
+	radio.startListening();
+	radio.flush_rx();
+}
+
+// Peer sends @p count payloads to the listening radio
+void feed(int count)
+{
+	listen();
+	peer.stopListening();
+	for(int i = 0; i < count; i++)
+		peer.write(payload, sizeof(payload));
+	peer.startListening();
+}
+
+// Radio ready to send to the listening peer
+void send()
+{
+	radio.stopListening();
+	radio.flush_tx();
+	peer.flush_rx();
+}
+
+// Runs printDetails() and friends without mixing their output with the results
+void quiet(function<void()> f)
+{
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	int null = open("/dev/null", O_WRONLY);
+	dup2(null, STDOUT_FILENO);
+	close(null);
+	f();
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+}
+
+vector<Case> cases()
+{
+	static RF24RadioState state;
+	vector<Case> c;
+	c.push_back({ "isChipConnected", nullptr, [](int){ radio.isChipConnected(); }, false });
+	c.push_back({ "getChannel", nullptr, [](int){ radio.getChannel(); }, false });
+	c.push_back({ "setChannel", nullptr, [](int i){ radio.setChannel(77 + i % 2); }, false });
+	c.push_back({ "setPALevel", nullptr, [](int){ radio.setPALevel(RF24_PA_HIGH); }, false });
+	c.push_back({ "setDataRate", nullptr, [](int){ radio.setDataRate(RF24_1MBPS); }, false });
+	c.push_back({ "setRetries", nullptr, [](int){ radio.setRetries(5,15); }, false });
+	c.push_back({ "setCRCLength", nullptr, [](int){ radio.setCRCLength(RF24_CRC_16); }, false });
+	c.push_back({ "setPayloadSize", nullptr, [](int){ radio.setPayloadSize(32); }, false });
+	c.push_back({ "openReadingPipe", nullptr, [](int){ radio.openReadingPipe(1, hubAddress); }, false });
+	c.push_back({ "openWritingPipe", nullptr, [](int){ radio.openWritingPipe(nodeAddress); }, false });
+	c.push_back({ "startListening", [](int){ radio.stopListening(); }, [](int){ radio.startListening(); }, false });
+	c.push_back({ "stopListening", [](int){ radio.startListening(); }, [](int){ radio.stopListening(); }, false });
+	c.push_back({ "available (empty)", [](int){ listen(); }, [](int){ radio.available(); }, false });
+	c.push_back({ "available", [](int){ feed(1); }, [](int){ radio.available(); }, false });
+	c.push_back({ "available(pipe)", [](int){ feed(1); }, [](int){ uint8_t pipe; radio.available(&pipe); }, false });
+	c.push_back({ "read", [](int){ feed(1); }, [](int){ uint8_t buf[32]; radio.read(buf, sizeof(buf)); }, false });
+	c.push_back({ "readBurst (3)", [](int){ feed(3); }, [](int){ RF24Frame frames[3]; radio.readBurst(frames, 3); }, false });
+	c.push_back({ "rxFifoFull", nullptr, [](int){ radio.rxFifoFull(); }, false });
+	c.push_back({ "testRPD", nullptr, [](int){ radio.testRPD(); }, false });
+	c.push_back({ "flush_rx", nullptr, [](int){ radio.flush_rx(); }, false });
+	c.push_back({ "flush_tx", nullptr, [](int){ radio.flush_tx(); }, false });
+	c.push_back({ "write", [](int){ send(); }, [](int){ radio.write(payload, sizeof(payload)); }, false });
+	c.push_back({ "write (multicast)", [](int){ send(); }, [](int){ radio.write(payload, sizeof(payload), true); }, false });
+	c.push_back({ "writeFast", [](int){ send(); }, [](int){ radio.writeFast(payload, sizeof(payload)); }, false });
+	c.push_back({ "txStandBy", [](int){ send(); radio.writeFast(payload, sizeof(payload)); }, [](int){ radio.txStandBy(); }, false });
+	c.push_back({ "writeBlocking", [](int){ send(); }, [](int){ radio.writeBlocking(payload, sizeof(payload), 100); }, false });
+	c.push_back({ "whatHappened", nullptr, [](int){ bool ok, fail, rx; radio.whatHappened(ok, fail, rx); }, false });
+	c.push_back({ "snapshot", nullptr, [](int){ radio.snapshot(state); }, false });
+	c.push_back({ "holdsState", [](int){ radio.snapshot(state); }, [](int){ radio.holdsState(state); }, false });
+	c.push_back({ "restore", [](int){ radio.snapshot(state); }, [](int){ radio.restore(state); }, false });
+	c.push_back({ "powerDown", [](int){ radio.powerUp(); }, [](int){ radio.powerDown(); }, false });
+	c.push_back({ "powerUp", [](int){ radio.powerDown(); }, [](int){ radio.powerUp(); }, true });
+	c.push_back({ "printDetails", nullptr, [](int){ quiet([](){ radio.printDetails(); }); }, true });
+	// Resets the configuration, the next pass configures the radio again
+	c.push_back({ "begin", nullptr, [](int){ radio.begin(); }, true });
+	return c;
+}
+
+void run(bool cache, int iterations, vector<Result>& results)
+{
+	radio.begin();
+	radio.setTxWait(RF24_WAIT_IRQ);
+	if(cache)
+		radio.enableRegisterCache();
+	else
+		radio.disableRegisterCache();
+
+	NRF24Model* chip = NRF24Model::findBus(22);
+	vector<Case> list = cases();
+	for(size_t k = 0; k < list.size(); k++)
+	{
+		Case& c = list[k];
+		configure(radio, hubAddress, nodeAddress);
+		Result r = { c.name, cache, c.slow ? rf24_min(iterations, 20) : iterations, 0, 1e12, 0, 0, 0, 0 };
+		for(int i = 0; i < r.iterations; i++)
+		{
+			if(c.prepare)
+				c.prepare(i);
+			NRF24Stats before = chip->stats();
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			c.call(i);
+			double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+			NRF24Stats after = chip->stats();
+
+			r.wall_us += us;
+			r.wall_min_us = us < r.wall_min_us ? us : r.wall_min_us;
+			r.transactions += after.transactions - before.transactions;
+			r.bytes += after.bytes - before.bytes;
+			r.syscalls += after.syscalls - before.syscalls;
+			r.ce_writes += after.ce_writes - before.ce_writes;
+		}
+		r.wall_us /= r.iterations;
+		r.transactions /= r.iterations;
+		r.bytes /= r.iterations;
+		r.syscalls /= r.iterations;
+		r.ce_writes /= r.iterations;
+		results.push_back(r);
+	}
+}
+
+void writeCSV(FILE* out, const vector<Result>& results)
+{
+	fprintf(out, "call,cache,iterations,wall_us,wall_min_us,transactions,bytes,syscalls,ce_writes\n");
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(out, "%s,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", r.name.c_str(), r.cache ? "on" : "off",
+		        r.iterations, r.wall_us, r.wall_min_us, r.transactions, r.bytes, r.syscalls, r.ce_writes);
+	}
+}
+
+void writeJSON(FILE* out, const vector<Result>& results)
+{
+	fprintf(out, "{\n  \"driver\": \"Emulator\",\n  \"results\": [\n");
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(out, "    { \"call\": \"%s\", \"cache\": %s, \"iterations\": %d, \"wall_us\": %.2f, \"wall_min_us\": %.2f, "
+		        "\"transactions\": %.2f, \"bytes\": %.2f, \"syscalls\": %.2f, \"ce_writes\": %.2f }%s\n",
+		        r.name.c_str(), r.cache ? "true" : "false", r.iterations, r.wall_us, r.wall_min_us,
+		        r.transactions, r.bytes, r.syscalls, r.ce_writes, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+// Reads the CSV of an earlier run, keyed by call and cache
+bool readBaseline(const char* path, map<string, Result>& baseline)
+{
+	FILE* in = fopen(path, "r");
+	if(!in)
+		return false;
+	char line[256];
+	while(fgets(line, sizeof(line), in))
+	{
+		char name[64], cache[4];
+		Result r;
+		if(sscanf(line, "%63[^,],%3[^,],%d,%lf,%lf,%lf,%lf,%lf,%lf", name, cache, &r.iterations, &r.wall_us,
+		          &r.wall_min_us, &r.transactions, &r.bytes, &r.syscalls, &r.ce_writes) != 9)
+			continue; // Header
+		r.name = name;
+		r.cache = !strcmp(cache, "on");
+		baseline[r.name + "," + cache] = r;
+	}
+	fclose(in);
+	return true;
+}
+
+// A call that waits on the air, such as txStandBy(), sometimes looks at
+// the chip once more, a regression costs at least one more per call
+const double tolerance = 0.5;
+
+// Reports the calls that cost more on the bus than in @p baseline
+int compare(const vector<Result>& results, map<string, Result>& baseline)
+{
+	int regressions = 0;
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		map<string, Result>::iterator b = baseline.find(r.name + "," + ( r.cache ? "on" : "off" ));
+		if(b == baseline.end())
+			continue;
+		const double counts[3] = { r.transactions, r.bytes, r.syscalls };
+		const double before[3] = { b->second.transactions, b->second.bytes, b->second.syscalls };
+		const char* names[3] = { "transactions", "bytes", "syscalls" };
+		for(int k = 0; k < 3; k++)
+		{
+			if(counts[k] > before[k] + tolerance)
+			{
+				fprintf(stderr, "REGRESSION %s (cache %s): %s %.2f -> %.2f\n", r.name.c_str(),
+				        r.cache ? "on" : "off", names[k], before[k], counts[k]);
+				regressions++;
+			}
+			else if(counts[k] < before[k] - tolerance)
+			{
+				fprintf(stderr, "improved   %s (cache %s): %s %.2f -> %.2f\n", r.name.c_str(),
+				        r.cache ? "on" : "off", names[k], before[k], counts[k]);
+			}
+		}
+	}
+	return regressions;
+}
+
+int main(int argc, char** argv)
+{
+	bool json = false;
+	int iterations = 200;
+	const char* output = NULL;
+	const char* baselinePath = NULL;
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--json"))
+			json = true;
+		else if(!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--output") && i + 1 < argc)
+			output = argv[++i];
+		else if(!strcmp(argv[i], "--baseline") && i + 1 < argc)
+			baselinePath = argv[++i];
+		else
+		{
+			fprintf(stderr, "Usage: %s [--json] [--iterations N] [--output file] [--baseline file.csv]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(iterations < 1)
+		iterations = 1;
+
+	// Read before the output, which may overwrite it
+	map<string, Result> baseline;
+	if(baselinePath && !readBaseline(baselinePath, baseline))
+	{
+		fprintf(stderr, "Can't read the baseline %s\n", baselinePath);
+		return 2;
+	}
+
+	NRF24Model::bindPins(22, 26, 27);
+	NRF24Model::bindPins(600, 500);
+	memset(payload, 0x5A, sizeof(payload));
+	radio.attachIrq(27);
+	peer.begin();
+	configure(peer, nodeAddress, hubAddress);
+	peer.startListening();
+
+	vector<Result> results;
+	run(false, iterations, results);
+	run(true, iterations, results);
+
+	FILE* out = output ? fopen(output, "w") : stdout;
+	if(!out)
+	{
+		fprintf(stderr, "Can't write %s\n", output);
+		return 2;
+	}
+	json ? writeJSON(out, results) : writeCSV(out, results);
+	if(output)
+	{
+		fclose(out);
+		// Readable summary, the file holds the details
+		printf("%-18s %5s %10s %13s %8s %9s\n", "call", "cache", "wall_us", "transactions", "bytes", "syscalls");
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const Result& r = results[i];
+			printf("%-18s %5s %10.1f %13.2f %8.2f %9.2f\n", r.name.c_str(), r.cache ? "on" : "off",
+			       r.wall_us, r.transactions, r.bytes, r.syscalls);
+		}
+		printf("Results written to %s\n", output);
+	}
+
+	if(baselinePath)
+	{
+		int regressions = compare(results, baseline);
+		fprintf(stderr, "%d regression%s against %s\n", regressions, regressions == 1 ? "" : "s", baselinePath);
+		return regressions ? 1 : 0;
+	}
+	return 0;
+}
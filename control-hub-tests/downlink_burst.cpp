@@ -0,0 +1,339 @@
+/*
+* Downlink bursts: measures the uplink loss of the hub while it sends bursts
+* of irrigation commands (Emulator driver only).
+*
+* The hub receives ContextTags from emulated in-ground sensors like in
+* virtual_field, while another thread queues a burst of ActuatorCommands
+* through RF24Handle about once a second. One of the actuators
+* is out of reach, so its commands go through every retransmission.
+* Every command sent keeps the hub out of RX, and sensors that give up
+* while it is deaf lose their tag. The sensors share one thread by default,
+* so they never collide with each other and every lost tag is down to the
+* hub being deaf.
+*
+* Every command carries its own number in the timer field. The actuators
+* must get every command the hub reported acked. A command can get through
+* while its ack is destroyed by a sensor's packet: it is then reported
+* failed, or sent again in the next window and received twice, so only as
+* many commands as frames collided may do either. No TX window may keep
+* the hub deaf longer than the window. This is checked for windows with
+* room for an attempt, which every window sends, and when the hub runs
+* with real-time priority, as otherwise the threads of the emulated radios
+* delay it. A probe at the same priority measures how long the host stalls
+* the process, which no window can plan for, and the check allows for it.
+*
+* Usage: downlink_burst [window_us] [sensors] [burst] [seconds]
+* A window of 0 sends each burst at once, compare with the default 15000.
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <pthread.h>
+#include <sched.h>
+#include <RF24/RF24.h>
+#include <RF24/RF24Handle.h>
+#include <RF24/RF24Airtime.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t pipes[6] =
+					{
+					0xF0F0F0F0D2LL, 0xF0F0F0F0E1LL,
+					0xF0F0F0F0E2LL, 0xF0F0F0F0E3LL,
+					0xF0F0F0F0F1, 0xF0F0F0F0F2
+					};
+
+// Actuator addresses, the last one has no radio listening
+const uint64_t actuators[4] = { 0xF0F0F0F0A1LL, 0xF0F0F0F0A2LL, 0xF0F0F0F0A3LL, 0xF0F0F0F0A4LL };
+
+struct ContextTag
+{
+	int moisture;
+	float temperature;
+	int battery;
+};
+
+struct ActuatorCommand
+{
+	bool status;
+	uint16_t timer;
+};
+
+struct VirtualSensor
+{
+	RF24* radio;
+	uint8_t pip;
+	unsigned long timer;
+	unsigned long sent;
+	unsigned long failed;
+};
+
+const int SENSORS_PER_THREAD = 10;
+
+vector<VirtualSensor> sensors;
+atomic<bool> running(true);
+unsigned long period = 1000;
+
+// Command numbers reported acked by the hub and received by the actuators
+mutex commands;
+set<uint16_t> acked;
+set<uint16_t> commanded;
+unsigned long duplicates = 0;
+
+void configureRadio(RF24& radio)
+{
+	radio.setAutoAck(true);
+	radio.setDataRate(RF24_250KBPS);
+	radio.setPALevel(RF24_PA_HIGH);
+	radio.setChannel(76);
+	radio.setCRCLength(RF24_CRC_16);
+	radio.setRetries(5,15); // 5*250us delay with 15 retries
+}
+
+// MMSimulator setup() and loop() for sensors [first, last)
+void sensorThread(size_t first, size_t last)
+{
+	for(size_t i = first; i < last; i++)
+	{
+		RF24& radio = *sensors[i].radio;
+		radio.begin();
+		configureRadio(radio);
+		// Every emulated radio shares the host CPU: a sensor spinning on
+		// STATUS would delay the hub, which a real sensor can't
+		radio.setTxWait(RF24_WAIT_BACKOFF);
+		radio.openReadingPipe(1, pipes[5]);
+		radio.openWritingPipe(pipes[2]);
+		radio.startListening();
+		sensors[i].timer = millis() - rand() % period;
+	}
+
+	while(running)
+	{
+		bool idle = true;
+		for(size_t i = first; i < last && running; i++)
+		{
+			VirtualSensor& s = sensors[i];
+			if((millis() - s.timer) <= period)
+				continue;
+
+			struct ContextTag tag;
+			tag.moisture = rand() % 100;
+			tag.temperature = rand() % 100;
+			tag.battery = rand() % 100;
+
+			s.radio->stopListening();
+			s.radio->openWritingPipe(pipes[s.pip]);
+			if(s.radio->write(&tag, sizeof(tag)))
+				s.sent++;
+			else
+				s.failed++;
+			s.radio->startListening();
+
+			s.pip += 1;
+			s.pip == 5 ? s.pip = 2 : s.pip = s.pip;
+			s.timer = millis();
+			idle = false;
+		}
+		if(idle)
+			delay(1);
+	}
+}
+
+// Drains what the hub sent to the reachable actuators, false if nothing
+bool drainActuators(vector<RF24*>& radios)
+{
+	bool any = false;
+	for(size_t i = 0; i < radios.size(); i++)
+	{
+		RF24Frame frames[3];
+		if(!radios[i]->available())
+			continue;
+		size_t n = radios[i]->readBurst(frames, 3);
+		lock_guard<mutex> guard(commands);
+		for(size_t k = 0; k < n; k++)
+		{
+			ActuatorCommand cmd;
+			memcpy(&cmd, frames[k].data, sizeof(cmd));
+			if(!commanded.insert(cmd.timer).second)
+				duplicates++;
+		}
+		any = true;
+	}
+	return any;
+}
+
+void actuatorThread(vector<RF24*>* radios)
+{
+	while(running)
+	{
+		if(!drainActuators(*radios))
+			delay(1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t window = argc > 1 ? strtoul(argv[1], NULL, 10) : 15000;
+	int count = argc > 2 ? atoi(argv[2]) : 10;
+	int burst = argc > 3 ? atoi(argv[3]) : 12;
+	unsigned long seconds = argc > 4 ? strtoul(argv[4], NULL, 10) : 10;
+
+	RF24 hub(26,22);
+	NRF24Model::bindPins(22, 26, 27);
+	vector<RF24*> reachable;
+	for(int i = 0; i < 3; i++)
+	{
+		reachable.push_back(new RF24(500 + i, 600 + i));
+		NRF24Model::bindPins(600 + i, 500 + i);
+	}
+	for(int i = 0; i < count; i++)
+	{
+		VirtualSensor s = { new RF24(1000 + i, 2000 + i), 2, 0, 0, 0 };
+		NRF24Model::bindPins(2000 + i, 1000 + i);
+		sensors.push_back(s);
+	}
+
+	hub.begin();
+	configureRadio(hub);
+	hub.maskIRQ(1,1,0);
+	hub.attachIrq(27);
+	for(uint8_t i=1; i<6; i++)
+		hub.openReadingPipe(i, pipes[i]);
+	hub.openWritingPipe(pipes[0]);
+	hub.startListening();
+
+	for(size_t i = 0; i < reachable.size(); i++)
+	{
+		reachable[i]->begin();
+		configureRadio(*reachable[i]);
+		reachable[i]->openReadingPipe(1, actuators[i]);
+		reachable[i]->startListening();
+	}
+
+	RF24Handle handle(hub);
+	handle.setTxWindow(window);
+
+	printf("Downlink bursts: %d sensors, %d commands about every second, TX window %u us, %lu s\n",
+	       count, burst, window, seconds);
+
+	vector<thread> threads;
+	threads.push_back(thread(actuatorThread, &reachable));
+	for(size_t first = 0; first < sensors.size(); first += SENSORS_PER_THREAD)
+	{
+		size_t last = first + SENSORS_PER_THREAD;
+		threads.push_back(thread(sensorThread, first, last < sensors.size() ? last : sensors.size()));
+	}
+	// Irrigation scheduler, queues a burst of commands for every actuator
+	threads.push_back(thread([&](){
+		uint16_t number = 0;
+		while(running)
+		{
+			for(int i = 0; i < burst; i++)
+			{
+				struct ActuatorCommand cmd = { true, number++ };
+				handle.send(actuators[i % 4], &cmd, sizeof(cmd), RF24Handle::Callback([cmd](const RF24TxResult& r){
+					if(r.acked)
+					{
+						lock_guard<mutex> guard(commands);
+						acked.insert(cmd.timer);
+					}
+				}));
+			}
+			// Bursts come about once a second, out of step with the sensors
+			delay(500 + rand() % 1000);
+		}
+	}));
+
+	// The hub stands for a device of its own: the emulated sensors and
+	// actuators share the host CPU with it and must not delay it
+	sched_param param;
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+	bool realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+	atomic<uint32_t> stall(0);
+	threads.push_back(thread([&](){
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		while(running)
+		{
+			uint32_t before = micros();
+			delayMicroseconds(200);
+			uint32_t late = micros() - before - 200;
+			if(late > stall)
+				stall = late;
+		}
+	}));
+
+	handle.resetStats();
+	NRF24Medium::resetStats();
+	unsigned long received = 0;
+	unsigned long start = millis();
+	while(millis() - start < seconds * 1000)
+	{
+		RF24Frame frames[3];
+		received += handle.receive(frames, 3, 100);
+	}
+	RF24HandleStats hs = handle.stats();
+
+	running = false;
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	// Whatever the actuators still hold was received too
+	delay(2);
+	while(drainActuators(reachable));
+
+	unsigned long sent = 0, failed = 0;
+	for(size_t i = 0; i < sensors.size(); i++)
+	{
+		sent += sensors[i].sent;
+		failed += sensors[i].failed;
+	}
+
+	printf("Uplink          : %lu tags received, sensors %lu acked, %lu failed (%.1f%% lost)\n",
+	       received, sent, failed, sent + failed ? 100.0 * failed / (sent + failed) : 0);
+	printf("Downlink        : %llu commands sent, %llu failed, %zu received by actuators, %lu twice\n",
+	       (unsigned long long) handle.sent(), (unsigned long long) handle.failed(), commanded.size(), duplicates);
+	printf("Hub             : listening %.1f%%, deaf %.1f ms in %llu windows, longest %.1f ms, %llu deferred\n",
+	       100.0 * hs.listening_us / (hs.listening_us + hs.deaf_us), hs.deaf_us / 1000.0,
+	       (unsigned long long) hs.windows, hs.longest_window_us / 1000.0, (unsigned long long) hs.deferred);
+	printf("Host            : stalled the process up to %.1f ms\n", stall / 1000.0);
+
+	int failures = 0;
+	RF24Airtime command(RF24_250KBPS, 5, RF24_CRC_16, hub.getPayloadSize(), 5, 15);
+	if(!realtime)
+		printf("Not checking the TX window, the hub could not run with real-time priority\n");
+	else if(window && window < RF24Airtime::settle_us + 2 * command.attemptUs())
+		printf("Not checking the TX window, it has no room for an attempt\n");
+	else if(window && hs.longest_window_us > window + stall)
+	{
+		printf("FAIL: a TX window kept the hub deaf longer than %u us\n", window);
+		failures++;
+	}
+	size_t unacked = 0;
+	for(set<uint16_t>::iterator it = commanded.begin(); it != commanded.end(); ++it)
+		unacked += !acked.count(*it);
+	if(!includes(commanded.begin(), commanded.end(), acked.begin(), acked.end()))
+	{
+		printf("FAIL: commands reported acked did not reach the actuators\n");
+		failures++;
+	}
+	if(unacked + duplicates > NRF24Medium::stats().collided)
+	{
+		printf("FAIL: %zu commands unacked and %lu received twice, more than frames collided\n", unacked, duplicates);
+		failures++;
+	}
+
+	for(size_t i = 0; i < sensors.size(); i++)
+		delete sensors[i].radio;
+	for(size_t i = 0; i < reachable.size(); i++)
+		delete reachable[i];
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+* Handle producers: checks the lock-free submission queue of RF24Handle
+* with several threads submitting at once (Emulator driver only).
+*
+* Producer threads submit numbered commands through submit() as fast as
+* they can, while the owner thread applies them with receive(). Each
+* command records its producer and number when it runs. Every producer's
+* commands must run once each, none lost, and in the order that producer
+* submitted them. The commands of the producers must have interleaved, or
+* they did not run at the same time. Every producer also sends multicast
+* payloads in the stream, half through sendAsync() and half through send()
+* with a lambda: each must be reported once, sent.
+*
+* Usage: handle_producers [producers] [commands]
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/RF24Handle.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t hub = 0xF0F0F0F0E1LL;
+const uint64_t nobody = 0xF0F0F0F0A4LL;
+const int payloads = 8; // Per producer
+
+// Written by the owner thread only, read once the producers are done
+vector< vector<int> > ran; // Command numbers of each producer, in the order they ran
+vector<int> reported; // Payload outcomes of each producer
+vector<int> sentOk;
+int switches = 0; // Commands that ran after one of another producer
+int last = -1;
+atomic<int> started(0);
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+void produce(RF24Handle& handle, int p, int commands, vector< future<RF24TxResult> >& futures)
+{
+	started++;
+	while(started.load() < (int) ran.size())
+		this_thread::yield();
+
+	uint8_t data[8] = { (uint8_t) p };
+	for(int i = 0; i < commands; i++)
+	{
+		handle.submit([p, i](RF24&){
+			ran[p].push_back(i);
+			switches += last != p;
+			last = p;
+		});
+		// Give the others and the owner a turn, even on a single CPU
+		if(i % 16 == 0)
+			this_thread::yield();
+		if(i % ( commands / payloads ) != 0)
+			continue;
+		if(i / ( commands / payloads ) % 2)
+			futures.push_back(handle.sendAsync(nobody, data, sizeof(data), true));
+		else
+			handle.send(nobody, data, sizeof(data), [p](const RF24TxResult& r){
+				reported[p]++;
+				sentOk[p] += r.acked;
+			}, true);
+	}
+}
+
+bool allRan(int commands)
+{
+	for(size_t p = 0; p < ran.size(); p++)
+		if((int) ran[p].size() < commands)
+			return false;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int producers = argc > 1 ? atoi(argv[1]) : 4;
+	int commands = argc > 2 ? atoi(argv[2]) : 20000;
+	if(producers < 1 || commands < payloads)
+	{
+		printf("Usage: handle_producers [producers] [commands]\n");
+		return 1;
+	}
+
+	RF24 radio(26, 22);
+	NRF24Model::bindPins(22, 26);
+	radio.begin();
+	radio.setPayloadSize(8);
+	radio.enableDynamicAck(); // For the multicast payloads
+	radio.openReadingPipe(1, hub);
+	radio.startListening();
+	RF24Handle handle(radio);
+	ran.resize(producers);
+	reported.resize(producers);
+	sentOk.resize(producers);
+	for(int p = 0; p < producers; p++)
+		ran[p].reserve(commands);
+
+	printf("%d producers, %d commands each\n", producers, commands);
+	vector<thread> threads;
+	vector< vector< future<RF24TxResult> > > futures(producers);
+	for(int p = 0; p < producers; p++)
+		threads.push_back(thread(produce, ref(handle), p, commands, ref(futures[p])));
+
+	// Owner: apply until every command ran and every payload was sent
+	uint32_t start = millis();
+	RF24Frame frames[3];
+	while(!allRan(commands) || handle.sent() < (uint64_t) producers * payloads)
+	{
+		handle.receive(frames, 3, 0);
+		if(millis() - start > 60000)
+		{
+			check(false, "the owner did not apply every submission within a minute");
+			break;
+		}
+	}
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	handle.process();
+
+	for(int p = 0; p < producers; p++)
+	{
+		bool ordered = (int) ran[p].size() == commands;
+		for(int i = 0; ordered && i < commands; i++)
+			ordered = ran[p][i] == i;
+		check(ordered, "commands of a producer lost, duplicated or out of order");
+
+		int sent = sentOk[p];
+		for(size_t i = 0; i < futures[p].size(); i++)
+			sent += futures[p][i].wait_for(chrono::seconds(0)) == future_status::ready && futures[p][i].get().acked;
+		check(reported[p] + (int) futures[p].size() == payloads && sent == payloads, "payloads of a producer not reported once each, sent");
+	}
+	check(handle.pending() == 0, "submissions left in the queue");
+	printf("Commands of another producer than the previous one: %d\n", switches);
+	check(switches > producers, "the producers never submitted at the same time");
+	check(handle.sent() == (uint64_t) producers * payloads && handle.failed() == 0, "payloads sent by the handle");
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
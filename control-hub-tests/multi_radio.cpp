@@ -0,0 +1,265 @@
+/*
+* Multi radio hub: runs one control-hub RX loop per radio, each in its own
+* thread, against a field of emulated in-ground sensors (Emulator driver only).
+*
+* The hub radios listen on different channels and the sensors are spread
+* evenly over them, so every radio only sees its share of the traffic. With
+* a saturating load the number of tags received should grow with the number
+* of radios, as long as each RF24 instance keeps its own bus state and the
+* hub threads don't wait on each other.
+*
+* Each tag carries the number of its sensor in place of the moisture. A
+* hub radio must only receive tags from the sensors on its channel, and at
+* least as many as those sensors got acks for.
+*
+* Usage: multi_radio [radios] [sensors] [period_ms] [seconds]
+* Run it with 1, 2 and 3 radios and the same load to compare.
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t pipes[6] =
+					{
+					0xF0F0F0F0D2LL, 0xF0F0F0F0E1LL,
+					0xF0F0F0F0E2LL, 0xF0F0F0F0E3LL,
+					0xF0F0F0F0F1, 0xF0F0F0F0F2
+					};
+
+const uint8_t channels[3] = { 76, 86, 96 };
+
+struct ContextTag
+{
+	int moisture;
+	float temperature;
+	int battery;
+};
+
+struct HubRadio
+{
+	RF24* radio;
+	int irq;
+	uint8_t channel;
+	unsigned long received;
+	unsigned long bursts;
+	unsigned long foreign; // Tags from sensors on another channel
+};
+
+struct VirtualSensor
+{
+	RF24* radio;
+	uint8_t channel;
+	uint8_t pip;
+	unsigned long timer;
+	unsigned long sent;
+	unsigned long failed;
+};
+
+const int SENSORS_PER_THREAD = 25;
+
+vector<HubRadio> hubs;
+vector<VirtualSensor> sensors;
+atomic<bool> running(true);
+atomic<bool> listening(true);
+unsigned long period = 8000;
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+void configureRadio(RF24& radio, uint8_t channel)
+{
+	radio.setAutoAck(true);
+	radio.setDataRate(RF24_250KBPS);
+	radio.setPALevel(RF24_PA_HIGH);
+	radio.setChannel(channel);
+	radio.setCRCLength(RF24_CRC_16);
+	radio.setRetries(5,15); // 5*250us delay with 15 retries
+}
+
+// Same RX loop as control-hub/main.cpp, one per hub radio
+void hubThread(HubRadio* hub)
+{
+	while(listening)
+	{
+		RF24Frame frames[3];
+		size_t n = (hub->radio->waitForEvent(100) & _BV(RX_DR)) ? hub->radio->readBurst(frames, 3) : 0;
+		for(size_t i = 0; i < n; i++)
+		{
+			struct ContextTag tag;
+			memcpy(&tag, frames[i].data, sizeof(tag));
+			if(tag.moisture < 0 || tag.moisture >= (int) sensors.size() || sensors[tag.moisture].channel != hub->channel)
+				hub->foreign++;
+		}
+		hub->received += n;
+		hub->bursts += n > 0;
+	}
+}
+
+// MMSimulator setup() and loop() for sensors [first, last)
+void sensorThread(size_t first, size_t last)
+{
+	for(size_t i = first; i < last; i++)
+	{
+		RF24& radio = *sensors[i].radio;
+		radio.begin();
+		configureRadio(radio, sensors[i].channel);
+		radio.openReadingPipe(1, pipes[5]);
+		radio.openWritingPipe(pipes[2]);
+		radio.startListening();
+		// Spread the first transmission over one period
+		sensors[i].timer = millis() - rand() % period;
+	}
+
+	while(running)
+	{
+		bool idle = true;
+		for(size_t i = first; i < last && running; i++)
+		{
+			VirtualSensor& s = sensors[i];
+			if((millis() - s.timer) <= period)
+				continue;
+
+			struct ContextTag tag;
+			tag.moisture = i;
+			tag.temperature = rand() % 100;
+			tag.battery = rand() % 100;
+
+			s.radio->stopListening();
+			s.radio->openWritingPipe(pipes[s.pip]);
+			if(s.radio->write(&tag, sizeof(tag)))
+				s.sent++;
+			else
+				s.failed++;
+			s.radio->startListening();
+
+			s.pip += 1;
+			s.pip == 5 ? s.pip = 2 : s.pip = s.pip;
+			s.timer = millis();
+			idle = false;
+		}
+		if(idle)
+			delay(1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int radios = argc > 1 ? atoi(argv[1]) : 3;
+	int count = argc > 2 ? atoi(argv[2]) : 150;
+	period = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000;
+	unsigned long seconds = argc > 4 ? strtoul(argv[4], NULL, 10) : 10;
+	if(radios < 1 || radios > 3)
+	{
+		printf("Between 1 and 3 hub radios\n");
+		return 1;
+	}
+
+	// Hub radio k has CE 100+k, CSN 200+k and IRQ 300+k, sensors get their own CE/CSN numbers
+	for(int k = 0; k < radios; k++)
+	{
+		HubRadio h = { new RF24(100 + k, 200 + k), 300 + k, channels[k], 0, 0, 0 };
+		NRF24Model::bindPins(200 + k, 100 + k, 300 + k);
+		hubs.push_back(h);
+	}
+	for(int i = 0; i < count; i++)
+	{
+		VirtualSensor s = { new RF24(1000 + i, 2000 + i), channels[i % radios], 2, 0, 0, 0 };
+		NRF24Model::bindPins(2000 + i, 1000 + i);
+		sensors.push_back(s);
+	}
+
+	for(size_t k = 0; k < hubs.size(); k++)
+	{
+		RF24& radio = *hubs[k].radio;
+		radio.begin();
+		configureRadio(radio, channels[k]);
+		radio.maskIRQ(1,1,0);
+		radio.attachIrq(hubs[k].irq);
+		for(uint8_t i=1; i<6; i++)
+			radio.openReadingPipe(i, pipes[i]);
+		radio.openWritingPipe(pipes[0]);
+		radio.startListening();
+	}
+
+	printf("Multi radio hub: %d radios, %d sensors, one tag every %lu ms each, %lu s\n",
+	       radios, count, period, seconds);
+
+	NRF24Medium::resetStats();
+
+	vector<thread> threads;
+	for(size_t k = 0; k < hubs.size(); k++)
+		threads.push_back(thread(hubThread, &hubs[k]));
+	for(size_t first = 0; first < sensors.size(); first += SENSORS_PER_THREAD)
+	{
+		size_t last = first + SENSORS_PER_THREAD;
+		threads.push_back(thread(sensorThread, first, last < sensors.size() ? last : sensors.size()));
+	}
+
+	delay(seconds * 1000);
+
+	running = false;
+	for(size_t i = hubs.size(); i < threads.size(); i++)
+		threads[i].join();
+	// Let the hubs drain what is still in flight
+	delay(100);
+	listening = false;
+	for(size_t i = 0; i < hubs.size(); i++)
+		threads[i].join();
+
+	unsigned long sent = 0, failed = 0, total = 0;
+	for(size_t i = 0; i < sensors.size(); i++)
+	{
+		sent += sensors[i].sent;
+		failed += sensors[i].failed;
+	}
+
+	printf("Offered load    : %.1f tags/s\n", (double) count * 1000 / period);
+	printf("Sensors         : %lu acked, %lu failed (MAX_RT)\n", sent, failed);
+	for(size_t k = 0; k < hubs.size(); k++)
+	{
+		NRF24Stats hs;
+		{
+			NRF24Lock lock;
+			hs = NRF24Model::findBus(200 + k)->stats();
+		}
+		unsigned long acked = 0;
+		for(size_t i = 0; i < sensors.size(); i++)
+			acked += sensors[i].channel == channels[k] ? sensors[i].sent : 0;
+		printf("Radio %u ch %3u  : %lu tags in %lu bursts (%lu acked), %llu dropped while full, %llu SPI transactions\n",
+		       (unsigned) k, channels[k], hubs[k].received, hubs[k].bursts, acked,
+		       (unsigned long long) hs.rx_dropped, (unsigned long long) hs.transactions);
+		check(hubs[k].foreign == 0, "a hub radio received tags from another channel");
+		check(hubs[k].received >= acked, "a hub radio received fewer tags than its sensors got acks for");
+		total += hubs[k].received;
+	}
+	printf("Hub received    : %lu tags (%.1f/s)\n", total, total / (double) seconds);
+
+	NRF24MediumStats ms = NRF24Medium::stats();
+	printf("Air             : %llu frames, %llu acks, %llu collided, %llu lost, %llu duplicates\n",
+	       (unsigned long long) ms.frames, (unsigned long long) ms.acks, (unsigned long long) ms.collided,
+	       (unsigned long long) ms.lost, (unsigned long long) ms.duplicates);
+
+	for(size_t i = 0; i < sensors.size(); i++)
+		delete sensors[i].radio;
+	for(size_t k = 0; k < hubs.size(); k++)
+		delete hubs[k].radio;
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+/*
+* Payload widths: checks that the per-pipe widths of the driver and the
+* RX_PW registers of the chip agree whichever of setPayloadSize(pipe, size)
+* and setPayloadSize(size) comes last (Emulator driver only).
+*
+* read_payload() pads or truncates to the width the driver keeps for the
+* pipe in STATUS, the chip to its RX_PW register. Pipe 1 is given a width
+* of its own, then every pipe one width, and the other way round. After
+* each, the widths read back, the RX_PW registers on the emulated chip and
+* the payloads a second radio sends to pipes 1 and 2 must all match. The
+* emulated chip, like the real one, drops a static payload whose width
+* differs from RX_PW.
+*
+* Usage: payload_widths
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <RF24/RF24.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t hub = 0xF0F0F0F0E1LL;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+// The driver and the chip agree on @p widths[pipe] for every pipe
+void agree(RF24& radio, int csn, const uint8_t* widths)
+{
+	bool driver = true, chip = true;
+	NRF24Lock lock;
+	NRF24Model* model = NRF24Model::findBus(csn);
+	for(uint8_t pipe = 0; pipe < 6; pipe++)
+	{
+		driver = driver && radio.getPayloadSize(pipe) == widths[pipe];
+		chip = chip && model->reg(RX_PW_P0 + pipe) == widths[pipe];
+	}
+	check(driver, "getPayloadSize() does not return the width set");
+	check(chip, "RX_PW on the chip differs from the width of the driver");
+}
+
+// A payload sent at @p width to @p pipe is acked and reads back whole
+void receive(RF24& sender, RF24& receiver, uint8_t pipe, uint8_t width)
+{
+	uint8_t sent[32];
+	for(uint8_t i = 0; i < 32; i++)
+		sent[i] = pipe * 40 + i;
+	sender.openWritingPipe(hub + pipe - 1, width);
+	check(sender.write(sent, width), "payload not acked, RX_PW differs from its width");
+
+	uint8_t got[32];
+	uint8_t from = 0xFF;
+	check(receiver.available(&from) && from == pipe, "payload not received on its pipe");
+	memset(got, 0, sizeof(got));
+	receiver.read(got, sizeof(got));
+	check(memcmp(got, sent, width) == 0, "payload differs");
+	check(!receiver.available(), "payloads left in the RX FIFO");
+}
+
+int main()
+{
+	RF24 radio(26, 22);
+	RF24 sender(36, 32);
+	NRF24Model::bindPins(22, 26);
+	NRF24Model::bindPins(32, 36);
+	radio.begin();
+	sender.begin();
+	sender.stopListening();
+	radio.openReadingPipe(1, hub);
+	radio.openReadingPipe(2, hub + 1);
+	radio.startListening();
+
+	printf("Pipe width, then every pipe\n");
+	radio.setPayloadSize(1, 8);
+	radio.setPayloadSize(16);
+	const uint8_t same[6] = { 16, 16, 16, 16, 16, 16 };
+	agree(radio, 22, same);
+	receive(sender, radio, 1, 16);
+	receive(sender, radio, 2, 16);
+
+	printf("Every pipe, then pipe width\n");
+	radio.setPayloadSize(12);
+	radio.setPayloadSize(1, 4);
+	const uint8_t mixed[6] = { 12, 4, 12, 12, 12, 12 };
+	agree(radio, 22, mixed);
+	receive(sender, radio, 1, 4);
+	receive(sender, radio, 2, 12);
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/*
+* Radio recovery: how long the hub stays deaf when its radio resets
+* (Emulator driver only).
+*
+* The hub receives ContextTags from emulated in-ground sensors while its
+* radio browns out about once a second: every register goes back to its
+* reset value and the radio powers down. The hub notices with
+* holdsState(), then recovers either from the snapshot taken after
+* configuration, or the way it used to with begin() and the profile.
+* Recovery time and the tags lost around it are reported for both.
+*
+* After every recovery a new snapshot must match the one taken after
+* configuration, registers, addresses and driver side alike. Only the
+* registers the chip changes by itself, NRF_STATUS, OBSERVE_TX, RPD and
+* FIFO_STATUS, may differ. There must be one recovery per brown-out.
+*
+* Usage: radio_recovery [restore|begin] [sensors] [seconds]
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/RF24Registers.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t pipes[6] =
+					{
+					0xF0F0F0F0D2LL, 0xF0F0F0F0E1LL,
+					0xF0F0F0F0E2LL, 0xF0F0F0F0E3LL,
+					0xF0F0F0F0F1, 0xF0F0F0F0F2
+					};
+
+struct ContextTag
+{
+	int moisture;
+	float temperature;
+	int battery;
+};
+
+atomic<bool> running(true);
+atomic<unsigned long> sent(0), failed(0);
+int failures = 0;
+
+// Registers the chip changes by itself, not part of the configuration
+const uint32_t volatileRegisters = 1UL << NRF_STATUS | 1UL << OBSERVE_TX | 1UL << RPD | 1UL << FIFO_STATUS;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+RF24RadioProfile hubProfile()
+{
+	RF24RadioProfile profile;
+	profile.data_rate = RF24_250KBPS;
+	profile.pa_level = RF24_PA_HIGH;
+	profile.irq_mask = _BV(MASK_TX_DS) | _BV(MASK_MAX_RT);
+	profile.reading_pipes = 0x3E;
+	for(uint8_t i=1; i<6; i++)
+		profile.reading_addresses[i] = pipes[i];
+	profile.writing_address = pipes[0];
+	return profile;
+}
+
+// In-ground sensors sharing one thread, a tag every 100ms each
+void sensorThread(vector<RF24*>* radios)
+{
+	RF24RadioProfile profile = hubProfile();
+	profile.reading_pipes = 0x02;
+	profile.reading_addresses[1] = pipes[5];
+	for(size_t i = 0; i < radios->size(); i++)
+	{
+		(*radios)[i]->begin();
+		profile.writing_address = pipes[2 + i % 3];
+		(*radios)[i]->apply(profile);
+	}
+	while(running)
+	{
+		for(size_t i = 0; i < radios->size(); i++)
+		{
+			struct ContextTag tag = { rand() % 100, (float)(rand() % 100), rand() % 100 };
+			if((*radios)[i]->write(&tag, sizeof(tag)))
+				sent++;
+			else
+				failed++;
+		}
+		delay(100);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool fast = argc < 2 || strcmp(argv[1], "begin");
+	int count = argc > 2 ? atoi(argv[2]) : 3;
+	unsigned long seconds = argc > 3 ? strtoul(argv[3], NULL, 10) : 10;
+
+	RF24 hub(26,22);
+	NRF24Model::bindPins(22, 26);
+	vector<RF24*> sensors;
+	for(int i = 0; i < count; i++)
+	{
+		sensors.push_back(new RF24(1000 + i, 2000 + i));
+		NRF24Model::bindPins(2000 + i, 1000 + i);
+	}
+
+	const RF24RadioProfile profile = hubProfile();
+	hub.begin();
+	hub.apply(profile);
+	hub.startListening();
+	RF24RadioState state;
+	hub.snapshot(state);
+
+	printf("Radio recovery: %s, %d sensors, a brown-out about every second, %lu s\n",
+	       fast ? "restore() from a snapshot" : "begin() and apply()", count, seconds);
+
+	thread sensor(sensorThread, &sensors);
+
+	unsigned long received = 0, recoveries = 0, mismatches = 0;
+	uint64_t totalUs = 0;
+	uint32_t longestUs = 0;
+	unsigned long start = millis(), nextFault = start + 500 + rand() % 1000;
+	while(millis() - start < seconds * 1000)
+	{
+		if(millis() >= nextFault)
+		{
+			NRF24Model::lock();
+			NRF24Model::findBus(22)->powerOnReset();
+			NRF24Model::unlock();
+			nextFault = millis() + 500 + rand() % 1000;
+		}
+
+		// What the hub's failure detection does, a single SPI batch
+		if(!hub.holdsState(state))
+		{
+			uint32_t t = micros();
+			if(!fast || !hub.restore(state))
+			{
+				hub.begin();
+				hub.apply(profile);
+				hub.startListening();
+			}
+			uint32_t us = micros() - t;
+			recoveries++;
+			totalUs += us;
+			if(us > longestUs)
+				longestUs = us;
+
+			RF24RadioState after;
+			hub.snapshot(after);
+			if(after.diff(state) & ~volatileRegisters)
+			{
+				if(!mismatches)
+				{
+					char text[256];
+					state.formatDiff(after, text, sizeof(text));
+					printf("  After recovery: %s\n", text);
+				}
+				mismatches++;
+			}
+		}
+
+		uint8_t buf[32];
+		while(hub.available())
+		{
+			hub.read(buf, sizeof(ContextTag));
+			received++;
+		}
+		delay(1);
+	}
+	running = false;
+	sensor.join();
+
+	printf("Recoveries      : %lu, %.2f ms on average, longest %.2f ms\n",
+	       recoveries, recoveries ? totalUs / 1000.0 / recoveries : 0, longestUs / 1000.0);
+	printf("Uplink          : %lu tags received, sensors %lu acked, %lu failed (%.1f%% lost)\n",
+	       received, (unsigned long) sent, (unsigned long) failed,
+	       sent + failed ? 100.0 * failed / (sent + failed) : 0);
+
+	printf("Register state  : %lu of %lu recoveries differ from the snapshot\n", mismatches, recoveries);
+	check(mismatches == 0, "the radio does not hold the snapshot after recovery");
+	check(recoveries >= seconds / 2 && recoveries <= seconds * 2, "one recovery per brown-out expected");
+
+	for(size_t i = 0; i < sensors.size(); i++)
+		delete sensors[i];
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
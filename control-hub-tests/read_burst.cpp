@@ -0,0 +1,109 @@
+/*
+* Read burst: checks that readBurst() returns a payload that arrives while
+* it drains the RX FIFO (Emulator driver only).
+*
+* readBurst() reads the FIFO speculatively, all in one SPI batch that ends
+* by clearing RX_DR. The emulated chip is made to receive a payload right
+* after one of the reads of the batch found the FIFO empty, so that a later
+* read pops it. That payload must be among the frames returned, with the
+* right pipe and data, since the RX_DR clear leaves no other trace of it.
+* This runs with static and with dynamic payloads, with the FIFO holding a
+* payload or none before the burst, and with the payload arriving between
+* the width and payload reads of a dynamic payload.
+*
+* Usage: read_burst
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <RF24/RF24.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t hub = 0xF0F0F0F0E1LL;
+
+NRF24Model* target = NULL; // Radio the hook delivers to
+uint8_t armedOn = 0; // Command after which it delivers, 0 once done
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+// A payload arrives right after a read of @p armedOn found the FIFO empty
+void arrive(NRF24Model& radio, uint8_t cmd, uint8_t status)
+{
+	if(&radio != target || cmd != armedOn || (( status >> RX_P_NO ) & 0x07) != 0x07)
+		return;
+	uint8_t late[7] = { 'l', 'a', 't', 'e', 2, 2, 2 };
+	radio.inject(2, late, sizeof(late));
+	armedOn = 0;
+}
+
+void run(RF24& radio, const char* name, bool holding, uint8_t after, uint8_t lateLength)
+{
+	printf("%s\n", name);
+	uint8_t early[5] = { 'e', 'a', 'r', 'l', 'y' };
+	{
+		NRF24Lock lock;
+		if(holding)
+			target->inject(1, early, sizeof(early));
+		armedOn = after;
+	}
+
+	RF24Frame frames[3];
+	memset(frames, 0, sizeof(frames));
+	size_t n = radio.readBurst(frames, 3);
+	size_t expected = holding ? 2 : 1;
+	check(armedOn == 0, "the payload was not delivered during the burst");
+	check(n == expected, "readBurst() lost the payload that arrived during the burst");
+	if(n == expected)
+	{
+		if(holding)
+			check(frames[0].pipe == 1 && memcmp(frames[0].data, early, sizeof(early)) == 0, "first frame differs");
+		const RF24Frame& late = frames[expected - 1];
+		check(late.pipe == 2 && late.length == lateLength && memcmp(late.data, "late", 4) == 0, "late frame differs");
+	}
+	check(!radio.available(), "payloads left in the RX FIFO");
+	armedOn = 0;
+}
+
+int main()
+{
+	RF24 radio(26, 22);
+	NRF24Model::bindPins(22, 26);
+	radio.begin();
+	radio.setPayloadSize(7);
+	radio.openReadingPipe(1, hub);
+	radio.openReadingPipe(2, hub + 1);
+	radio.startListening();
+	target = NRF24Model::findBus(22);
+	{
+		NRF24Lock lock;
+		NRF24Model::setTransferHook(arrive);
+	}
+
+	run(radio, "Static payloads, FIFO holding one", true, R_RX_PAYLOAD, 7);
+	run(radio, "Static payloads, FIFO empty", false, R_RX_PAYLOAD, 7);
+
+	radio.enableDynamicPayloads();
+	run(radio, "Dynamic payloads, FIFO holding one", true, R_RX_PAYLOAD, 7);
+	run(radio, "Dynamic payloads, FIFO empty", false, R_RX_PAYLOAD, 7);
+	run(radio, "Dynamic payloads, between width and payload", true, R_RX_PL_WID, 32);
+
+	{
+		NRF24Lock lock;
+		NRF24Model::setTransferHook(NULL);
+	}
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
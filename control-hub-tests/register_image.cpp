@@ -0,0 +1,156 @@
+/*
+* Register image: checks that a configuration composed with
+* RF24RegisterImage::with() reaches the chip as composed (Emulator driver
+* only).
+*
+* The registers begin() leaves are read with readRegisters(), several
+* fields of the same registers are changed with with(), and the image goes
+* back with writeRegisters(). Reading the registers again, and looking at
+* the emulated chip itself, must give the image back byte for byte. get()
+* on each field must return what it was set to, the fields next to it must
+* keep their value, and the driver must follow the new data rate, PA level,
+* channel and CRC. The same runs with the register cache enabled. Last, a
+* radio set up only through an image must reach one set up with the setters.
+*
+* Usage: register_image
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <RF24/RF24.h>
+#include <RF24/RF24Registers.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t actuator = 0xF0F0F0F0A1LL;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+// Composing fields of one register one by one, or all at once, is the same
+static_assert(RF24RegisterImage::reset().with(RF24Reg::SetupRetr::Ard(3)).with(RF24Reg::SetupRetr::Arc(7)).get(SETUP_RETR)
+              == RF24Reg::retries(3, 7).value, "with() on one field changed the other");
+static_assert(RF24Reg::SetupRetr::Arc::get(RF24RegisterImage::reset().with(RF24Reg::SetupRetr::Ard(9)).get(SETUP_RETR)) == 3,
+              "with() on ARD changed ARC");
+
+// The image the tests write: begin()'s registers with fields of
+// NRF_CONFIG, SETUP_RETR, RF_SETUP, RF_CH and RX_PW_P2 changed
+RF24RegisterImage composed(const RF24RegisterImage& current)
+{
+	return current
+		.with(RF24Reg::crc(RF24_CRC_8) | RF24Reg::Config::MaskTxDs(1) | RF24Reg::Config::MaskMaxRt(1))
+		.with(RF24Reg::SetupRetr::Ard(3))
+		.with(RF24Reg::SetupRetr::Arc(7))
+		.with(RF24Reg::dataRate(RF24_250KBPS) | RF24Reg::paLevel(RF24_PA_LOW))
+		.with(RF24Reg::RfCh::Channel(90))
+		.with(RF24Reg::RxPw<2>::Width(12));
+}
+
+void roundTrip(RF24& radio, int csn, const char* name)
+{
+	printf("%s\n", name);
+	RF24RegisterImage before, after;
+	radio.readRegisters(before);
+	check(before.get(SETUP_RETR) == RF24Reg::retries(5, 15).value && before.get(RF_CH) == 76,
+	      "readRegisters() does not return what begin() wrote");
+
+	RF24RegisterImage image = composed(before);
+	radio.writeRegisters(image);
+	radio.readRegisters(after);
+	bool same = true, chip = true;
+	{
+		NRF24Lock lock;
+		for(uint8_t i = 0; i < RF24RegisterImage::count; i++)
+		{
+			same = same && after.values[i] == image.values[i];
+			chip = chip && NRF24Model::findBus(csn)->reg(RF24RegisterImage::reg(i)) == image.values[i];
+		}
+	}
+	check(same, "readRegisters() does not return the image written");
+	check(chip, "the chip does not hold the image written");
+
+	uint8_t config = after.get(NRF_CONFIG);
+	check(RF24Reg::Config::EnCrc::get(config) == 1 && RF24Reg::Config::Crco::get(config) == 0, "CRC fields of NRF_CONFIG");
+	check(RF24Reg::Config::MaskTxDs::get(config) == 1 && RF24Reg::Config::MaskMaxRt::get(config) == 1
+	      && RF24Reg::Config::MaskRxDr::get(config) == 0, "IRQ mask fields of NRF_CONFIG");
+	check(RF24Reg::Config::PwrUp::get(config) == RF24Reg::Config::PwrUp::get(before.get(NRF_CONFIG)),
+	      "PWR_UP changed with the other fields of NRF_CONFIG");
+	uint8_t retr = after.get(SETUP_RETR);
+	check(RF24Reg::SetupRetr::Ard::get(retr) == 3 && RF24Reg::SetupRetr::Arc::get(retr) == 7, "fields of SETUP_RETR");
+	uint8_t setup = after.get(RF_SETUP);
+	check(RF24Reg::RfSetup::RfDrLow::get(setup) == 1 && RF24Reg::RfSetup::RfDrHigh::get(setup) == 0, "data rate fields of RF_SETUP");
+	check(RF24Reg::RfSetup::RfPwr::get(setup) == RF24_PA_LOW, "RF_PWR field of RF_SETUP");
+	check(RF24Reg::RfSetup::LnaHcurr::get(setup) == 1, "paLevel() does not set the LNA bit like setPALevel()");
+	check(RF24Reg::RfSetup::ContWave::get(setup) == RF24Reg::RfSetup::ContWave::get(before.get(RF_SETUP))
+	      && RF24Reg::RfSetup::PllLock::get(setup) == RF24Reg::RfSetup::PllLock::get(before.get(RF_SETUP)),
+	      "CONT_WAVE or PLL_LOCK changed with the other fields of RF_SETUP");
+	check(RF24Reg::RfCh::Channel::get(after.get(RF_CH)) == 90, "RF_CH");
+	check(RF24Reg::RxPw<2>::Width::get(after.get(RX_PW_P2)) == 12 && after.get(RX_PW_P1) == before.get(RX_PW_P1),
+	      "RX_PW of pipe 2 only");
+	check(after.get(EN_AA) == before.get(EN_AA) && after.get(SETUP_AW) == before.get(SETUP_AW)
+	      && after.get(FEATURE) == before.get(FEATURE), "registers left out of the composition changed");
+
+	check(radio.getDataRate() == RF24_250KBPS && radio.getPALevel() == RF24_PA_LOW, "the driver's data rate or PA level");
+	check(radio.getChannel() == 90 && radio.getCRCLength() == RF24_CRC_8, "the driver's channel or CRC length");
+}
+
+// A radio configured only with writeRegisters() against one configured
+// with the setters
+void overTheAir(RF24& sender, RF24& receiver)
+{
+	printf("Image to setters, over the air\n");
+	RF24RegisterImage current;
+	sender.readRegisters(current);
+	sender.writeRegisters(current.with(RF24Reg::crc(RF24_CRC_16)).with(RF24Reg::retries(5, 15)));
+	sender.stopListening();
+	sender.openWritingPipe(actuator);
+
+	receiver.setDataRate(RF24_250KBPS);
+	receiver.setPALevel(RF24_PA_LOW);
+	receiver.setChannel(90);
+	receiver.setCRCLength(RF24_CRC_16);
+	receiver.openReadingPipe(1, actuator);
+	receiver.startListening();
+
+	uint8_t data[32] = { 42 };
+	check(sender.write(data, sizeof(data)), "payload from the image configured radio not acked");
+	uint8_t got[32] = { 0 };
+	check(receiver.available(), "payload not received");
+	receiver.read(got, sizeof(got));
+	check(got[0] == 42, "payload differs");
+	receiver.stopListening();
+}
+
+int main()
+{
+	RF24 plain(26, 22);
+	RF24 cached(36, 32);
+	RF24 receiver(500, 600);
+	NRF24Model::bindPins(22, 26);
+	NRF24Model::bindPins(32, 36);
+	NRF24Model::bindPins(600, 500);
+
+	plain.begin();
+	roundTrip(plain, 22, "readRegisters(), with(), writeRegisters()");
+	cached.enableRegisterCache();
+	cached.begin();
+	roundTrip(cached, 32, "Same with the register cache");
+	check(cached.verifyRegisterCache(false), "the register cache does not match the chip");
+
+	receiver.begin();
+	overTheAir(plain, receiver);
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
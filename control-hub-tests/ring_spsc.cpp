@@ -0,0 +1,142 @@
+/*
+* Ring SPSC: checks RF24Ring with a producer and a consumer thread
+* (Emulator driver only).
+*
+* The producer pushes numbered frames, each filled with a pattern of its
+* number, while the consumer pops them. The ring is small so that it wraps
+* thousands of times and fills up. First the producer pushes a frame again
+* until the ring takes it: the consumer must get every frame once, in
+* order and whole. Then it drops the frames the ring refuses, as the
+* control hub does: the consumer must get the others in order, and the
+* frames it got and those dropped must add up to the frames pushed. The
+* counters of stats() must agree with both threads.
+*
+* Usage: ring_spsc [frames]
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/RF24Ring.h>
+
+using namespace std;
+
+const uint32_t capacity = 64;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+// Frame @p n, with data a pattern of n so that a torn copy shows
+void fill(RF24Frame& frame, uint32_t n)
+{
+	frame.pipe = n % 6;
+	frame.length = 32;
+	frame.timestamp = n;
+	for(uint8_t i = 0; i < sizeof(frame.data); i++)
+		frame.data[i] = (uint8_t)( n * 31 + i );
+}
+
+bool whole(const RF24Frame& frame)
+{
+	RF24Frame expected;
+	fill(expected, frame.timestamp);
+	return frame.pipe == expected.pipe && frame.length == expected.length
+	       && memcmp(frame.data, expected.data, sizeof(frame.data)) == 0;
+}
+
+void run(const char* name, uint32_t count, bool retry)
+{
+	printf("%s\n", name);
+	RF24Ring<RF24Frame, capacity> ring;
+	atomic<bool> done(false);
+	uint64_t refused = 0, dropped = 0;
+
+	thread producer([&](){
+		RF24Frame frame;
+		for(uint32_t n = 0; n < count; n++)
+		{
+			fill(frame, n);
+			while(!ring.push(frame))
+			{
+				refused++;
+				if(!retry)
+				{
+					dropped++;
+					break;
+				}
+				this_thread::yield();
+			}
+			// Give the consumer a turn, even on a single CPU
+			if(n % 256 == 0)
+				this_thread::yield();
+		}
+		done = true;
+	});
+
+	// Consumer
+	uint64_t received = 0;
+	bool ordered = true, intact = true;
+	int64_t last = -1;
+	RF24Frame frame;
+	for(;;)
+	{
+		bool finished = done.load();
+		bool any = false;
+		while(ring.pop(frame))
+		{
+			any = true;
+			received++;
+			intact = intact && whole(frame);
+			// With retries every number follows the last, without them it may skip
+			ordered = ordered && ( retry ? (int64_t) frame.timestamp == last + 1 : (int64_t) frame.timestamp > last );
+			last = frame.timestamp;
+			// Now and then let the producer run ahead and fill the ring
+			if(received % 1024 == 0)
+				this_thread::yield();
+		}
+		if(finished && !any)
+			break;
+		if(!any)
+			this_thread::yield();
+	}
+	producer.join();
+
+	RF24RingStats s = ring.stats();
+	printf("  %u pushed, %llu received, %llu refused, high water %u\n", count, (unsigned long long) received,
+	       (unsigned long long) refused, s.high_water);
+	check(intact, "a frame came out torn");
+	check(ordered, "frames out of order or duplicated");
+	check(received + dropped == count, "frames lost");
+	check(s.pushed == received && s.popped == received, "pushed or popped counters differ from the frames received");
+	check(s.dropped == refused, "dropped counter differs from the pushes refused");
+	check(s.high_water <= capacity && ring.size() == 0, "the ring held more than its capacity or kept frames");
+	check(refused > 0 && s.high_water == capacity, "the ring never filled up");
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+	if(count == 0)
+	{
+		printf("Usage: ring_spsc [frames]\n");
+		return 1;
+	}
+
+	run("Producer retrying until the ring takes the frame", count, true);
+	run("Producer dropping the frames the ring refuses", count, false);
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+/*
+* Static profile: checks that RF24Static sends and receives through the
+* write and read paths it inherits from RF24 (Emulator driver only).
+*
+* An RF24Static<RF24ProfileIrri> exchanges ContextTags with a plain RF24
+* configured the same way, with write(), writeFast() and read(), typed
+* and untyped. A second pair checks a profile with dynamic payloads. The
+* payloads must arrive whole and in order, short ones padded to the width
+* of the profile, and the SPI traffic of RF24Static must be the one of RF24.
+* readBurst() must return the frames with the width of the profile.
+*
+* Built with -DOVERSIZED_PAYLOAD, it writes a struct larger than the
+* profile allows and must not compile, see the Makefile.
+*
+* Usage: static_profile
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <RF24/RF24.h>
+#include <RF24/RF24Static.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t hub = 0xF0F0F0F0E1LL;
+const uint64_t sensor = 0xF0F0F0F0D2LL;
+
+struct ContextTag
+{
+	int moisture;
+	float temperature;
+	int battery;
+};
+
+typedef RF24Profile<8, true> RF24ProfileShort;
+
+// The profile is in the type, not in the object
+static_assert(sizeof(RF24Static<RF24ProfileIrri>) == sizeof(RF24), "RF24Static adds to the size of RF24");
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+void configureRadio(RF24& radio)
+{
+	radio.setAutoAck(true);
+	radio.setPALevel(RF24_PA_HIGH);
+	radio.setChannel(76);
+	radio.setRetries(5,15);
+}
+
+// Waits for a payload on the listening radio
+bool arrived(RF24& radio)
+{
+	uint32_t start = millis();
+	while(!radio.available())
+	{
+		if(millis() - start > 100)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+void sensorToHub(RF24Static<RF24ProfileIrri>& sender, RF24& receiver)
+{
+	printf("RF24Static<RF24ProfileIrri> to RF24\n");
+	sender.stopListening();
+	sender.openWritingPipe(hub);
+	receiver.openReadingPipe(1, hub);
+	receiver.startListening();
+
+	ContextTag tag = { 42, 21.5, 90 };
+	check(sender.write(tag), "typed write() not acked");
+	uint8_t raw[32];
+	memset(raw, 0xAA, sizeof(raw));
+	check(arrived(receiver), "typed write() not received");
+	receiver.read(raw, sizeof(raw));
+	check(memcmp(raw, &tag, sizeof(tag)) == 0, "typed write() payload differs");
+	bool padded = true;
+	for(size_t i = sizeof(tag); i < sizeof(raw); i++)
+		padded = padded && raw[i] == 0;
+	check(padded, "a short payload is not padded with zeros");
+
+	// Three in a row through the TX FIFO
+	for(int i = 0; i < 3; i++)
+	{
+		tag.battery = i;
+		check(sender.writeFast(&tag, sizeof(tag)), "writeFast() failed");
+	}
+	check(sender.txStandBy(), "writeFast() payloads not acked");
+	for(int i = 0; i < 3; i++)
+	{
+		ContextTag got = { 0, 0, -1 };
+		check(arrived(receiver), "writeFast() payload not received");
+		receiver.read(&got, sizeof(got));
+		check(got.battery == i, "writeFast() payloads out of order");
+	}
+	check(sender.getTxStats().payloads == 4 && sender.getTxStats().failed == 0, "TX stats don't count the payloads");
+	receiver.stopListening();
+}
+
+void hubToSensor(RF24& sender, RF24Static<RF24ProfileIrri>& receiver)
+{
+	printf("RF24 to RF24Static<RF24ProfileIrri>\n");
+	sender.stopListening();
+	sender.openWritingPipe(sensor);
+	receiver.openReadingPipe(1, sensor);
+	receiver.startListening();
+
+	ContextTag tag = { 7, 3.5, 11 };
+	check(sender.write(&tag, sizeof(tag)), "write() to RF24Static not acked");
+	ContextTag got = { 0, 0, 0 };
+	check(arrived(receiver), "payload not available on RF24Static");
+	receiver.read(got);
+	check(memcmp(&got, &tag, sizeof(tag)) == 0, "typed read() payload differs");
+	check(!receiver.available(), "typed read() left the payload in the RX FIFO");
+
+	check(sender.write(&tag, sizeof(tag)), "write() to RF24Static not acked");
+	check(arrived(receiver), "payload not available on RF24Static");
+	memset(&got, 0, sizeof(got));
+	receiver.read(&got, sizeof(got));
+	check(memcmp(&got, &tag, sizeof(tag)) == 0, "read() payload differs");
+
+	for(int i = 0; i < 2; i++)
+	{
+		tag.battery = i;
+		check(sender.write(&tag, sizeof(tag)), "write() to RF24Static not acked");
+	}
+	RF24Frame frames[3];
+	size_t n = receiver.readBurst(frames, 3);
+	check(n == 2, "readBurst() on RF24Static missed payloads");
+	for(size_t i = 0; i < n; i++)
+	{
+		memcpy(&got, frames[i].data, sizeof(got));
+		check(frames[i].length == RF24ProfileIrri::payload_size && got.battery == (int) i, "readBurst() frame differs");
+	}
+	receiver.stopListening();
+}
+
+// Same payloads through RF24 and RF24Static: same SPI traffic. Only
+// writeFast() into a FIFO with room, waits depend on timing.
+void sameTraffic(RF24& plain, RF24Static<RF24ProfileIrri>& fixed, RF24& receiver)
+{
+	printf("SPI traffic of RF24 and RF24Static\n");
+	receiver.openReadingPipe(1, hub);
+	receiver.startListening();
+	ContextTag tag = { 1, 2, 3 };
+	NRF24Stats bus[2];
+	for(int k = 0; k < 2; k++)
+	{
+		RF24& radio = k ? fixed : plain;
+		radio.stopListening();
+		radio.openWritingPipe(hub);
+		NRF24Model::findBus(k ? 22 : 32)->resetStats();
+		for(int i = 0; i < 2; i++)
+		{
+			// RF24Static's own writeFast(), not RF24's through the reference
+			if(k)
+				fixed.writeFast(&tag, sizeof(tag));
+			else
+				plain.writeFast(&tag, sizeof(tag));
+		}
+		bus[k] = NRF24Model::findBus(k ? 22 : 32)->stats();
+		radio.txStandBy();
+		RF24Frame frames[3];
+		while(arrived(receiver))
+			receiver.readBurst(frames, 3);
+	}
+	check(bus[0].transactions == bus[1].transactions && bus[0].bytes == bus[1].bytes,
+	      "RF24Static does not go through the same SPI transactions");
+	receiver.stopListening();
+}
+
+void dynamicProfile(RF24Static<RF24ProfileShort>& sender, RF24& receiver)
+{
+	printf("RF24Static<RF24Profile<8, true>> to RF24\n");
+	sender.stopListening();
+	sender.openWritingPipe(hub);
+	receiver.openReadingPipe(1, hub);
+	receiver.startListening();
+
+	uint8_t data[5] = { 1, 2, 3, 4, 5 };
+	check(sender.write(&data, sizeof(data)), "dynamic write() not acked");
+	check(arrived(receiver), "dynamic payload not received");
+	check(receiver.getDynamicPayloadSize() == sizeof(data), "dynamic payload length differs");
+	uint8_t got[8] = { 0 };
+	receiver.read(got, sizeof(got));
+	check(memcmp(got, data, sizeof(data)) == 0, "dynamic payload differs");
+
+	// Longer than the profile: cut to its width
+	uint8_t longer[12] = { 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9 };
+	check(sender.write(&longer, sizeof(longer)), "long dynamic write() not acked");
+	check(arrived(receiver), "long dynamic payload not received");
+	check(receiver.getDynamicPayloadSize() == RF24ProfileShort::payload_size, "a payload longer than the profile is not cut");
+	receiver.read(got, sizeof(got));
+	receiver.stopListening();
+}
+
+int main()
+{
+	RF24Static<RF24ProfileIrri> fixed(26, 22);
+	RF24 plain(36, 32);
+	RF24 receiver(500, 600);
+	RF24Static<RF24ProfileShort> shortSender(46, 42);
+	RF24 shortReceiver(510, 610);
+	NRF24Model::bindPins(22, 26);
+	NRF24Model::bindPins(32, 36);
+	NRF24Model::bindPins(600, 500);
+	NRF24Model::bindPins(42, 46);
+	NRF24Model::bindPins(610, 510);
+
+	// RF24ProfileIrri: 250kbps, CRC16, 5 byte addresses, 32 byte static payloads
+	check(fixed.begin(), "RF24Static begin() failed");
+	configureRadio(fixed);
+	plain.begin();
+	configureRadio(plain);
+	plain.setDataRate(RF24_250KBPS);
+	receiver.begin();
+	configureRadio(receiver);
+	receiver.setDataRate(RF24_250KBPS);
+
+	check(shortSender.begin(), "RF24Static begin() failed");
+	configureRadio(shortSender);
+	shortSender.setChannel(90);
+	shortReceiver.begin();
+	configureRadio(shortReceiver);
+	shortReceiver.setChannel(90);
+	shortReceiver.setDataRate(RF24_250KBPS);
+	shortReceiver.enableDynamicPayloads();
+
+	sensorToHub(fixed, receiver);
+	hubToSensor(receiver, fixed);
+	sameTraffic(plain, fixed, receiver);
+	dynamicProfile(shortSender, shortReceiver);
+
+#if defined (OVERSIZED_PAYLOAD)
+	struct Oversized { uint8_t data[33]; } oversized;
+	fixed.write(oversized);
+#endif
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/*
+* Timing jitter: measures how accurately delayMicroseconds() hits the waits
+* RF24 relies on (CE pulse, PLL settling, txDelay, csDelay), with the
+* hybrid sleep/spin delay and with plain sleeping for comparison.
+* No radio is needed.
+*
+* Usage: timing_jitter [iterations] [spin_threshold_us]
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <RF24/RF24.h>
+
+using namespace std;
+
+const uint32_t waits[] = { 5, 10, 130, 250, 1000, 5000 };
+
+// Overshoot of delayMicroseconds(us) in microseconds, sorted
+vector<double> measure(uint32_t us, int iterations)
+{
+	vector<double> late;
+	for(int i = 0; i < iterations; i++)
+	{
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		delayMicroseconds(us);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double elapsed = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+		late.push_back(elapsed - us);
+	}
+	sort(late.begin(), late.end());
+	return late;
+}
+
+void report(const char* mode, int iterations)
+{
+	printf("%-7s %7s %9s %9s %9s %9s %9s\n", mode, "wait", "min", "mean", "p50", "p99", "max");
+	for(size_t w = 0; w < sizeof(waits) / sizeof(waits[0]); w++)
+	{
+		vector<double> late = measure(waits[w], iterations);
+		double sum = 0;
+		for(size_t i = 0; i < late.size(); i++)
+			sum += late[i];
+		printf("%-7s %5uus %7.1fus %7.1fus %7.1fus %7.1fus %7.1fus\n", "", waits[w],
+		       late.front(), sum / late.size(), late[late.size() / 2],
+		       late[late.size() * 99 / 100], late.back());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 500;
+	if(argc > 2)
+		rf24_set_spin_threshold(strtoul(argv[2], NULL, 10));
+	uint32_t threshold = rf24_spin_threshold();
+
+	printf("Overshoot of delayMicroseconds() over %d runs, spin threshold %u us\n\n", iterations, threshold);
+	report("hybrid", iterations);
+
+	printf("\n");
+	rf24_set_spin_threshold(0);
+	report("sleep", iterations);
+
+	rf24_set_spin_threshold(threshold);
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+* TX queue: checks the outcome RF24TxQueue reports for every payload
+* against what the receiver got, and measures its throughput against
+* write() (Emulator driver only).
+*
+* Every payload carries its number. The callbacks must come in the order
+* the payloads were queued, and the payloads reported acked must be the
+* ones the receiver got, each once and in order. This is checked with
+* a receiver that keeps up, with payloads to an address nobody listens
+* on in the middle of the stream, and with a receiver whose RX FIFO
+* fills up so that a payload fails with another one behind it. When the
+* receiver already holds a payload, two complete and the third retries
+* between two looks of a slow poll. Each case runs with a poll interval
+* shorter and much longer than a packet. The throughput run reports the
+* last payload through the future of sendAsync().
+*
+* Usage: tx_queue
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <RF24/RF24.h>
+#include <RF24/RF24TxQueue.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t actuator = 0xF0F0F0F0A1LL;
+const uint64_t nobody = 0xF0F0F0F0A4LL;
+
+RF24 sender(26,22);
+RF24 receiver(500,600);
+
+mutex results;
+vector<int> reported; // Payload numbers, in callback order
+vector<int> acked;
+vector<int> received;
+atomic<bool> draining(false);
+atomic<bool> running(true);
+int failures = 0;
+
+void configureRadio(RF24& radio)
+{
+	radio.setAutoAck(true);
+	radio.setDataRate(RF24_1MBPS);
+	radio.setChannel(76);
+	radio.setCRCLength(RF24_CRC_16);
+	radio.setRetries(5,15);
+}
+
+void drain()
+{
+	RF24Frame frames[3];
+	size_t n = receiver.readBurst(frames, 3);
+	lock_guard<mutex> guard(results);
+	for(size_t i = 0; i < n; i++)
+		received.push_back(frames[i].data[0]);
+}
+
+void receiverThread()
+{
+	while(running)
+	{
+		if(draining && receiver.available())
+			drain();
+		else
+			delayMicroseconds(100);
+	}
+}
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+// Queues @p count payloads, numbered from 0, to the addresses @p to gives.
+// Unless @p drained, the receiver gets @p held payloads before them.
+void run(const char* name, uint32_t interval, int count, uint64_t (*to)(int), bool drained, int held = 0)
+{
+	reported.clear();
+	acked.clear();
+	draining = drained;
+	uint8_t filler[32] = { 0xFF };
+	sender.openWritingPipe(actuator);
+	for(int i = 0; i < held; i++)
+		sender.write(filler, sizeof(filler));
+	received.clear();
+
+	RF24TxQueue queue(sender);
+	queue.setPollInterval(interval);
+	// Queued before the worker starts, so that it fills the FIFO at once
+	for(int i = 0; i < count; i++)
+	{
+		uint8_t data[32] = { (uint8_t) i };
+		queue.send(to(i), data, sizeof(data), RF24TxQueue::Callback([i](const RF24TxResult& r){
+			lock_guard<mutex> guard(results);
+			reported.push_back(i);
+			if(r.acked)
+				acked.push_back(i);
+		}));
+	}
+	queue.begin();
+	queue.flush();
+	queue.end();
+
+	// Whatever the receiver holds was received too
+	draining = false;
+	delay(2);
+	while(receiver.available())
+		drain();
+
+	lock_guard<mutex> guard(results);
+	received.erase(remove(received.begin(), received.end(), 0xFF), received.end());
+	printf("%-22s poll %5u us: %2d sent, %2zu acked, %2zu received\n", name, interval, count, acked.size(), received.size());
+	bool ordered = (int) reported.size() == count;
+	for(size_t i = 0; ordered && i < reported.size(); i++)
+		ordered = reported[i] == (int) i;
+	check(ordered, "callbacks out of order or missing");
+	check(acked == received, "payloads reported acked are not the ones received");
+}
+
+uint64_t toActuator(int) { return actuator; }
+uint64_t someToNobody(int i) { return i == 5 || i == 13 ? nobody : actuator; }
+
+double throughput(bool queued, int count)
+{
+	received.clear();
+	draining = true;
+	uint8_t data[32] = { 0 };
+	uint32_t start = micros();
+	if(queued)
+	{
+		RF24TxQueue queue(sender);
+		queue.begin();
+		for(int i = 0; i < count - 1; i++)
+			queue.send(actuator, data, sizeof(data), [](const RF24TxResult&){});
+		future<RF24TxResult> last = queue.sendAsync(actuator, data, sizeof(data));
+		check(last.get().acked, "the last payload was not acked");
+		queue.flush();
+		queue.end();
+	}
+	else
+	{
+		sender.openWritingPipe(actuator);
+		for(int i = 0; i < count; i++)
+			sender.write(data, sizeof(data));
+	}
+	return count * 1e6 / ( micros() - start );
+}
+
+int main()
+{
+	NRF24Model::bindPins(22, 26);
+	NRF24Model::bindPins(600, 500);
+	sender.begin();
+	configureRadio(sender);
+	sender.stopListening();
+	receiver.begin();
+	configureRadio(receiver);
+	receiver.openReadingPipe(1, actuator);
+	receiver.startListening();
+	thread rx(receiverThread);
+
+	printf("TX queue outcomes against the receiver\n");
+	const uint32_t intervals[2] = { 100, 5000 };
+	for(int k = 0; k < 2; k++)
+	{
+		run("stream", intervals[k], 30, toActuator, true);
+		run("MAX_RT mid-stream", intervals[k], 20, someToNobody, true);
+		run("receiver RX FIFO full", intervals[k], 6, toActuator, false);
+		check(acked.size() == 3, "an empty RX FIFO should take 3 payloads");
+		run("receiver holding one", intervals[k], 6, toActuator, false, 1);
+		check(acked.size() == 2, "an RX FIFO holding one payload should take 2");
+	}
+
+	const int count = 300;
+	double write = throughput(false, count);
+	double queued = throughput(true, count);
+	printf("Throughput, %d payloads of 32 bytes at 1Mbps: write() %.0f/s, RF24TxQueue %.0f/s\n", count, write, queued);
+	check(queued > write * 1.1, "the queue should stream at least 10% faster than write()");
+
+	running = false;
+	rx.join();
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
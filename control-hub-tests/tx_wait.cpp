@@ -0,0 +1,172 @@
+/*
+* TX wait strategies: what each wait strategy of the write paths costs on
+* the SPI bus (Emulator driver only).
+*
+* A sender writes ActuatorCommands to a receiver that drains them, one in
+* every ten to an address nobody listens on, so that some writes go through
+* every retransmission. The same run is repeated with write() and with
+* writeFast() and txStandBy() for each strategy of setTxWait(). The SPI
+* accesses the driver counted, the transactions the emulated chip saw and
+* the time per payload delivered are reported for each.
+*
+* Every strategy must deliver and fail the same payloads, and backing off
+* and waiting on the IRQ pin must take fewer SPI accesses per payload than
+* spinning. A TX_DS that the IRQ wait clears must still be reported by
+* whatHappened().
+*
+* Usage: tx_wait [payloads]
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t actuator = 0xF0F0F0F0A1LL;
+const uint64_t nobody = 0xF0F0F0F0A4LL;
+
+struct ActuatorCommand
+{
+	bool status;
+	uint16_t timer;
+};
+
+atomic<bool> running(true);
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+void configureRadio(RF24& radio)
+{
+	radio.setAutoAck(true);
+	radio.setDataRate(RF24_250KBPS);
+	radio.setPALevel(RF24_PA_HIGH);
+	radio.setChannel(76);
+	radio.setCRCLength(RF24_CRC_16);
+	radio.setRetries(5,15); // 5*250us delay with 15 retries
+}
+
+// Drains the receiver so that its RX FIFO never fills
+void actuatorThread(RF24* radio)
+{
+	while(running)
+	{
+		RF24Frame frames[3];
+		if(radio->available())
+			radio->readBurst(frames, 3);
+		else
+			delay(1);
+	}
+}
+
+RF24TxStats run(RF24& sender, rf24_tx_wait_e wait, bool stream, int payloads)
+{
+	static const char* names[] = { "spin", "backoff", "irq" };
+	ActuatorCommand cmd = { true, 60 };
+
+	sender.setTxWait(wait);
+	sender.resetTxStats();
+	NRF24Model::findBus(22)->resetStats();
+	uint32_t start = micros();
+
+	for(int i = 0; i < payloads; i++)
+	{
+		sender.openWritingPipe(i % 10 == 9 ? nobody : actuator);
+		if(!stream)
+		{
+			sender.write(&cmd, sizeof(cmd));
+			continue;
+		}
+		sender.writeFast(&cmd, sizeof(cmd));
+		if(!sender.txStandBy())
+			sender.flush_tx();
+	}
+
+	uint32_t elapsed = micros() - start;
+	RF24TxStats s = sender.getTxStats();
+	NRF24Stats bus = NRF24Model::findBus(22)->stats();
+	uint32_t delivered = s.payloads > s.failed ? s.payloads - s.failed : 1;
+	printf("%-10s %-8s %8u %8u %8u %12.1f %12.1f %10.1f\n",
+	       stream ? "writeFast" : "write", names[wait], s.payloads, s.failed, s.waits,
+	       (float) s.spi / delivered, (float) bus.transactions / delivered,
+	       (float) elapsed / delivered);
+	return s;
+}
+
+// A payload acked, then one that fails while txStandBy() waits on the IRQ
+// pin: the wait clears the TX_DS of the first, whatHappened() must tell
+void clearedTxDs(RF24& sender)
+{
+	ActuatorCommand cmd = { true, 60 };
+	bool tx_ok, tx_fail, rx_ready;
+	sender.setTxWait(RF24_WAIT_IRQ);
+	sender.whatHappened(tx_ok, tx_fail, rx_ready);
+
+	sender.openWritingPipe(actuator);
+	sender.writeFast(&cmd, sizeof(cmd));
+	delay(20);
+	sender.openWritingPipe(nobody);
+	sender.writeFast(&cmd, sizeof(cmd));
+	check(!sender.txStandBy(), "a payload to nobody was acked");
+	sender.flush_tx();
+	sender.whatHappened(tx_ok, tx_fail, rx_ready);
+	check(tx_ok, "whatHappened() lost the TX_DS the IRQ wait cleared");
+}
+
+int main(int argc, char** argv)
+{
+	int payloads = argc > 1 ? atoi(argv[1]) : 200;
+
+	RF24 sender(26,22);
+	RF24 receiver(500,600);
+	NRF24Model::bindPins(22, 26, 27);
+	NRF24Model::bindPins(600, 500);
+
+	sender.begin();
+	configureRadio(sender);
+	sender.attachIrq(27);
+	sender.stopListening();
+
+	receiver.begin();
+	configureRadio(receiver);
+	receiver.openReadingPipe(1, actuator);
+	receiver.startListening();
+
+	thread actuators(actuatorThread, &receiver);
+
+	printf("TX wait strategies: %d payloads, 1 in 10 unacked, 250kbps, 15 retries\n", payloads);
+	printf("%-10s %-8s %8s %8s %8s %12s %12s %10s\n",
+	       "path", "wait", "payloads", "failed", "waits", "spi/payload", "chip/payload", "us/payload");
+	for(int stream = 0; stream < 2; stream++)
+	{
+		RF24TxStats s[3];
+		for(int wait = RF24_WAIT_SPIN; wait <= RF24_WAIT_IRQ; wait++)
+			s[wait] = run(sender, (rf24_tx_wait_e) wait, stream, payloads);
+		for(int wait = RF24_WAIT_BACKOFF; wait <= RF24_WAIT_IRQ; wait++)
+		{
+			check(s[wait].payloads == s[RF24_WAIT_SPIN].payloads && s[wait].failed == s[RF24_WAIT_SPIN].failed,
+			      "wait strategies disagree on the payloads delivered");
+			check(s[wait].spi < s[RF24_WAIT_SPIN].spi, "waiting takes no fewer SPI accesses than spinning");
+		}
+		check(s[RF24_WAIT_SPIN].failed == (uint32_t) payloads / 10, "not every payload to nobody failed");
+	}
+	clearedTxDs(sender);
+
+	running = false;
+	actuators.join();
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
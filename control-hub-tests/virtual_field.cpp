@@ -0,0 +1,237 @@
+/*
+* Virtual field: runs the control-hub RX loop against hundreds of emulated
+* in-ground sensors in a single process (Emulator driver only).
+*
+* Every sensor follows in-ground-sensors/MMSimulator.cpp: it listens on the
+* broadcast pipe and, once per period, sends a ContextTag to one of the
+* ControlHub pipes 2-4. The hub runs the loop of control-hub/main.cpp.
+* All radios share the virtual RF medium, so ACK timing, retransmissions,
+* collisions and RX FIFO overflows at the hub behave like on air.
+*
+* The hub must receive at least as many tags as the sensors got acks for,
+* on pipes 2-4 only, and read every payload its RX FIFO stored. A tag whose
+* ack was destroyed or lost reaches the hub without the sensor knowing, so
+* the hub may receive more tags than were acked, by at most as many frames
+* as collided or were lost. Retransmissions must not be received twice.
+*
+* Usage: virtual_field [sensors] [period_ms] [seconds] [loss] [latency_us]
+* Raise the number of sensors or lower the period until the hub saturates.
+* Exits with 1 if any check fails.
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <RF24/RF24.h>
+#include <RF24/nRF24L01.h>
+#include <RF24/utility/Emulator/medium.h>
+
+using namespace std;
+
+const uint64_t pipes[6] =
+					{
+					0xF0F0F0F0D2LL, 0xF0F0F0F0E1LL,
+					0xF0F0F0F0E2LL, 0xF0F0F0F0E3LL,
+					0xF0F0F0F0F1, 0xF0F0F0F0F2
+					};
+
+struct ContextTag
+{
+	int moisture;
+	float temperature;
+	int battery;
+};
+
+struct VirtualSensor
+{
+	RF24* radio;
+	uint8_t pip;
+	unsigned long timer;
+	unsigned long sent;
+	unsigned long failed;
+};
+
+const int SENSORS_PER_THREAD = 25;
+
+vector<VirtualSensor> sensors;
+atomic<bool> running(true);
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok)
+	{
+		printf("  FAIL: %s\n", what);
+		failures++;
+	}
+}
+unsigned long period = 8000;
+
+void configureRadio(RF24& radio)
+{
+	radio.setAutoAck(true);
+	radio.setDataRate(RF24_250KBPS);
+	radio.setPALevel(RF24_PA_HIGH);
+	radio.setChannel(76);
+	radio.setCRCLength(RF24_CRC_16);
+	radio.setRetries(5,15); // 5*250us delay with 15 retries
+}
+
+// MMSimulator setup() and loop() for sensors [first, last)
+void sensorThread(size_t first, size_t last)
+{
+	for(size_t i = first; i < last; i++)
+	{
+		RF24& radio = *sensors[i].radio;
+		radio.begin();
+		configureRadio(radio);
+		radio.openReadingPipe(1, pipes[5]);
+		radio.openWritingPipe(pipes[2]);
+		radio.startListening();
+		// Spread the first transmission over one period
+		sensors[i].timer = millis() - rand() % period;
+	}
+
+	while(running)
+	{
+		bool idle = true;
+		for(size_t i = first; i < last && running; i++)
+		{
+			VirtualSensor& s = sensors[i];
+			if((millis() - s.timer) <= period)
+				continue;
+
+			struct ContextTag tag;
+			tag.moisture = rand() % 100;
+			tag.temperature = rand() % 100;
+			tag.battery = rand() % 100;
+
+			s.radio->stopListening();
+			s.radio->openWritingPipe(pipes[s.pip]);
+			if(s.radio->write(&tag, sizeof(tag)))
+				s.sent++;
+			else
+				s.failed++;
+			s.radio->startListening();
+
+			s.pip += 1;
+			s.pip == 5 ? s.pip = 2 : s.pip = s.pip;
+			s.timer = millis();
+			idle = false;
+		}
+		if(idle)
+			delay(1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 200;
+	period = argc > 2 ? strtoul(argv[2], NULL, 10) : 8000;
+	unsigned long seconds = argc > 3 ? strtoul(argv[3], NULL, 10) : 30;
+
+	NRF24MediumConfig air = NRF24Medium::defaults();
+	air.loss = argc > 4 ? atof(argv[4]) : 0;
+	air.latency = argc > 5 ? strtoul(argv[5], NULL, 10) : 0;
+	NRF24Medium::configure(air);
+
+	// Hub wired like control-hub/main.cpp with IRQ on 27, sensors get their own CE/CSN numbers
+	RF24 hub(26,22);
+	NRF24Model::bindPins(22, 26, 27);
+	for(int i = 0; i < count; i++)
+	{
+		VirtualSensor s = { new RF24(1000 + i, 2000 + i), 2, 0, 0, 0 };
+		NRF24Model::bindPins(2000 + i, 1000 + i);
+		sensors.push_back(s);
+	}
+
+	hub.begin();
+	configureRadio(hub);
+	hub.maskIRQ(1,1,0);
+	hub.attachIrq(27);
+	for(uint8_t i=1; i<6; i++)
+		hub.openReadingPipe(i, pipes[i]);
+	hub.openWritingPipe(pipes[0]);
+	hub.startListening();
+
+	printf("Virtual field: %d sensors, one tag every %lu ms each, %lu s, loss %.2f, latency %u us\n",
+	       count, period, seconds, air.loss, air.latency);
+
+	vector<thread> threads;
+	for(size_t first = 0; first < sensors.size(); first += SENSORS_PER_THREAD)
+	{
+		size_t last = first + SENSORS_PER_THREAD;
+		threads.push_back(thread(sensorThread, first, last < sensors.size() ? last : sensors.size()));
+	}
+
+	// Same RX loop as control-hub/main.cpp
+	NRF24Model* hubModel = NRF24Model::findBus(22);
+	unsigned long received[6] = {0};
+	unsigned long start = millis();
+
+	{
+		NRF24Lock lock;
+		hubModel->resetStats();
+	}
+	NRF24Medium::resetStats();
+
+	while(millis() - start < seconds * 1000)
+	{
+		RF24Frame frames[3];
+		size_t n = (hub.waitForEvent(100) & _BV(RX_DR)) ? hub.readBurst(frames, 3) : 0;
+		for(size_t i = 0; i < n; i++)
+			received[frames[i].pipe]++;
+	}
+
+	running = false;
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	// Tags acked before the sensors stopped are still in the RX FIFO
+	while(hub.available())
+	{
+		RF24Frame frames[3];
+		size_t n = hub.readBurst(frames, 3);
+		for(size_t i = 0; i < n; i++)
+			received[frames[i].pipe]++;
+	}
+
+	unsigned long sent = 0, failed = 0, total = 0;
+	for(size_t i = 0; i < sensors.size(); i++)
+	{
+		sent += sensors[i].sent;
+		failed += sensors[i].failed;
+	}
+	for(int i = 0; i < 6; i++)
+		total += received[i];
+
+	NRF24Stats hs;
+	{
+		NRF24Lock lock;
+		hs = hubModel->stats();
+	}
+	NRF24MediumStats ms = NRF24Medium::stats();
+
+	printf("Offered load    : %.1f tags/s\n", (double) count * 1000 / period);
+	printf("Sensors         : %lu acked, %lu failed (MAX_RT)\n", sent, failed);
+	printf("Hub received    : %lu tags (%.1f/s), pipes 2/3/4: %lu/%lu/%lu\n",
+	       total, total / (double) seconds, received[2], received[3], received[4]);
+	printf("Hub RX FIFO     : %llu stored, %llu dropped while full\n",
+	       (unsigned long long) hs.rx_ok, (unsigned long long) hs.rx_dropped);
+	printf("Hub SPI         : %llu transactions, %llu bytes\n",
+	       (unsigned long long) hs.transactions, (unsigned long long) hs.bytes);
+	printf("Air             : %llu frames, %llu acks, %llu collided, %llu lost, %llu duplicates\n",
+	       (unsigned long long) ms.frames, (unsigned long long) ms.acks, (unsigned long long) ms.collided,
+	       (unsigned long long) ms.lost, (unsigned long long) ms.duplicates);
+
+	check(total >= sent, "the hub received fewer tags than the sensors got acks for");
+	check(total < sent || total - sent <= ms.collided + ms.lost, "the hub received tags twice");
+	check(!received[0] && !received[1] && !received[5], "tags received on pipes the sensors don't send to");
+	check(hs.rx_ok == total, "the hub did not read every payload its RX FIFO stored");
+
+	for(size_t i = 0; i < sensors.size(); i++)
+		delete sensors[i].radio;
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
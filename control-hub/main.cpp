@@ -1,10 +1,17 @@
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
 #include <csignal>
 #include <vector>
-#include <queue> 
+#include <thread>
+#include <atomic>
 #include <RF24/RF24.h>
+#include <RF24/RF24Handle.h>
+#include <RF24/RF24Registers.h>
+#include <RF24/RF24Ring.h>
+#include <RF24/nRF24L01.h>
 #include <plog/Log.h>
 #include <plog/Appenders/ColorConsoleAppender.h>
 /*
@@ -63,25 +70,49 @@ struct inGroundTag
 	uint64_t rfAdress;
 };
 
+// Decoded payload, from the decode stage to the storage stage
+struct HubRecord
+{
+	uint8_t pipe;
+	uint32_t timestamp; // millis() when the radio thread read it
+	ActuatorData actuator; // pipe 1
+	inGroundTag inGround; // pipes 2 to 4
+};
+
 // FUNCTIONS //
 vector<string> splitDelimiter(const string &str, char delimiter);
 ActuatorCommand actuatorCommandParser(const string &str);
-void configureRadio();
-void configurePipes();
+RF24RadioProfile radioProfile();
 void signalHandler(int signum);
 void testControllerHub();
+void decodeStage();
+void storageStage();
 
 // GLOBAL VARIABLES //
 bool testCHub = false;
 RF24 radio(26,22); // BCM 26 as nRF CE & BCM22 (SPI1 CE2) as nRF CSN 
-queue<ActuatorData> controllerHubData;
-queue<inGroundTag> inGroundData;
+RF24Handle handle(radio); // Other threads reach the radio through here, the main loop owns it
+const RF24RadioProfile profile = radioProfile(); // Applied after every begin(), see radioProfile()
+RF24RadioState radioState; // The configured radio, restored after failures
+atomic<unsigned long> recoveries(0);
+atomic<uint32_t> recoveryUs(0); // Duration of the last recovery
+
+// Pipeline: radio I/O (main loop) -> decode/aggregate -> storage/log
+// Fixed size rings, memory stays flat however long the hub runs. The radio
+// never waits on the stages behind it: a frame that finds rxFrames full is
+// dropped and counted. The decode stage keeps the latest reading of every
+// pipe while records is full, older readings it replaces are counted as
+// superseded.
+RF24Ring<RF24Frame, 64> rxFrames;
+RF24Ring<HubRecord, 256> records;
+atomic<unsigned long> superseded(0);
+const uint32_t STATS_PERIOD = 60000; // ms between two pipeline reports
 
 // ****************************   MAIN   **************************** 
 int main(int argc, char *argv[])
 {
 	bool begin;
-	uint8_t pipe = 1;
+	int irqPin = argc > 1 ? atoi(argv[1]) : -1; // BCM pin wired to nRF IRQ, if any
 
     //Catch Signal
     signal(SIGTSTP, &signalHandler); // ^z to perform ControllerHub Test Routine
@@ -95,10 +126,25 @@ int main(int argc, char *argv[])
 	begin = radio.begin();
 	PLOG_INFO_IF(begin) << "configureRadio: RF24 started!";
 	PLOG_FATAL_IF(!begin) << "configureRadio: RF24 couldn't begin :(";
-    configureRadio();
-    configurePipes();
+    radio.apply(profile);
+    RF24TimeoutPolicy timeouts = radio.getTimeoutPolicy();
+    timeouts.notify = false; // The main loop logs failureDetected
+    radio.setTimeoutPolicy(timeouts);
     radio.printDetails();
+    RF24Airtime uplink = profile.pipeAirtime(2); // The InGround sensors share the profile's link settings
+    PLOG_INFO << "Uplink: " << uplink.deliveryUs() << " us per tag, " << uplink.worstDeliveryUs() << " us with every retry, "
+              << uplink.giveUpUs() << " us to MAX_RT, at most " << uplink.packetsPerSecond(3) << " tags/s per sensor";
     radio.startListening();
+    radio.snapshot(radioState);
+    if(irqPin >= 0)
+    {
+        bool irq = radio.attachIrq(irqPin);
+        PLOG_INFO_IF(irq) << "IRQ on BCM " << irqPin << ", waiting for interrupts";
+        PLOG_WARNING_IF(!irq) << "Couldn't set up IRQ on BCM " << irqPin << ", polling the radio";
+    }
+
+    thread(decodeStage).detach();
+    thread(storageStage).detach();
 
     PLOG_INFO << "MAIN LOOP STARTED";
     while(1)
@@ -108,51 +154,47 @@ int main(int argc, char *argv[])
         if(radio.failureDetected)
         {
             radio.failureDetected = false;
-            // Perform Radio Setup
-            begin = radio.begin();
-            PLOG_INFO_IF(begin) << "RF24 started after failure!";
-            PLOG_FATAL_IF(!begin) << "RF24 couldn't begin after failure :((";
-            configureRadio();
-            configurePipes();
-            radio.printDetails();
-            radio.startListening();
-            PLOG_WARNING << "Radio reset successfuly after failureDetected.";  
+            // What the radio lost, two SPI batches
+            RF24RadioState found;
+            char lost[512];
+            radio.snapshot(found);
+            radioState.formatDiff(found, lost, sizeof(lost));
+            PLOG_WARNING << "Radio state before recovery: " << (lost[0] ? lost : "unchanged");
+
+            // Write the snapshot back, a few SPI batches and no settling
+            // delays. Only a radio that doesn't answer goes through begin().
+            uint32_t start = micros();
+            bool restored = radio.restore(radioState);
+            if(!restored)
+            {
+                begin = radio.begin();
+                PLOG_INFO_IF(begin) << "RF24 started after failure!";
+                PLOG_FATAL_IF(!begin) << "RF24 couldn't begin after failure :((";
+                radio.apply(profile); // Only what begin() left different, in one SPI batch
+                radio.startListening();
+                radio.snapshot(radioState);
+            }
+            recoveryUs = micros() - start;
+            recoveries++;
+            PLOG_WARNING << "Radio " << (restored ? "restored from its snapshot" : "reset") << " in " << recoveryUs << " us after failureDetected.";
         }
 
-        // Iterate over pipes for incoming messages
-        while(radio.available(&pipe))
-    	{
-    		if(pipe == 1) // Message from ControllerHub
-    		{
-    		    // Read Message
-    		    struct ActuatorData rdata;
-    		    radio.read(&rdata, sizeof(rdata));
-    		    // Push message into Queue
-    		    controllerHubData.push(rdata);
-    		    PLOG_VERBOSE << "ControllerHub Pipe " << (int) pipe << ": Recv: " << rdata.water_comsumption << " litres and reservoir level is " << (int) rdata.reservoir_level;
-    		}
-    		else if(pipe > 1 && pipe < 5) // Message from InGround Sensors
-    		{
-    		    // Read Message
-    		    struct ContextTag rtag;
-    		    struct inGroundTag rdata;
-    		    radio.read(&rtag, sizeof(rtag));
-    		    // Push message into Queue
-    		    rdata.tag = rtag;
-    		    rdata.rfAdress = pipes[pipe];
-    		    inGroundData.push(rdata);
-    		    PLOG_VERBOSE << "InGround Pipe " << (int) pipe << ": Recv: " << rtag.moisture << "% RH, " << rtag.temperature << " Celsius and " << rtag.battery << "% battery";
-    		}
-    	}
-        delayMicroseconds(20);
-    	
-        // Next Pipe...
-    	pipe += 1;
-    	pipe > 5 ? pipe = 1 : pipe = pipe;
-
-        // Check flag for ControllerHub Testing
+        // Send what other threads queued, sleep until a payload arrives, then
+        // drain the RX FIFO with every payload tagged with its pipe and hand
+        // the frames to the decode stage. Wake up every 100ms for the flags
+        // above.
+        RF24Frame frames[3];
+        size_t count = handle.receive(frames, 3, 100);
+        for(size_t i = 0; i < count; i++)
+            rxFrames.push(frames[i]);
+
+        // Check flag for ControllerHub Testing, the prompt runs on its own
+        // thread so the radio keeps receiving meanwhile
         if(testCHub)
-            testControllerHub();
+        {
+            testCHub = false;
+            thread(testControllerHub).detach();
+        }
 
 
     }
@@ -160,13 +202,93 @@ int main(int argc, char *argv[])
 }
 // ******************************************************************
 
+// decodeStage: Decode frames from the radio and keep the latest reading of every source
+void decodeStage()
+{
+    HubRecord latest[5]; // Latest reading of the ControllerHub and of each InGround sensor
+    bool pending[5] = { false };
+
+    while(1)
+    {
+        RF24Frame frame;
+        bool idle = true;
+        while(rxFrames.pop(frame))
+        {
+            idle = false;
+            uint8_t pipe = frame.pipe;
+            if(pipe < 1 || pipe > 4)
+                continue;
+            HubRecord& rec = latest[pipe];
+            if(pipe == 1) // Message from ControllerHub
+                memcpy(&rec.actuator, frame.data, sizeof(rec.actuator));
+            else // Message from InGround Sensors, sent without the timer
+            {
+                memset(&rec.inGround.tag, 0, sizeof(rec.inGround.tag));
+                memcpy(&rec.inGround.tag, frame.data, min<size_t>(frame.length, sizeof(rec.inGround.tag)));
+                rec.inGround.rfAdress = pipes[pipe];
+            }
+            rec.pipe = pipe;
+            rec.timestamp = frame.timestamp;
+            if(pending[pipe])
+                superseded++;
+            pending[pipe] = true;
+            if(records.push(rec))
+                pending[pipe] = false;
+        }
+
+        // Readings left over while the storage stage was behind
+        for(uint8_t pipe = 1; pipe < 5; pipe++)
+            if(pending[pipe] && records.push(latest[pipe]))
+                pending[pipe] = false;
+
+        if(idle)
+            delay(1);
+    }
+}
+
+// storageStage: Log decoded readings and report on the pipeline, as slow as it needs to be
+void storageStage()
+{
+    uint32_t lastReport = millis();
+
+    while(1)
+    {
+        HubRecord rec;
+        bool idle = true;
+        while(records.pop(rec))
+        {
+            idle = false;
+            if(rec.pipe == 1)
+                PLOG_VERBOSE << "ControllerHub Pipe " << (int) rec.pipe << ": Recv: " << rec.actuator.water_comsumption << " litres and reservoir level is " << (int) rec.actuator.reservoir_level;
+            else
+                PLOG_VERBOSE << "InGround Pipe " << (int) rec.pipe << ": Recv: " << rec.inGround.tag.moisture << "% RH, " << rec.inGround.tag.temperature << " Celsius and " << rec.inGround.tag.battery << "% battery";
+        }
+
+        if(millis() - lastReport >= STATS_PERIOD)
+        {
+            lastReport = millis();
+            RF24RingStats rx = rxFrames.stats();
+            RF24RingStats st = records.stats();
+            RF24HandleStats hs = handle.stats();
+            PLOG_INFO << "Pipeline: " << rx.pushed << " frames, " << rx.dropped << " dropped (peak " << rx.high_water << "/" << rxFrames.capacity() << "), "
+                      << st.pushed << " records, " << st.dropped << " deferred (peak " << st.high_water << "/" << records.capacity() << "), "
+                      << (unsigned long) superseded << " superseded";
+            PLOG_INFO << "Radio: " << handle.received() << " received, " << handle.sent() << " sent, " << handle.failed() << " failed, deaf "
+                      << hs.deaf_us / 1000 << " ms in " << hs.windows << " TX windows, "
+                      << recoveries << " recoveries (last " << recoveryUs << " us)";
+            PLOG_WARNING_IF(rx.dropped) << "Decode stage can't keep up with the radio, frames were dropped";
+        }
+
+        if(idle)
+            delay(10);
+    }
+}
+
 void testControllerHub()
 {
     int status, timer;
     struct ActuatorCommand cmd;
-    bool sent = false;
 
-    testCHub = false;
     cout << "** SEND TO CONTROLLER HUB **\n";
     cout << "Status (0-OFF / 1-ON) > ";
     cin >> status;
@@ -174,13 +296,12 @@ void testControllerHub()
     cin >> timer;
     cmd.status = (bool) status;
     cmd.timer = (uint16_t) timer;
-    radio.stopListening();
-    sent = radio.write(&cmd, sizeof(cmd));
-    radio.startListening();
-    if(sent)
-        cout << "SENT.\n";
-    else
-        cout << "FAILED :(\n";
+    handle.send(0, &cmd, sizeof(cmd), [](const RF24TxResult& r){
+        if(r.acked)
+            cout << "SENT.\n";
+        else
+            cout << "FAILED :(\n";
+    });
 }
 
 void signalHandler(int signum)
@@ -188,23 +309,24 @@ void signalHandler(int signum)
     testCHub = true;
 }
 
-//configureRadio: Configure RF24 radio
-void configureRadio()
-{
-	radio.setAutoAck(true);
-	radio.setDataRate(RF24_250KBPS);
-	radio.setPALevel(RF24_PA_HIGH);
-	radio.setChannel(76);
-	radio.setCRCLength(RF24_CRC_16);
-	radio.setRetries(5,15); // 5*250us delay with 15 retries
-}
-
-//configurePipes: Configure RF24 Pipes
-void configurePipes()
+//radioProfile: RF24 radio configuration and pipes
+RF24RadioProfile radioProfile()
 {
+	RF24RadioProfile profile; // Auto-ack on every pipe, CRC16, 5*250us delay with 15 retries
+	profile.data_rate = RF24_250KBPS;
+	profile.pa_level = RF24_PA_HIGH;
+	profile.channel = 76;
+	profile.irq_mask = _BV(MASK_TX_DS) | _BV(MASK_MAX_RT); // IRQ only for received payloads
+	profile.reading_pipes = 0x3E; // Pipes 1 to 5
 	for(uint8_t i=1; i<6; i++)
-		radio.openReadingPipe(i, pipes[i]);
-	radio.openWritingPipe(pipes[0]);
+		profile.reading_addresses[i] = pipes[i];
+	profile.writing_address = pipes[0];
+	// Static payloads as wide as what each node sends, every padding byte is 32us of airtime
+	profile.pipe_payload_sizes[1] = sizeof(ActuatorData);
+	for(uint8_t i=2; i<5; i++)
+		profile.pipe_payload_sizes[i] = offsetof(ContextTag, timer); // InGround sensors don't send the timer
+	profile.writing_payload_size = sizeof(ActuatorCommand);
+	return profile;
 }
 
 
@@ -113,8 +113,9 @@ void setup()
     // Init RF24
     radio.begin();
     configureRadio();
+    radio.setPayloadSize(1, sizeof(ActuatorCommand)); // Static payloads as wide as the structs exchanged
     radio.openReadingPipe(1, pipes[0]);
-    radio.openWritingPipe(pipes[1]);
+    radio.openWritingPipe(pipes[1], sizeof(ActuatorData));
     printf("****************************\n");
     printf("RF24: Controller Hub Status\n");
     radio.printDetails();
@@ -66,7 +66,7 @@ void loop()
         tag.battery = random(0, 100);
         //Send to ControlHub
         radio.stopListening();
-        radio.openWritingPipe(pipes[pip]);
+        radio.openWritingPipe(pipes[pip], sizeof(tag)); // The ControlHub pipes are as wide as a tag
         sent = radio.write(&tag, sizeof(tag));
         radio.startListening();
         if(sent)
@@ -0,0 +1,30 @@
+
+#include "compatibility.h"
+#include "../timing.h"
+
+/**********************************************************************/
+/**
+ * This function is added in order to simulate arduino delay() function
+ * @param milisec
+ */
+void __msleep(int milisec)
+{
+	rf24_delay_ms(milisec);
+}
+
+void __usleep(int microsec)
+{
+	rf24_delay_us(microsec);
+}
+
+/**
+ * This function is added in order to simulate arduino millis() function
+ */
+void __start_timer()
+{
+}
+
+uint32_t __millis()
+{
+	return rf24_millis();
+}
@@ -0,0 +1,29 @@
+/*
+ * File:   compatiblity.h
+ *
+ * Arduino timing functions for the Emulator driver, on the same monotonic
+ * clock the emulated radios use.
+ */
+
+#ifndef COMPATIBLITY_H
+#define	COMPATIBLITY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>  // for uintXX_t types
+#include <stddef.h>
+#include <time.h>
+#include <sys/time.h>
+
+void __msleep(int milisec);
+void __usleep(int microsec);
+void __start_timer();
+uint32_t __millis();
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* COMPATIBLITY_H */
@@ -0,0 +1,57 @@
+/*
+ * File:   gpio.cpp
+ *
+ * GPIO layer of the Emulator driver.
+ */
+
+#include "gpio.h"
+#include "nrf24.h"
+
+std::map<int,int> GPIO::levels;
+
+GPIO::GPIO() {
+}
+
+GPIO::~GPIO() {
+}
+
+void GPIO::open(int port, int DDR)
+{
+	NRF24Lock lock;
+	// RF24::begin() opens CE right after SPI::begin(), see NRF24Model::claimPin()
+	if (DDR == DIRECTION_OUT) NRF24Model::claimPin(port);
+	if (levels.find(port) == levels.end()) levels[port] = 0;
+}
+
+void GPIO::close(int port)
+{
+	NRF24Lock lock;
+	levels.erase(port);
+}
+
+int GPIO::read(int port)
+{
+	NRF24Lock lock;
+	NRF24Model::advance(NRF24Model::now());
+
+	NRF24Model* radio = NRF24Model::findPin(port);
+	if (radio != NULL && radio->irqPin() == port) {
+		radio->stats().syscalls++;
+		return radio->irqAsserted() ? 0 : 1; // IRQ is active low
+	}
+	std::map<int,int>::iterator i = levels.find(port);
+	return i == levels.end() ? 0 : i->second;
+}
+
+void GPIO::write(int port, int value)
+{
+	NRF24Lock lock;
+	NRF24Model::advance(NRF24Model::now());
+
+	levels[port] = value ? 1 : 0;
+	NRF24Model* radio = NRF24Model::findPin(port);
+	if (radio != NULL && radio->cePin() == port) {
+		radio->stats().syscalls++;
+		radio->setCE(value != 0);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * File:   gpio.h
+ *
+ * GPIO layer of the Emulator driver. Same interface as utility/SPIDEV/gpio.h.
+ * Pins bound to an emulated radio drive its CE input or report its IRQ output,
+ * every other pin simply keeps the last value written to it.
+ */
+
+#ifndef H
+#define	H
+
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+
+/** Specific excpetion for SPI errors */
+class GPIOException : public std::runtime_error {
+	public:
+		explicit GPIOException(const std::string& msg) :  std::runtime_error(msg) { }
+};
+
+/**
+ * @file gpio.h
+ * \cond HIDDEN_SYMBOLS
+ * Class declaration for GPIO helper files
+ */
+
+class GPIO {
+public:
+
+	/* Constants */
+	static const int DIRECTION_OUT = 1;
+	static const int DIRECTION_IN = 0;
+
+	static const int OUTPUT_HIGH = 1;
+	static const int OUTPUT_LOW = 0;
+
+	GPIO();
+
+	/**
+	 * Similar to Arduino pinMode(pin,mode);
+     * @param port
+     * @param DDR
+     */
+	static void open(int port, int DDR);
+	/**
+	 *
+     * @param port
+     */
+	static void close(int port);
+	/**
+	 * Similar to Arduino digitalRead(pin);
+     * @param port
+     * @param value
+     */
+	static int read(int port);
+	/**
+	* Similar to Arduino digitalWrite(pin,state);
+	* @param port
+	* @param value
+	*/
+	static void write(int port,int value);
+
+	virtual ~GPIO();
+
+private:
+  /* last value of pins not bound to a radio */
+  static std::map<int,int> levels;
+};
+/**
+ * \endcond
+ */
+#endif	/* H */
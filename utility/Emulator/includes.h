@@ -0,0 +1,8 @@
+
+#ifndef __RF24_INCLUDES_H__
+#define __RF24_INCLUDES_H__
+
+#define RF24_EMULATOR
+  #include "Emulator/RF24_arch_config.h"
+  #include "Emulator/interrupt.h"
+#endif
@@ -0,0 +1,38 @@
+/*
+ * File:   interrupt.c
+ *
+ * IRQ line of the Emulator driver.
+ */
+
+#include "interrupt.h"
+#include "nrf24.h"
+
+int setupInterrupt (int pin, int mode)
+{
+	(void) mode; // The IRQ of a radio only ever falls on a new event
+	NRF24Lock lock;
+	NRF24Model* radio = NRF24Model::findPin(pin);
+	return (radio != NULL && radio->irqPin() == pin) ? 0 : -1;
+}
+
+int waitForInterrupt (int pin, int mS)
+{
+	NRF24Lock lock;
+	uint64_t deadline = mS < 0 ? NRF24Model::NEVER : NRF24Model::now() + mS * 1000ULL;
+
+	NRF24Model* radio = NRF24Model::findPin(pin);
+	if (radio == NULL || radio->irqPin() != pin) return -2;
+	radio->stats().syscalls++; // poll()
+
+	// Sleep until the next event of the world or until another thread
+	// touches it, whichever may assert the IRQ first
+	for (;;) {
+		uint64_t t = NRF24Model::now();
+		NRF24Model::advance(t);
+		if (radio->irqAsserted()) return 1;
+		if (t >= deadline) return 0;
+
+		uint64_t until = NRF24Model::nextEvent();
+		NRF24Model::wait(until < deadline ? until : deadline);
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * File:   interrupt.h
+ *
+ * IRQ line of the Emulator driver. Same interface as the wait part of
+ * utility/SPIDEV/interrupt.h, for pins bound as IRQ with
+ * NRF24Model::bindPins().
+ */
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include "RF24_arch_config.h"
+
+#define INT_EDGE_SETUP          0
+#define INT_EDGE_FALLING        1
+#define INT_EDGE_RISING         2
+#define INT_EDGE_BOTH           3
+
+/* setupInterrupt() and waitForInterrupt() are available, see RF24::waitForEvent() */
+#define RF24_IRQ_WAIT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * setupInterrupt:
+ *      Check that @p pin is the IRQ pin of an emulated radio.
+ *      Returns 0, or -1 if no radio owns the pin as IRQ.
+ */
+extern int setupInterrupt (int pin, int mode);
+
+/*
+ * waitForInterrupt:
+ *      Block until the IRQ of the radio owning @p pin is asserted or
+ *      @p mS milliseconds have passed (-1 waits forever).
+ *      Returns 1 on interrupt, 0 on timeout, -2 if the pin is not set up.
+ */
+extern int waitForInterrupt (int pin, int mS);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTERRUPT_H */
@@ -0,0 +1,186 @@
+/*
+ * File:   medium.cpp
+ *
+ * Virtual RF medium of the Emulator driver.
+ */
+
+#include "medium.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+static NRF24MediumConfig mediumConfig = NRF24Medium::defaults();
+static NRF24MediumStats mediumStats;
+static std::vector<NRF24Frame> air;
+static std::map<std::pair<int,int>,double> linkLoss;
+static uint32_t rng = 1;
+
+/****************************************************************************/
+
+NRF24MediumConfig NRF24Medium::defaults()
+{
+	NRF24MediumConfig c;
+	c.loss = 0;
+	c.latency = 0;
+	c.collisions = true;
+	c.seed = 1;
+	return c;
+}
+
+void NRF24Medium::configure(const NRF24MediumConfig& config)
+{
+	NRF24Lock lock;
+	mediumConfig = config;
+	rng = config.seed ? config.seed : 1;
+}
+
+NRF24MediumConfig NRF24Medium::config()
+{
+	NRF24Lock lock;
+	return mediumConfig;
+}
+
+void NRF24Medium::setLinkLoss(int fromBus, int toBus, double loss)
+{
+	NRF24Lock lock;
+	if (loss < 0) linkLoss.erase(std::make_pair(fromBus, toBus));
+	else linkLoss[std::make_pair(fromBus, toBus)] = loss;
+}
+
+NRF24MediumStats NRF24Medium::stats()
+{
+	NRF24Lock lock;
+	return mediumStats;
+}
+
+void NRF24Medium::resetStats()
+{
+	NRF24Lock lock;
+	mediumStats = NRF24MediumStats();
+}
+
+void NRF24Medium::clear()
+{
+	air.clear();
+}
+
+/****************************************************************************/
+
+bool NRF24Medium::lost(const NRF24Model* from, const NRF24Model* to)
+{
+	double p = mediumConfig.loss;
+	if (!linkLoss.empty()) {
+		std::map<std::pair<int,int>,double>::iterator i = linkLoss.find(std::make_pair(from->bus(), to->bus()));
+		if (i != linkLoss.end()) p = i->second;
+	}
+	if (p <= 0) return false;
+
+	// xorshift32, cheap and repeatable for a given seed
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng < p * 4294967296.0;
+}
+
+/****************************************************************************/
+
+void NRF24Medium::transmit(const NRF24Frame& frame)
+{
+	NRF24Frame f = frame;
+	f.collided = false;
+
+	if (mediumConfig.collisions) {
+		for (size_t i = 0; i < air.size(); i++) {
+			NRF24Frame& other = air[i];
+			if (other.channel == f.channel && other.start < f.end && f.start < other.end) {
+				other.collided = true;
+				f.collided = true;
+			}
+		}
+	}
+
+	if (f.ack) mediumStats.acks++;
+	else mediumStats.frames++;
+
+	for (size_t i = 0; i < NRF24Model::count(); i++) {
+		NRF24Model* r = NRF24Model::at(i);
+		if (r != f.sender) r->sense(f.channel);
+	}
+
+	air.push_back(f);
+}
+
+bool NRF24Medium::carrier(uint8_t channel, uint64_t t)
+{
+	for (size_t i = 0; i < air.size(); i++) {
+		if (air[i].channel == channel && air[i].start <= t && t < air[i].end) return true;
+	}
+	return false;
+}
+
+uint64_t NRF24Medium::nextEvent()
+{
+	uint64_t when = NRF24Model::NEVER;
+	for (size_t i = 0; i < air.size(); i++) {
+		uint64_t t = air[i].end + mediumConfig.latency;
+		if (t < when) when = t;
+	}
+	return when;
+}
+
+void NRF24Medium::deliverNext()
+{
+	if (air.empty()) return;
+
+	size_t next = 0;
+	for (size_t i = 1; i < air.size(); i++) {
+		if (air[i].end < air[next].end) next = i;
+	}
+	NRF24Frame f = air[next];
+	air.erase(air.begin() + next);
+
+	deliver(f, f.end + mediumConfig.latency);
+}
+
+/****************************************************************************/
+
+void NRF24Medium::deliver(const NRF24Frame& f, uint64_t t)
+{
+	if (f.collided) {
+		mediumStats.collided++;
+		return;
+	}
+
+	if (f.ack) {
+		if (lost(f.sender, f.target)) {
+			mediumStats.lost++;
+		}
+		else if (f.target->ackReceived(f, t)) {
+			mediumStats.delivered++;
+		}
+		return;
+	}
+
+	bool heard = false;
+	for (size_t i = 0; i < NRF24Model::count(); i++) {
+		NRF24Model* r = NRF24Model::at(i);
+		uint8_t pipe;
+		if (r == f.sender || !r->accepts(f, t, &pipe)) continue;
+
+		heard = true;
+		if (lost(f.sender, r)) {
+			mediumStats.lost++;
+			continue;
+		}
+		mediumStats.delivered++;
+
+		NRF24Frame ack;
+		bool duplicate = false;
+		if (r->receive(f, pipe, t, &ack, &duplicate)) {
+			transmit(ack);
+		}
+		if (duplicate) mediumStats.duplicates++;
+	}
+	if (!heard) mediumStats.unheard++;
+}
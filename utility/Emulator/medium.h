@@ -0,0 +1,109 @@
+/*
+ * File:   medium.h
+ *
+ * Virtual RF medium of the Emulator driver.
+ *
+ * Every frame an emulated radio puts on air (packets and auto-acks) goes
+ * through the medium, which delivers it to the radios listening on the same
+ * channel, data rate and address once its airtime is over. The medium can
+ * drop frames at random, delay their delivery and destroys frames that
+ * overlap in time on the same channel. Frames on air also drive the RPD
+ * (carrier detect) register of listening radios.
+ *
+ * The medium is part of the emulated world and shares its lock, see
+ * NRF24Model::lock().
+ */
+
+#ifndef NRF24_MEDIUM_H
+#define NRF24_MEDIUM_H
+
+#include <stdint.h>
+#include "nrf24.h"
+
+/**
+ * @file medium.h
+ * \cond HIDDEN_SYMBOLS
+ * Class declaration for the virtual RF medium
+ */
+
+/** Behaviour of the medium */
+struct NRF24MediumConfig {
+	double loss;      /**< Probability that a receiver misses a frame, 0 to 1 */
+	uint32_t latency; /**< Delay between the end of a frame and its delivery, us */
+	bool collisions;  /**< Frames overlapping on the same channel destroy each other */
+	uint32_t seed;    /**< Seed of the loss generator, runs with the same seed are repeatable */
+};
+
+/** Counters of the medium */
+struct NRF24MediumStats {
+	uint64_t frames;     /**< Packets put on air, retransmissions included */
+	uint64_t acks;       /**< Auto-ack frames put on air */
+	uint64_t delivered;  /**< Frames (packets or acks) received by a radio */
+	uint64_t lost;       /**< Frames dropped by the configured loss */
+	uint64_t collided;   /**< Frames destroyed by an overlapping frame */
+	uint64_t unheard;    /**< Packets no radio was listening for */
+	uint64_t duplicates; /**< Retransmissions discarded by the receiver's PID check */
+};
+
+/** A frame on air */
+struct NRF24Frame {
+	NRF24Model* sender;
+	NRF24Model* target;   /**< Radio an ack is meant for, NULL for packets */
+	uint8_t channel;
+	uint8_t data_rate;    /**< RF_DR_LOW/RF_DR_HIGH bits of RF_SETUP */
+	uint8_t aw;           /**< Address width in bytes */
+	uint8_t address[5];
+	uint8_t crc;          /**< CRC length in bytes */
+	bool dynamic;         /**< Payload length is sent in the packet control field */
+	bool ack;             /**< This is an auto-ack frame */
+	bool no_ack;          /**< NO_ACK flag of the packet control field */
+	uint8_t pid;
+	NRF24Payload payload; /**< Packet or ack payload */
+	uint64_t start;
+	uint64_t end;
+	bool collided;
+};
+
+class NRF24Medium {
+public:
+
+	/** Default behaviour: no loss, no latency, collisions enabled */
+	static NRF24MediumConfig defaults();
+
+	static void configure(const NRF24MediumConfig& config);
+	static NRF24MediumConfig config();
+
+	/**
+	 * Loss probability of the link from the radio on bus @p fromBus to the
+	 * radio on bus @p toBus, overriding the global loss. A negative value
+	 * removes the override.
+	 */
+	static void setLinkLoss(int fromBus, int toBus, double loss);
+
+	static NRF24MediumStats stats();
+	static void resetStats();
+
+	/** Put @p frame on air. Requires NRF24Model::lock(). */
+	static void transmit(const NRF24Frame& frame);
+
+	/** True while a frame is on air on @p channel at time @p t */
+	static bool carrier(uint8_t channel, uint64_t t);
+
+	/** Delivery time of the next frame, NRF24Model::NEVER if none */
+	static uint64_t nextEvent();
+
+	/** Deliver the frame returned by nextEvent(). Requires NRF24Model::lock(). */
+	static void deliverNext();
+
+	/** Drop every frame on air, used when the radios are destroyed */
+	static void clear();
+
+private:
+	static void deliver(const NRF24Frame& frame, uint64_t t);
+	static bool lost(const NRF24Model* from, const NRF24Model* to);
+};
+
+/**
+ * \endcond
+ */
+#endif	/* NRF24_MEDIUM_H */
@@ -0,0 +1,797 @@
+/*
+ * File:   nrf24.cpp
+ *
+ * In-memory model of a nRF24L01+ transceiver used by the Emulator driver.
+ * Register semantics and timing follow the nRF24L01+ product specification v1.0.
+ */
+
+#include "nrf24.h"
+#include "medium.h"
+#include "../../nRF24L01.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <vector>
+
+#define NRF_BV(x) (1<<(x))
+#define IRQ_FLAGS (NRF_BV(RX_DR) | NRF_BV(TX_DS) | NRF_BV(MAX_RT))
+#define CONT_WAVE 7
+
+static pthread_mutex_t worldMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worldChanged;
+static pthread_once_t worldOnce = PTHREAD_ONCE_INIT;
+static std::vector<NRF24Model*> radios;
+static std::map<int,NRF24Model*> pins;
+static NRF24Model* pendingCE = NULL;
+static uint64_t worldTime = 0;
+static NRF24Model::TransferHook transferHook = NULL;
+
+/****************************************************************************/
+
+NRF24Model::NRF24Model(int busNo):
+	_bus(busNo), _ce_pin(-1), _irq_pin(-1), _ce(false)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	powerOnReset();
+}
+
+void NRF24Model::powerOnReset()
+{
+	_state = POWER_DOWN;
+	_next_event = NEVER;
+	_plos_cnt = 0;
+	_arc_cnt = 0;
+	_pid = 0;
+	_rpd = false;
+	_tx_reuse = false;
+	_deaf_until = 0;
+	_tx_count = 0;
+	_rx_count = 0;
+	_seq = 0;
+	_on_air_ack = false;
+
+	// Reset values
+	memset(_reg, 0, sizeof(_reg));
+	_reg[NRF_CONFIG] = 0x08;
+	_reg[EN_AA] = 0x3F;
+	_reg[EN_RXADDR] = 0x03;
+	_reg[SETUP_AW] = 0x03;
+	_reg[SETUP_RETR] = 0x03;
+	_reg[RF_CH] = 0x02;
+	_reg[RF_SETUP] = 0x0E;
+
+	memset(_addr[0], 0xE7, 5);
+	memset(_addr[1], 0xC2, 5);
+	for (int i = 2; i < 6; i++) {
+		memset(_addr[i], 0xC2, 5);
+		_addr[i][0] = 0xC1 + i;
+	}
+	memset(_addr[6], 0xE7, 5);
+
+	memset(_last_pid, 0xFF, sizeof(_last_pid));
+	memset(_last_crc, 0, sizeof(_last_crc));
+	memset(_tx_fifo, 0, sizeof(_tx_fifo));
+	memset(_rx_fifo, 0, sizeof(_rx_fifo));
+	memset(&_on_air, 0, sizeof(_on_air));
+}
+
+/****************************************************************************/
+
+NRF24Model* NRF24Model::findBus(int busNo)
+{
+	for (size_t i = 0; i < radios.size(); i++) {
+		if (radios[i]->_bus == busNo) return radios[i];
+	}
+	return NULL;
+}
+
+NRF24Model* NRF24Model::forBus(int busNo)
+{
+	NRF24Model* radio = findBus(busNo);
+	if (radio == NULL) {
+		radio = new NRF24Model(busNo);
+		radios.push_back(radio);
+	}
+	if (radio->_ce_pin < 0) pendingCE = radio;
+	return radio;
+}
+
+NRF24Model* NRF24Model::findPin(int pin)
+{
+	std::map<int,NRF24Model*>::iterator i = pins.find(pin);
+	return i == pins.end() ? NULL : i->second;
+}
+
+void NRF24Model::bindPins(int busNo, int cePin, int irqPin)
+{
+	NRF24Model* radio = forBus(busNo);
+	if (cePin >= 0) {
+		if (radio->_ce_pin >= 0) pins.erase(radio->_ce_pin);
+		radio->_ce_pin = cePin;
+		pins[cePin] = radio;
+		if (pendingCE == radio) pendingCE = NULL;
+	}
+	if (irqPin >= 0) {
+		if (radio->_irq_pin >= 0) pins.erase(radio->_irq_pin);
+		radio->_irq_pin = irqPin;
+		pins[irqPin] = radio;
+	}
+}
+
+bool NRF24Model::claimPin(int pin)
+{
+	if (pins.find(pin) != pins.end()) return true;
+	if (pendingCE == NULL || pendingCE->_ce_pin >= 0) return false;
+	pendingCE->_ce_pin = pin;
+	pins[pin] = pendingCE;
+	pendingCE = NULL;
+	return true;
+}
+
+void NRF24Model::resetAll()
+{
+	for (size_t i = 0; i < radios.size(); i++) delete radios[i];
+	radios.clear();
+	pins.clear();
+	pendingCE = NULL;
+	NRF24Medium::clear();
+}
+
+size_t NRF24Model::count()
+{
+	return radios.size();
+}
+
+NRF24Model* NRF24Model::at(size_t i)
+{
+	return radios[i];
+}
+
+/****************************************************************************/
+
+uint64_t NRF24Model::now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void initWorldChanged()
+{
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&worldChanged, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+void NRF24Model::lock()
+{
+	pthread_once(&worldOnce, initWorldChanged);
+	pthread_mutex_lock(&worldMutex);
+}
+
+void NRF24Model::unlock()
+{
+	// Wake up threads blocked in wait(), whatever was done may concern them
+	pthread_cond_broadcast(&worldChanged);
+	pthread_mutex_unlock(&worldMutex);
+}
+
+void NRF24Model::wait(uint64_t until)
+{
+	if (until == NEVER) {
+		pthread_cond_wait(&worldChanged, &worldMutex);
+		return;
+	}
+	struct timespec ts;
+	ts.tv_sec = until / 1000000ULL;
+	ts.tv_nsec = (until % 1000000ULL) * 1000;
+	pthread_cond_timedwait(&worldChanged, &worldMutex, &ts);
+}
+
+uint64_t NRF24Model::nextEvent()
+{
+	uint64_t when = NRF24Medium::nextEvent();
+	for (size_t i = 0; i < radios.size(); i++) {
+		if (radios[i]->_next_event < when) when = radios[i]->_next_event;
+	}
+	return when;
+}
+
+void NRF24Model::advance(uint64_t t)
+{
+	if (t < worldTime) t = worldTime;
+
+	// Handle events in time order across all radios, so that anything one
+	// radio puts on air is seen by the others at the right moment
+	for (;;) {
+		NRF24Model* next = NULL;
+		uint64_t when = NEVER;
+		for (size_t i = 0; i < radios.size(); i++) {
+			if (radios[i]->_next_event < when) {
+				when = radios[i]->_next_event;
+				next = radios[i];
+			}
+		}
+		uint64_t delivery = NRF24Medium::nextEvent();
+		if (delivery < when) {
+			if (delivery > t) break;
+			worldTime = delivery;
+			NRF24Medium::deliverNext();
+			continue;
+		}
+		if (next == NULL || when > t) break;
+		worldTime = when;
+		next->process(when);
+	}
+	worldTime = t;
+}
+
+/****************************************************************************/
+
+void NRF24Model::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+uint8_t NRF24Model::status() const
+{
+	uint8_t s = _reg[NRF_STATUS] & IRQ_FLAGS;
+	s |= (_rx_count ? _rx_fifo[0].pipe : 0x07) << RX_P_NO;
+	if (_tx_count == 3) s |= NRF_BV(TX_FULL);
+	return s;
+}
+
+uint8_t NRF24Model::fifoStatus() const
+{
+	uint8_t f = 0;
+	if (_tx_reuse) f |= NRF_BV(TX_REUSE);
+	if (_tx_count == 3) f |= NRF_BV(FIFO_FULL);
+	if (_tx_count == 0) f |= NRF_BV(TX_EMPTY);
+	if (_rx_count == 3) f |= NRF_BV(RX_FULL);
+	if (_rx_count == 0) f |= NRF_BV(RX_EMPTY);
+	return f;
+}
+
+bool NRF24Model::irqAsserted() const
+{
+	// MASK_* bits in CONFIG sit at the same positions as the STATUS flags
+	return (_reg[NRF_STATUS] & IRQ_FLAGS & ~_reg[NRF_CONFIG]) != 0;
+}
+
+/****************************************************************************/
+
+uint8_t NRF24Model::readRegister(uint8_t r, uint32_t index) const
+{
+	switch (r) {
+	case NRF_STATUS:
+		return index ? 0 : status();
+	case OBSERVE_TX:
+		return index ? 0 : (_plos_cnt << PLOS_CNT) | (_arc_cnt << ARC_CNT);
+	case RPD:
+		return index ? 0 : (_rpd || (_state == RX_MODE && carrierPresent()));
+	case FIFO_STATUS:
+		return index ? 0 : fifoStatus();
+	case RX_ADDR_P0:
+	case RX_ADDR_P1:
+		return index < 5 ? _addr[r - RX_ADDR_P0][index] : 0;
+	case TX_ADDR:
+		return index < 5 ? _addr[6][index] : 0;
+	case RX_ADDR_P2:
+	case RX_ADDR_P3:
+	case RX_ADDR_P4:
+	case RX_ADDR_P5:
+		return index ? 0 : _addr[r - RX_ADDR_P0][0];
+	default:
+		return index ? 0 : _reg[r];
+	}
+}
+
+void NRF24Model::writeRegister(uint8_t r, const uint8_t* buf, uint32_t len)
+{
+	if (len == 0) return;
+	uint8_t v = buf[0];
+
+	switch (r) {
+	case NRF_CONFIG:
+		_reg[r] = v & 0x7F;
+		break;
+	case EN_AA:
+	case EN_RXADDR:
+	case DYNPD:
+		_reg[r] = v & 0x3F;
+		break;
+	case SETUP_AW:
+		_reg[r] = v & 0x03;
+		break;
+	case SETUP_RETR:
+		_reg[r] = v;
+		break;
+	case RF_CH:
+		_reg[r] = v & 0x7F;
+		_plos_cnt = 0; // PLOS_CNT is reset by writing RF_CH
+		break;
+	case RF_SETUP:
+		_reg[r] = v & 0xBF;
+		break;
+	case NRF_STATUS:
+		_reg[r] &= ~(v & IRQ_FLAGS); // Write 1 to clear
+		break;
+	case RX_ADDR_P0:
+	case RX_ADDR_P1:
+	case TX_ADDR:
+		memcpy(_addr[r == TX_ADDR ? 6 : r - RX_ADDR_P0], buf, len < 5 ? len : 5);
+		break;
+	case RX_ADDR_P2:
+	case RX_ADDR_P3:
+	case RX_ADDR_P4:
+	case RX_ADDR_P5:
+		_addr[r - RX_ADDR_P0][0] = v;
+		break;
+	case RX_PW_P0:
+	case RX_PW_P1:
+	case RX_PW_P2:
+	case RX_PW_P3:
+	case RX_PW_P4:
+	case RX_PW_P5:
+		_reg[r] = v & 0x3F;
+		break;
+	case FEATURE:
+		_reg[r] = v & 0x07;
+		break;
+	default:
+		// OBSERVE_TX, RPD and FIFO_STATUS are read only, 0x18-0x1B are reserved
+		break;
+	}
+}
+
+/****************************************************************************/
+
+void NRF24Model::pushTx(const uint8_t* buf, uint32_t len, uint8_t pipe, bool no_ack)
+{
+	if (_tx_count == 3 || len == 0) return; // Writing to a full FIFO is lost
+	NRF24Payload& p = _tx_fifo[_tx_count++];
+	p.len = len < 32 ? len : 32;
+	memcpy(p.data, buf, p.len);
+	p.pipe = pipe;
+	p.no_ack = no_ack;
+	p.seq = ++_seq;
+}
+
+void NRF24Model::popTx(uint32_t seq)
+{
+	if (_tx_count == 0 || _tx_fifo[0].seq != seq) return; // Flushed while on air
+	memmove(&_tx_fifo[0], &_tx_fifo[1], sizeof(NRF24Payload) * (--_tx_count));
+}
+
+void NRF24Model::popRx()
+{
+	if (_rx_count == 0) return;
+	memmove(&_rx_fifo[0], &_rx_fifo[1], sizeof(NRF24Payload) * (--_rx_count));
+}
+
+/****************************************************************************/
+
+void NRF24Model::spiTransfer(const uint8_t* tx, uint8_t* rx, uint32_t len)
+{
+	if (len == 0) return;
+
+	_stats.transactions++;
+	_stats.bytes += len;
+
+	// tx and rx may alias, so everything clocked in is captured first
+	uint8_t in[33];
+	uint32_t n = len < sizeof(in) ? len : sizeof(in);
+	memcpy(in, tx, n);
+
+	const uint8_t cmd = in[0];
+	const uint8_t* data = in + 1;
+	const uint32_t data_len = n - 1;
+
+	rx[0] = status();
+	for (uint32_t i = 1; i < len; i++) rx[i] = 0;
+
+	if ((cmd & 0xE0) == R_REGISTER) {
+		for (uint32_t i = 1; i < len; i++) rx[i] = readRegister(cmd & REGISTER_MASK, i - 1);
+	}
+	else if ((cmd & 0xE0) == W_REGISTER) {
+		writeRegister(cmd & REGISTER_MASK, data, data_len);
+	}
+	else if ((cmd & 0xF8) == W_ACK_PAYLOAD) {
+		if (_reg[FEATURE] & NRF_BV(EN_ACK_PAY)) pushTx(data, data_len, cmd & 0x07, false);
+	}
+	else {
+		switch (cmd) {
+		case R_RX_PAYLOAD:
+			if (_rx_count) {
+				for (uint32_t i = 1; i < len && i <= _rx_fifo[0].len; i++) rx[i] = _rx_fifo[0].data[i - 1];
+				popRx(); // The payload is deleted once it has been read
+			}
+			break;
+		case R_RX_PL_WID:
+			if (len > 1) rx[1] = _rx_count ? _rx_fifo[0].len : 0;
+			break;
+		case W_TX_PAYLOAD:
+			_tx_reuse = false;
+			pushTx(data, data_len, 0, false);
+			break;
+		case W_TX_PAYLOAD_NO_ACK:
+			if (_reg[FEATURE] & NRF_BV(EN_DYN_ACK)) {
+				_tx_reuse = false;
+				pushTx(data, data_len, 0, true);
+			}
+			break;
+		case FLUSH_TX:
+			_tx_count = 0;
+			_tx_reuse = false;
+			break;
+		case FLUSH_RX:
+			_rx_count = 0;
+			break;
+		case REUSE_TX_PL:
+			_tx_reuse = true;
+			break;
+		default:
+			// ACTIVATE is not needed on the nRF24L01+, NOP only returns STATUS
+			break;
+		}
+	}
+
+	update(worldTime);
+	if (transferHook) transferHook(*this, cmd, rx[0]);
+}
+
+void NRF24Model::setTransferHook(TransferHook hook)
+{
+	transferHook = hook;
+}
+
+bool NRF24Model::inject(uint8_t pipe, const uint8_t* data, uint8_t len)
+{
+	if (_rx_count == 3) return false;
+	NRF24Payload& p = _rx_fifo[_rx_count++];
+	memset(&p, 0, sizeof(p));
+	p.len = len < sizeof(p.data) ? len : sizeof(p.data);
+	memcpy(p.data, data, p.len);
+	p.pipe = pipe;
+	_reg[NRF_STATUS] |= NRF_BV(RX_DR);
+	_stats.rx_ok++;
+	update(worldTime);
+	return true;
+}
+
+void NRF24Model::setCE(bool level)
+{
+	_stats.ce_writes++;
+	if (_ce == level) return;
+	_ce = level;
+	update(worldTime);
+}
+
+/****************************************************************************/
+
+uint8_t NRF24Model::crcLength() const
+{
+	// Auto-ack on any pipe forces the CRC on
+	if (!(_reg[NRF_CONFIG] & NRF_BV(EN_CRC)) && !_reg[EN_AA]) return 0;
+	return (_reg[NRF_CONFIG] & NRF_BV(CRCO)) ? 2 : 1;
+}
+
+uint8_t NRF24Model::addressWidth() const
+{
+	uint8_t aw = _reg[SETUP_AW] & 0x03;
+	return aw ? aw + 2 : 3;
+}
+
+uint32_t NRF24Model::airtime(uint8_t len) const
+{
+	// Preamble, address, 9 bit packet control field, payload and CRC
+	uint32_t bits = 8 + addressWidth() * 8 + 9 + len * 8 + crcLength() * 8;
+
+	uint8_t dr = _reg[RF_SETUP] & (NRF_BV(RF_DR_LOW) | NRF_BV(RF_DR_HIGH));
+	if (dr == NRF_BV(RF_DR_LOW)) return bits * 4;    // 250KBPS
+	if (dr == NRF_BV(RF_DR_HIGH)) return (bits + 1) / 2; // 2MBPS
+	return bits;                                     // 1MBPS
+}
+
+uint32_t NRF24Model::retransmitDelay() const
+{
+	return ((_reg[SETUP_RETR] >> ARD) + 1) * 250;
+}
+
+/****************************************************************************/
+
+void NRF24Model::update(uint64_t t)
+{
+	if (!(_reg[NRF_CONFIG] & NRF_BV(PWR_UP))) {
+		_state = POWER_DOWN;
+		_next_event = NEVER;
+		return;
+	}
+
+	switch (_state) {
+	case POWER_DOWN:
+		_state = START_UP;
+		_next_event = t + T_PD2STBY;
+		return;
+	case START_UP:
+	case TX_SETTLE: // A 10us CE pulse is enough to send a packet
+	case TX_MODE:
+	case TX_ACK_WAIT:
+		return;     // Standby is only re-entered once the packet is done
+	default:
+		break;
+	}
+
+	if (!_ce) {
+		_state = STANDBY_I;
+		_next_event = NEVER;
+		return;
+	}
+
+	if (_reg[NRF_CONFIG] & NRF_BV(PRIM_RX)) {
+		if (_state != RX_MODE && _state != RX_SETTLE) {
+			_state = RX_SETTLE;
+			_next_event = t + T_STBY2A;
+			_rpd = false;
+		}
+		return;
+	}
+
+	// PTX with CE high: send while there is something to send and MAX_RT is clear
+	if (_tx_count && !(_reg[NRF_STATUS] & NRF_BV(MAX_RT))) {
+		_state = TX_SETTLE;
+		_next_event = t + T_STBY2A;
+	}
+	else {
+		_state = STANDBY_II;
+		_next_event = NEVER;
+	}
+}
+
+void NRF24Model::process(uint64_t t)
+{
+	_next_event = NEVER;
+
+	switch (_state) {
+	case START_UP:
+		_state = STANDBY_I;
+		update(t);
+		break;
+	case RX_SETTLE:
+		_state = RX_MODE;
+		break;
+	case TX_SETTLE:
+		startTx(t, false);
+		break;
+	case TX_MODE:
+		// End of the packet on air
+		if (_on_air_ack) {
+			_state = TX_ACK_WAIT;
+			_next_event = t + retransmitDelay();
+		}
+		else {
+			txComplete(t);
+		}
+		break;
+	case TX_ACK_WAIT:
+		// No ACK within ARD
+		if (_arc_cnt < (_reg[SETUP_RETR] & 0x0F)) {
+			_arc_cnt++;
+			startTx(t, true);
+		}
+		else {
+			txFailed(t);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void NRF24Model::startTx(uint64_t t, bool retransmit)
+{
+	if (!retransmit) {
+		if (_tx_count == 0) { // Flushed while the PLL was settling
+			afterTx(t);
+			return;
+		}
+		_on_air = _tx_fifo[0];
+		_arc_cnt = 0;
+		_pid = (_pid + 1) & 0x03;
+	}
+	_on_air_ack = !_on_air.no_ack && (_reg[EN_AA] & NRF_BV(ENAA_P0));
+
+	_state = TX_MODE;
+	_next_event = t + airtime(_on_air.len);
+	_stats.tx_attempts++;
+
+	NRF24Frame f;
+	f.sender = this;
+	f.target = NULL;
+	f.channel = _reg[RF_CH];
+	f.data_rate = dataRate();
+	f.aw = addressWidth();
+	memcpy(f.address, _addr[6], sizeof(f.address));
+	f.crc = crcLength();
+	f.dynamic = dynamicPayload(0);
+	f.ack = false;
+	f.no_ack = _on_air.no_ack;
+	f.pid = _pid;
+	f.payload = _on_air;
+	f.start = t;
+	f.end = _next_event;
+	NRF24Medium::transmit(f);
+}
+
+void NRF24Model::txComplete(uint64_t t)
+{
+	_reg[NRF_STATUS] |= NRF_BV(TX_DS);
+	_stats.tx_ok++;
+	if (!_tx_reuse) popTx(_on_air.seq);
+	afterTx(t);
+}
+
+void NRF24Model::txFailed(uint64_t t)
+{
+	// The payload stays in the TX FIFO, TX is halted until MAX_RT is cleared
+	_reg[NRF_STATUS] |= NRF_BV(MAX_RT);
+	_stats.tx_failed++;
+	if (_plos_cnt < 15) _plos_cnt++;
+	afterTx(t);
+}
+
+void NRF24Model::afterTx(uint64_t t)
+{
+	// CE held high with more to send: the PLL is still locked, the next
+	// packet goes on air without settling again, like in a stream
+	if (_ce && _tx_count && !(_reg[NRF_STATUS] & NRF_BV(MAX_RT))
+	    && !(_reg[NRF_CONFIG] & NRF_BV(PRIM_RX)) && (_reg[NRF_CONFIG] & NRF_BV(PWR_UP))) {
+		startTx(t, false);
+		return;
+	}
+	_state = _ce ? STANDBY_II : STANDBY_I;
+	_next_event = NEVER;
+	update(t);
+}
+
+/****************************************************************************/
+
+uint8_t NRF24Model::dataRate() const
+{
+	return _reg[RF_SETUP] & (NRF_BV(RF_DR_LOW) | NRF_BV(RF_DR_HIGH));
+}
+
+bool NRF24Model::dynamicPayload(uint8_t pipe) const
+{
+	return (_reg[FEATURE] & NRF_BV(EN_DPL)) && (_reg[DYNPD] & NRF_BV(pipe));
+}
+
+bool NRF24Model::matchAddress(uint8_t pipe, const uint8_t* address, uint8_t aw) const
+{
+	// Pipes 2-5 only own their LSB and share the other bytes with pipe 1
+	if (pipe >= 2) {
+		return address[0] == _addr[pipe][0] && memcmp(address + 1, _addr[1] + 1, aw - 1) == 0;
+	}
+	return memcmp(address, _addr[pipe], aw) == 0;
+}
+
+bool NRF24Model::carrierPresent() const
+{
+	if (NRF24Medium::carrier(_reg[RF_CH], worldTime)) return true;
+
+	// A radio in constant carrier mode (RF24::startConstCarrier()) is always on air
+	for (size_t i = 0; i < radios.size(); i++) {
+		const NRF24Model* r = radios[i];
+		if (r != this && r->_ce && (r->_reg[RF_SETUP] & NRF_BV(CONT_WAVE)) &&
+		    (r->_reg[NRF_CONFIG] & (NRF_BV(PWR_UP) | NRF_BV(PRIM_RX))) == NRF_BV(PWR_UP) &&
+		    r->_reg[RF_CH] == _reg[RF_CH]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void NRF24Model::sense(uint8_t channel)
+{
+	// RPD latches any signal seen on the channel while listening
+	if (_state == RX_MODE && _reg[RF_CH] == channel) _rpd = true;
+}
+
+bool NRF24Model::accepts(const NRF24Frame& f, uint64_t t, uint8_t* pipe) const
+{
+	if (_state != RX_MODE || t < _deaf_until) return false;
+	if (f.channel != _reg[RF_CH] || f.data_rate != dataRate()) return false;
+	if (f.aw != addressWidth() || f.crc != crcLength()) return false;
+
+	for (uint8_t p = 0; p < 6; p++) {
+		if (!(_reg[EN_RXADDR] & NRF_BV(p)) || !matchAddress(p, f.address, f.aw)) continue;
+
+		// A payload length mismatch corrupts the CRC check
+		if (dynamicPayload(p) != f.dynamic) return false;
+		if (!f.dynamic && _reg[RX_PW_P0 + p] != f.payload.len) return false;
+
+		*pipe = p;
+		return true;
+	}
+	return false;
+}
+
+bool NRF24Model::receive(const NRF24Frame& f, uint8_t pipe, uint64_t t, NRF24Frame* ack, bool* duplicate)
+{
+	_rpd = true;
+
+	// Same PID and CRC as the last packet on this pipe: a retransmission whose ACK got lost
+	uint32_t crc = 2166136261u;
+	for (uint8_t i = 0; i < f.payload.len; i++) crc = (crc ^ f.payload.data[i]) * 16777619u;
+	*duplicate = _last_pid[pipe] == f.pid && _last_crc[pipe] == crc;
+
+	if (!*duplicate) {
+		if (_rx_count == 3) {
+			_stats.rx_dropped++;
+			return false; // No ACK is sent while the RX FIFO is full
+		}
+		NRF24Payload& p = _rx_fifo[_rx_count++];
+		p = f.payload;
+		p.pipe = pipe;
+		_reg[NRF_STATUS] |= NRF_BV(RX_DR);
+		_stats.rx_ok++;
+		_last_pid[pipe] = f.pid;
+		_last_crc[pipe] = crc;
+	}
+
+	if (f.no_ack || !(_reg[EN_AA] & NRF_BV(pipe))) return false;
+
+	ack->sender = this;
+	ack->target = f.sender;
+	ack->channel = f.channel;
+	ack->data_rate = f.data_rate;
+	ack->aw = f.aw;
+	memcpy(ack->address, f.address, sizeof(ack->address));
+	ack->crc = f.crc;
+	ack->dynamic = f.dynamic;
+	ack->ack = true;
+	ack->no_ack = false;
+	ack->pid = f.pid;
+	memset(&ack->payload, 0, sizeof(ack->payload));
+	ack->payload.seq = f.payload.seq;
+
+	// Attach the first ack payload written for this pipe
+	for (uint8_t i = 0; i < _tx_count; i++) {
+		if (_tx_fifo[i].pipe != pipe) continue;
+		ack->payload.len = _tx_fifo[i].len;
+		memcpy(ack->payload.data, _tx_fifo[i].data, _tx_fifo[i].len);
+		memmove(&_tx_fifo[i], &_tx_fifo[i + 1], sizeof(NRF24Payload) * (--_tx_count - i));
+		_reg[NRF_STATUS] |= NRF_BV(TX_DS);
+		break;
+	}
+
+	ack->start = t + T_STBY2A;
+	ack->end = ack->start + airtime(ack->payload.len);
+	_deaf_until = ack->end;
+	return true;
+}
+
+bool NRF24Model::ackReceived(const NRF24Frame& f, uint64_t t)
+{
+	if (_state != TX_ACK_WAIT || f.payload.seq != _on_air.seq || f.channel != _reg[RF_CH]) return false;
+	if (!(_reg[EN_RXADDR] & NRF_BV(0)) || !matchAddress(0, f.address, f.aw)) return false;
+
+	if (f.payload.len) {
+		if (_rx_count < 3) {
+			NRF24Payload& p = _rx_fifo[_rx_count++];
+			p = f.payload;
+			p.pipe = 0;
+			_reg[NRF_STATUS] |= NRF_BV(RX_DR);
+			_stats.rx_ok++;
+		}
+		else {
+			_stats.rx_dropped++;
+		}
+	}
+	txComplete(t);
+	return true;
+}
@@ -0,0 +1,257 @@
+/*
+ * File:   nrf24.h
+ *
+ * In-memory model of a nRF24L01+ transceiver used by the Emulator driver.
+ *
+ * Every emulated chip keeps the full register map from nRF24L01.h, 3-deep
+ * TX and RX FIFOs and the CE driven state machine (power down, standby-I/II,
+ * RX and TX with Enhanced ShockBurst auto-ack and auto-retransmit timing).
+ *
+ * All radios of a process live in one emulated "world" that is advanced
+ * lazily to the current monotonic time whenever any radio is touched through
+ * SPI or GPIO, so timing is evaluated on the same clock RF24 uses for its own
+ * timeouts. Radios talk to each other through the virtual medium in medium.h.
+ */
+
+#ifndef NRF24_MODEL_H
+#define NRF24_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file nrf24.h
+ * \cond HIDDEN_SYMBOLS
+ * Class declaration for the emulated nRF24L01+
+ */
+
+struct NRF24Frame;
+
+/** Counters kept for every emulated radio */
+struct NRF24Stats {
+	uint64_t transactions; /**< SPI transactions, one per CSN low/high cycle */
+	uint64_t bytes;        /**< Bytes clocked over SPI */
+	uint64_t syscalls;     /**< Calls that enter the kernel on a real Linux backend (ioctl, gpio write) */
+	uint64_t ce_writes;    /**< Writes to the CE pin */
+	uint64_t tx_attempts;  /**< Packets put on air, retransmissions included */
+	uint64_t tx_ok;        /**< Packets completed with TX_DS */
+	uint64_t tx_failed;    /**< Packets completed with MAX_RT */
+	uint64_t rx_ok;        /**< Payloads stored into the RX FIFO */
+	uint64_t rx_dropped;   /**< Payloads lost because the RX FIFO was full */
+};
+
+/** One entry of the TX or RX FIFO */
+struct NRF24Payload {
+	uint8_t data[32];
+	uint8_t len;
+	uint8_t pipe;     /**< RX pipe, or target pipe of an ack payload */
+	bool no_ack;      /**< Written with W_TX_PAYLOAD_NO_ACK */
+	uint32_t seq;     /**< Identifies the entry while it is on air */
+};
+
+class NRF24Model {
+public:
+
+	/** Time value meaning "no event pending" */
+	static const uint64_t NEVER = ~(uint64_t)0;
+
+	/* nRF24L01+ timing (product specification v1.0, table 16) */
+	static const uint32_t T_PD2STBY = 1500; /**< Power down to standby, us */
+	static const uint32_t T_STBY2A = 130;   /**< Standby to active RX/TX (PLL settling), us */
+
+	enum State {
+		POWER_DOWN,
+		START_UP,
+		STANDBY_I,
+		STANDBY_II,
+		RX_SETTLE,
+		RX_MODE,
+		TX_SETTLE,
+		TX_MODE,
+		TX_ACK_WAIT
+	};
+
+	/**
+	 * Radio attached to SPI bus @p busNo, created on first use.
+	 * The bus number is the value RF24 passes to SPI::begin(), i.e. the csn pin.
+	 */
+	static NRF24Model* forBus(int busNo);
+
+	/** Radio attached to bus @p busNo, or NULL */
+	static NRF24Model* findBus(int busNo);
+
+	/** Radio that owns GPIO @p pin as CE or IRQ, or NULL */
+	static NRF24Model* findPin(int pin);
+
+	/**
+	 * Explicitly wire the CE and (optionally) IRQ pins of the radio on @p busNo.
+	 *
+	 * Not required for CE: RF24::begin() calls SPI::begin() and then configures
+	 * the CE pin as an output, and the first output opened after SPI::begin()
+	 * is bound as that radio's CE automatically.
+	 */
+	static void bindPins(int busNo, int cePin, int irqPin = -1);
+
+	/** Bind @p pin as CE of the radio most recently started with SPI::begin(), if it has none */
+	static bool claimPin(int pin);
+
+	/** Destroy every emulated radio */
+	static void resetAll();
+
+	/** Number of emulated radios */
+	static size_t count();
+
+	/** Emulated radio @p i, in creation order */
+	static NRF24Model* at(size_t i);
+
+	/** Microseconds on the emulation clock (CLOCK_MONOTONIC since first use) */
+	static uint64_t now();
+
+	/** Serialize access to the emulated world */
+	static void lock();
+	static void unlock();
+
+	/** Process every pending event of every radio up to @p t. Requires lock(). */
+	static void advance(uint64_t t);
+
+	/** Time of the next radio or medium event, NEVER if none. Requires lock(). */
+	static uint64_t nextEvent();
+
+	/**
+	 * Release the lock until time @p until or until another thread has
+	 * touched the world, whichever comes first. Requires lock().
+	 */
+	static void wait(uint64_t until);
+
+	/**
+	 * Perform one SPI transaction (CSN low, @p len bytes, CSN high).
+	 * @p tx and @p rx may point to the same buffer. Requires lock().
+	 */
+	void spiTransfer(const uint8_t* tx, uint8_t* rx, uint32_t len);
+
+	/** Drive the CE pin. Requires lock(). */
+	void setCE(bool level);
+
+	/** Level of the active-low IRQ pin: true when an unmasked interrupt is pending */
+	bool irqAsserted() const;
+
+	/** Current STATUS register value */
+	uint8_t status() const;
+
+	State state() const { return _state; }
+	int bus() const { return _bus; }
+	int cePin() const { return _ce_pin; }
+	int irqPin() const { return _irq_pin; }
+
+	/**
+	 * Brown-out: registers back to their reset values, FIFOs emptied and
+	 * powered down, like after a supply glitch. The counters are kept.
+	 * Requires lock().
+	 */
+	void powerOnReset();
+
+	NRF24Stats& stats() { return _stats; }
+	void resetStats();
+
+	/** Raw register file access for inspection by tests and benchmarks */
+	uint8_t reg(uint8_t r) const { return _reg[r & 0x1F]; }
+
+	/**
+	 * Called after every SPI transaction of any radio, with the world locked:
+	 * @p cmd is the command byte, @p status the STATUS clocked out with it
+	 */
+	typedef void (*TransferHook)(NRF24Model& radio, uint8_t cmd, uint8_t status);
+
+	/**
+	 * Run @p hook after every SPI transaction, NULL to stop. Lets a test act
+	 * between the transactions of one batch, where a real chip goes on
+	 * receiving. Requires lock().
+	 */
+	static void setTransferHook(TransferHook hook);
+
+	/**
+	 * Store a payload in the RX FIFO as if it had been received on @p pipe,
+	 * and raise RX_DR. Requires lock().
+	 * @return False if the RX FIFO is full
+	 */
+	bool inject(uint8_t pipe, const uint8_t* data, uint8_t len);
+
+private:
+
+	friend class NRF24Medium;
+
+	NRF24Model(int busNo);
+
+	int _bus;
+	int _ce_pin;
+	int _irq_pin;
+	bool _ce;
+	State _state;
+	uint64_t _next_event;
+
+	uint8_t _reg[0x20];
+	uint8_t _addr[7][5];   /* RX_ADDR_P0..P5 (P2-P5 use byte 0), TX_ADDR */
+	uint8_t _plos_cnt;
+	uint8_t _arc_cnt;
+	uint8_t _pid;
+	bool _rpd;
+	bool _tx_reuse;
+	uint64_t _deaf_until;  /* busy sending an auto-ack */
+
+	/* PID and CRC of the last packet received per pipe, to discard retransmissions */
+	uint8_t _last_pid[6];
+	uint32_t _last_crc[6];
+
+	NRF24Payload _tx_fifo[3];
+	uint8_t _tx_count;
+	NRF24Payload _rx_fifo[3];
+	uint8_t _rx_count;
+	uint32_t _seq;
+
+	NRF24Payload _on_air;  /* copy of the TX FIFO head being transmitted */
+	bool _on_air_ack;      /* the packet on air expects an acknowledgement */
+
+	NRF24Stats _stats;
+
+	void writeRegister(uint8_t r, const uint8_t* buf, uint32_t len);
+	uint8_t readRegister(uint8_t r, uint32_t index) const;
+	uint8_t fifoStatus() const;
+
+	void pushTx(const uint8_t* buf, uint32_t len, uint8_t pipe, bool no_ack);
+	void popTx(uint32_t seq);
+	void popRx();
+
+	uint8_t crcLength() const;
+	uint8_t addressWidth() const;
+	uint8_t dataRate() const;
+	bool dynamicPayload(uint8_t pipe) const;
+	bool matchAddress(uint8_t pipe, const uint8_t* address, uint8_t aw) const;
+	bool carrierPresent() const;
+	uint32_t airtime(uint8_t len) const;
+	uint32_t retransmitDelay() const;
+
+	void update(uint64_t t);
+	void process(uint64_t t);
+	void startTx(uint64_t t, bool retransmit);
+	void txComplete(uint64_t t);
+	void txFailed(uint64_t t);
+	void afterTx(uint64_t t);
+
+	/* Called by NRF24Medium */
+	void sense(uint8_t channel);
+	bool accepts(const NRF24Frame& f, uint64_t t, uint8_t* pipe) const;
+	bool receive(const NRF24Frame& f, uint8_t pipe, uint64_t t, NRF24Frame* ack, bool* duplicate);
+	bool ackReceived(const NRF24Frame& f, uint64_t t);
+};
+
+/** Scoped NRF24Model::lock() */
+class NRF24Lock {
+public:
+	NRF24Lock() { NRF24Model::lock(); }
+	~NRF24Lock() { NRF24Model::unlock(); }
+};
+
+/**
+ * \endcond
+ */
+#endif	/* NRF24_MODEL_H */
@@ -0,0 +1,134 @@
+/*
+ * File:   spi.cpp
+ *
+ * SPI layer of the Emulator driver. One call here is one CSN framed
+ * transaction, exactly like one SPI_IOC_MESSAGE ioctl on SPIDEV.
+ */
+
+#include "spi.h"
+
+#include <string.h>
+
+SPI::SPI():model(NULL), _spi_speed(RF24_EMULATOR_SPEED), _batch_len(0) {
+}
+
+void SPI::begin(int busNo,uint32_t spi_speed){
+	NRF24Lock lock;
+	model = NRF24Model::forBus(busNo);
+	_spi_speed = spi_speed;
+}
+
+uint8_t SPI::transfer(uint8_t tx)
+{
+	uint8_t rx;
+	transfernb((char*)&tx, (char*)&rx, 1);
+	return rx;
+}
+
+void SPI::transfernb(char* tbuf, char* rbuf, uint32_t len)
+{
+	if (model == NULL) throw SPIException("can't send spi message");
+
+	NRF24Lock lock;
+	NRF24Model::advance(NRF24Model::now());
+	model->stats().syscalls++;
+	model->spiTransfer((const uint8_t*)tbuf, (uint8_t*)rbuf, len);
+}
+
+void SPI::transferSegments(const SPISegment* segs, uint8_t count)
+{
+	if (count > RF24_SPI_SEGMENTS_MAX) throw SPIException("too many spi segments");
+	if (model == NULL) throw SPIException("can't send spi message");
+
+	Transfer transfers[RF24_SPI_SEGMENTS_MAX];
+	for (uint8_t i = 0; i < count; i++) {
+		transfers[i].tbuf = (const char*)segs[i].tbuf;
+		transfers[i].rbuf = (char*)segs[i].rbuf;
+		transfers[i].len = segs[i].len;
+		transfers[i].hold = i + 1 < count;
+	}
+
+	NRF24Lock lock;
+	NRF24Model::advance(NRF24Model::now());
+	model->stats().syscalls++;
+	run(transfers, count);
+}
+
+void SPI::beginBatch()
+{
+	_batch_len = 0;
+}
+
+void SPI::batch(char* tbuf, char* rbuf, uint32_t len)
+{
+	if (_batch_len == RF24_EMULATOR_BATCH_MAX) endBatch();
+
+	Transfer& t = _batch[_batch_len++];
+	t.tbuf = tbuf;
+	t.rbuf = rbuf;
+	t.len = len;
+	t.hold = false;
+}
+
+void SPI::batchSegments(const SPISegment* segs, uint8_t count)
+{
+	if (count > RF24_SPI_SEGMENTS_MAX) throw SPIException("too many spi segments");
+	if (_batch_len + count > RF24_EMULATOR_BATCH_MAX) endBatch();
+
+	for (uint8_t i = 0; i < count; i++) {
+		Transfer& t = _batch[_batch_len++];
+		t.tbuf = (const char*)segs[i].tbuf;
+		t.rbuf = (char*)segs[i].rbuf;
+		t.len = segs[i].len;
+		t.hold = i + 1 < count;
+	}
+}
+
+void SPI::endBatch()
+{
+	if (_batch_len == 0) return;
+	if (model == NULL) throw SPIException("can't send spi message");
+
+	NRF24Lock lock;
+	NRF24Model::advance(NRF24Model::now());
+	model->stats().syscalls++;
+	run(_batch, _batch_len);
+	_batch_len = 0;
+}
+
+// The radio model sees one buffer per chip select frame: segments held
+// together are gathered, sent as one transaction and scattered back
+void SPI::run(const Transfer* transfers, uint8_t count)
+{
+	uint8_t i = 0;
+	while (i < count) {
+		if (!transfers[i].hold && transfers[i].tbuf && transfers[i].rbuf) {
+			model->spiTransfer((const uint8_t*)transfers[i].tbuf, (uint8_t*)transfers[i].rbuf, transfers[i].len);
+			i++;
+			continue;
+		}
+
+		uint8_t tx[RF24_EMULATOR_FRAME_MAX];
+		uint8_t rx[RF24_EMULATOR_FRAME_MAX];
+		uint32_t len = 0;
+		uint8_t first = i;
+		do {
+			const Transfer& t = transfers[i];
+			if (len + t.len > sizeof(tx)) throw SPIException("spi message too long");
+			if (t.tbuf) memcpy(tx + len, t.tbuf, t.len);
+			else memset(tx + len, 0xFF, t.len);
+			len += t.len;
+		} while (transfers[i++].hold && i < count);
+
+		model->spiTransfer(tx, rx, len);
+
+		len = 0;
+		for (uint8_t j = first; j < i; j++) {
+			if (transfers[j].rbuf) memcpy(transfers[j].rbuf, rx + len, transfers[j].len);
+			len += transfers[j].len;
+		}
+	}
+}
+
+SPI::~SPI() {
+}
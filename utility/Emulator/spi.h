@@ -0,0 +1,164 @@
+/*
+ * File:   spi.h
+ *
+ * SPI layer of the Emulator driver. Same interface as utility/SPIDEV/spi.h,
+ * but every transaction is executed against an emulated nRF24L01+ (nrf24.h).
+ */
+
+#ifndef SPI_H
+#define	SPI_H
+
+/**
+ * @file spi.h
+ * \cond HIDDEN_SYMBOLS
+ * Class declaration for SPI helper files
+ */
+
+#include <inttypes.h>
+#include <stdexcept>
+#include "nrf24.h"
+
+#ifndef RF24_EMULATOR_SPEED
+/* 8MHz as default, like SPIDEV */
+#define RF24_EMULATOR_SPEED 8000000
+#endif
+
+#ifndef RF24_EMULATOR_BATCH_MAX
+/* Transfers queued before a batch is submitted on its own, every segment counts as one, like SPIDEV */
+#define RF24_EMULATOR_BATCH_MAX 16
+#endif
+
+/* beginBatch(), batch() and endBatch() are available */
+#define SPI_HAS_BATCH
+
+#ifndef RF24_SPI_SEGMENTS_MAX
+/* Segments in one transferSegments() or batchSegments() call */
+#define RF24_SPI_SEGMENTS_MAX 4
+#endif
+
+/* Longest chip select frame made of several segments */
+#define RF24_EMULATOR_FRAME_MAX 64
+
+/* Longest segment sent without a transmit buffer */
+#define RF24_SPI_NOP_MAX 32
+
+/* transferSegments() and batchSegments() are available */
+#define SPI_HAS_SEGMENTS
+
+/**
+ * One piece of a transfer made of several buffers, see transferSegments()
+ */
+struct SPISegment {
+	const void* tbuf; /**< Bytes to send, NULL to send NOPs (0xFF) */
+	void* rbuf; /**< Where the bytes clocked in go, NULL to discard them */
+	uint32_t len; /**< Length of the segment */
+};
+
+/** Specific excpetion for SPI errors */
+class SPIException : public std::runtime_error {
+	public:
+		explicit SPIException(const std::string& msg) :  std::runtime_error(msg) { }
+};
+
+
+class SPI {
+
+public:
+
+	/**
+	* SPI constructor
+	*/
+	SPI();
+
+	/**
+	* Start SPI, attaching to the emulated radio of bus @p busNo
+	*/
+	void begin(int busNo,uint32_t spi_speed=RF24_EMULATOR_SPEED);
+
+	/**
+	* Transfer a single byte
+	* @param tx Byte to send
+	* @return Data returned via spi
+	*/
+	uint8_t transfer(uint8_t tx);
+
+	/**
+	* Transfer a buffer of data
+	* @param tbuf Transmit buffer
+	* @param rbuf Receive buffer
+	* @param len Length of the data
+	*/
+	void transfernb(char* tbuf, char* rbuf, uint32_t len);
+
+	/**
+	* Transfer a buffer of data without an rx buffer
+	* @param buf Pointer to a buffer of data
+	* @param len Length of the data
+	*/
+	void transfern(char* buf, uint32_t len) {
+	  transfernb(buf, buf, len);
+	}
+
+	/**
+	* Transfer several buffers back to back with chip select held, as one
+	* command for the radio. Payloads go straight between the caller's
+	* buffers and the bus without being copied into a single one first.
+	* @param segs Segments, in the order they are clocked out
+	* @param count Number of segments, up to RF24_SPI_SEGMENTS_MAX
+	*/
+	void transferSegments(const SPISegment* segs, uint8_t count);
+
+	/**
+	* Start queueing transfers with batch() instead of sending them one by one
+	*/
+	void beginBatch();
+
+	/**
+	* Queue a transfer, chip select is released between queued transfers.
+	* Both buffers must stay valid until endBatch() returns, @p rbuf is only
+	* filled then.
+	*/
+	void batch(char* tbuf, char* rbuf, uint32_t len);
+
+	/**
+	* Queue a transfer made of several segments, chip select is held between
+	* them and released after the last one. The buffers must stay valid
+	* until endBatch() returns.
+	* @param segs Segments, in the order they are clocked out
+	* @param count Number of segments, up to RF24_SPI_SEGMENTS_MAX
+	*/
+	void batchSegments(const SPISegment* segs, uint8_t count);
+
+	/**
+	* Run all queued transfers back to back, counted as a single syscall
+	*/
+	void endBatch();
+
+	/**
+	* Emulated radio behind this bus, NULL before begin()
+	*/
+	NRF24Model* radio() { return model; }
+
+	~SPI();
+
+private:
+
+	NRF24Model* model;
+	uint32_t _spi_speed;
+
+	struct Transfer {
+		const char* tbuf;
+		char* rbuf;
+		uint32_t len;
+		bool hold; /**< Chip select stays low into the next transfer */
+	};
+	Transfer _batch[RF24_EMULATOR_BATCH_MAX];
+	uint8_t _batch_len;
+
+	void run(const Transfer* transfers, uint8_t count);
+};
+
+/**
+ * \endcond
+ */
+#endif	/* SPI_H */
@@ -5,6 +5,7 @@
   #include "spi.h"
   #include "gpio.h"
   #include "compatibility.h"
+  #include "../timing.h"
 
   #include <stdint.h>
   #include <stdio.h>
@@ -48,9 +49,10 @@
 
   #ifndef __TIME_H__
     // Prophet: Redefine time functions only if precompiled arduino time is not included
-	#define delay(milisec) __msleep(milisec)
-	#define delayMicroseconds(usec) __usleep(usec)
-	#define millis() __millis()
+	#define delay(milisec) rf24_delay_ms(milisec)
+	#define delayMicroseconds(usec) rf24_delay_us(usec)
+	#define millis() rf24_millis()
+	#define micros() ((uint32_t) rf24_micros())
   #endif
   
   #define INPUT mraa::DIR_IN
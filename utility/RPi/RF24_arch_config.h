@@ -13,6 +13,7 @@
   
   #include "bcm2835.h"
   #include "spi.h"
+  #include "../timing.h"
   #define _SPI spi
 	
   #if defined SPI_HAS_TRANSACTION && !defined SPI_UART && !defined SOFTSPI
@@ -37,6 +38,15 @@
 	#define IF_SERIAL_DEBUG(x)
   #endif
   
+  // Monotonic time and deadline based delays instead of the bcm2835 ones
+  #undef delay
+  #undef delayMicroseconds
+  #undef millis
+  #define delay(milisec) rf24_delay_ms(milisec)
+  #define delayMicroseconds(usec) rf24_delay_us(usec)
+  #define millis() rf24_millis()
+  #define micros() ((uint32_t) rf24_micros())
+
   #define digitalWrite(pin, value) bcm2835_gpio_write(pin, value)
   #define pinMode(pin,value) bcm2835_gpio_fsel(pin,value);
   #define OUTPUT BCM2835_GPIO_FSEL_OUTP
@@ -21,8 +21,6 @@ see <http://www.gnu.org/licenses/>
 #include "interrupt.h"
 #include <pthread.h>
 
-#define delay(x) bcm2835_delay(x)
-
 static pthread_mutex_t pinMutex = PTHREAD_MUTEX_INITIALIZER;
 static volatile int    pinPass = -1 ;
 
@@ -69,6 +67,71 @@ int waitForInterrupt (int pin, int mS)
 }
 
 
+int setupInterrupt (int pin, int mode)
+{
+  const char *modeS ;
+  char fName [64] ;
+  FILE *f ;
+  int count, i ;
+  char c ;
+
+  if (pin < 0 || pin > 63)
+    return -1 ;
+
+  /**/ if (mode == INT_EDGE_FALLING)
+    modeS = "falling" ;
+  else if (mode == INT_EDGE_RISING)
+    modeS = "rising" ;
+  else
+    modeS = "both" ;
+
+// Export the pin, fails harmlessly if it already is
+
+  if ((f = fopen ("/sys/class/gpio/export", "w")) != NULL)
+  {
+    fprintf (f, "%d\n", pin) ;
+    fclose (f) ;
+  }
+
+// udev may need a moment to grant access to a freshly exported pin
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/direction", pin) ;
+  for (i = 0 ; (f = fopen (fName, "w")) == NULL ; ++i)
+  {
+    if (i == 100)
+      return -1 ;
+    delay (10) ;
+  }
+  fprintf (f, "in\n") ;
+  fclose (f) ;
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/edge", pin) ;
+  if ((f = fopen (fName, "w")) == NULL)
+    return -1 ;
+  fprintf (f, "%s\n", modeS) ;
+  fclose (f) ;
+
+  if (sysFds [pin] == -1)
+  {
+    sprintf (fName, "/sys/class/gpio/gpio%d/value", pin) ;
+    if ((sysFds [pin] = open (fName, O_RDWR)) < 0)
+    {
+      sysFds [pin] = -1 ;
+      return -1 ;
+    }
+  }
+
+// Clear any edge already latched
+
+  ioctl (sysFds [pin], FIONREAD, &count) ;
+  for (i = 0 ; i < count ; ++i)
+    read (sysFds [pin], &c, 1) ;
+  lseek (sysFds [pin], 0, SEEK_SET) ;
+
+  return 0 ;
+}
+
+
 int piHiPri (const int pri)
 {
   struct sched_param sched ;
@@ -2,35 +2,58 @@
 #include <pthread.h>
 #include <unistd.h>
 
-static pthread_mutex_t spiMutex = PTHREAD_MUTEX_INITIALIZER;
-bool bcmIsInitialized = false;
+/* One lock per controller, a transaction on SPI0 doesn't block one on SPI1 */
+static pthread_mutex_t spiMutex[2] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
 
-SPI::SPI() {
+/* bcm2835_init() and the controller setup run once per process, whatever
+ * the number of radios */
+static pthread_once_t bcmOnce = PTHREAD_ONCE_INIT;
+static pthread_once_t spiOnce[2] = { PTHREAD_ONCE_INIT, PTHREAD_ONCE_INIT };
+static bool bcmIsInitialized = false;
+
+static void bcmInit() {
+    bcmIsInitialized = bcm2835_init();
+}
+
+static void spi0Begin() {
+    if (bcmIsInitialized) bcm2835_spi_begin();
+}
+
+static void spi1Begin() {
+    if (bcmIsInitialized) bcm2835_aux_spi_begin();
+}
+
+SPI::SPI():controller(1), cs(0) {
 
 }
 
 void SPI::begin( int busNo ) {
-    if(!bcmIsInitialized){	  
-      if (!bcm2835_init()){
-		return;
-	  }
+    pthread_once(&bcmOnce, bcmInit);
+    if (!bcmIsInitialized){
+        return;
+    }
+    if (busNo == BCM2835_SPI_CS0 || busNo == BCM2835_SPI_CS1) {
+        controller = 0;
+        cs = busNo;
+        pthread_once(&spiOnce[0], spi0Begin);
+    } else {
+        controller = 1;
+        pthread_once(&spiOnce[1], spi1Begin);
     }
-    bcmIsInitialized = true;
-    bcm2835_aux_spi_begin();
 }
 
 void SPI::beginTransaction(SPISettings settings){
 	if (geteuid() != 0){
 		throw -1;
 	}
-	pthread_mutex_lock (&spiMutex);
+	pthread_mutex_lock (&spiMutex[controller]);
 	setBitOrder(settings.border);
 	setDataMode(settings.dmode);
 	setClockDivider(settings.clck);
 }
 
 void SPI::endTransaction() {
-	pthread_mutex_unlock (&spiMutex);
+	pthread_mutex_unlock (&spiMutex[controller]);
 }
 
 void SPI::setBitOrder(uint8_t bit_order) {
@@ -38,20 +61,21 @@ void SPI::setBitOrder(uint8_t bit_order) {
 }
 
 void SPI::setDataMode(uint8_t data_mode) {
-  // bcm2835_spi_setDataMode(data_mode);
+  if (controller == 0) bcm2835_spi_setDataMode(data_mode);
   // bcm2835_aux_spi_setDataMode(data_mode);
 }
 
 void SPI::setClockDivider(uint16_t spi_speed) {
-	bcm2835_aux_spi_setClockDivider(spi_speed);
+	if (controller == 0) bcm2835_spi_setClockDivider(spi_speed);
+	else bcm2835_aux_spi_setClockDivider(spi_speed);
 }
 
 void SPI::chipSelect(int csn_pin){
-	// bcm2835_spi_chipSelect(csn_pin);
+	if (controller == 0) bcm2835_spi_chipSelect(cs);
 	// bcm2835_aux_spi_chipSelect(csn_pin);
 	delayMicroseconds(5);
 }
 
 SPI::~SPI() {
 
-}
\ No newline at end of file
+}
@@ -40,39 +40,50 @@ private:
 };
 
 
+/**
+ * One instance per radio. Chip select 0 and 1 (BCM 8 and 7) use the main
+ * SPI0 controller, every other chip select uses the auxiliary SPI1. A
+ * transaction only locks the controller it runs on, so radios on SPI0 and
+ * SPI1 can be driven from different threads at the same time.
+ */
 class SPI {
 public:
 
   SPI();
   virtual ~SPI();
   
-  inline static uint8_t transfer(uint8_t _data);
-  inline static void transfernb(char* tbuf, char* rbuf, uint32_t len);
-  inline static void transfern(char* buf, uint32_t len);  
+  inline uint8_t transfer(uint8_t _data);
+  inline void transfernb(char* tbuf, char* rbuf, uint32_t len);
+  inline void transfern(char* buf, uint32_t len);  
 
-  static void begin(int busNo);
-  static void end();
+  void begin(int busNo);
+  void end();
 
-  static void setBitOrder(uint8_t bit_order);
-  static void setDataMode(uint8_t data_mode);
-  static void setClockDivider(uint16_t spi_speed);
-  static void chipSelect(int csn_pin);
-  
-  static void beginTransaction(SPISettings settings);
-  static void endTransaction();
+  void setBitOrder(uint8_t bit_order);
+  void setDataMode(uint8_t data_mode);
+  void setClockDivider(uint16_t spi_speed);
+  void chipSelect(int csn_pin);
   
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
   
+private:
+
+  /* Controller of this instance: 0 for SPI0, 1 for the auxiliary SPI1 */
+  uint8_t controller;
+  /* SPI0 chip select */
+  uint8_t cs;
 };
 
 
 uint8_t SPI::transfer(uint8_t _data) {
-    // uint8_t data = bcm2835_spi_transfer(_data);
-    uint8_t data = bcm2835_aux_spi_transfer(_data); // spi_transfer for AUX SPI
-    return data;
+    if (controller == 0) return bcm2835_spi_transfer(_data);
+    return bcm2835_aux_spi_transfer(_data); // spi_transfer for AUX SPI
 }
 
 void SPI::transfernb(char* tbuf, char* rbuf, uint32_t len){
-   bcm2835_aux_spi_transfernb( tbuf, rbuf, len);
+   if (controller == 0) bcm2835_spi_transfernb(tbuf, rbuf, len);
+   else bcm2835_aux_spi_transfernb( tbuf, rbuf, len);
 }
 
 void SPI::transfern(char* buf, uint32_t len)
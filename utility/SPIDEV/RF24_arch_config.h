@@ -16,6 +16,7 @@
 #include "spi.h"
 #include "gpio.h"
 #include "compatibility.h"
+#include "../timing.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <time.h>
@@ -24,6 +25,14 @@
 
 #define RF24_SPI_SPEED RF24_SPIDEV_SPEED
 
+#if defined SPI_HAS_BATCH
+  #define RF24_SPI_BATCH
+#endif
+
+#if defined SPI_HAS_SEGMENTS
+  #define RF24_SPI_SEGMENTS
+#endif
+
 #define _BV(x) (1<<(x))
 #define _SPI spi
 
@@ -61,9 +70,10 @@ typedef uint16_t prog_uint16_t;
 #define OUTPUT GPIO::DIRECTION_OUT
 #define digitalWrite(pin, value) GPIO::write(pin, value)
 #define pinMode(pin, direction) GPIO::open(pin, direction)
-#define delay(milisec) __msleep(milisec)
-#define delayMicroseconds(usec) __usleep(usec)
-#define millis() __millis()
+#define delay(milisec) rf24_delay_ms(milisec)
+#define delayMicroseconds(usec) rf24_delay_us(usec)
+#define millis() rf24_millis()
+#define micros() ((uint32_t) rf24_micros())
 
 #endif // __ARCH_CONFIG_H__
 // vim:ai:cin:sts=2 sw=2 ft=cpp
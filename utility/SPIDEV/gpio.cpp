@@ -16,8 +16,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-
-std::map<int,GPIOfdCache_t> GPIO::cache;
+#include <pthread.h>
 
 GPIO::GPIO() {
 }
@@ -25,6 +24,197 @@ GPIO::GPIO() {
 GPIO::~GPIO() {
 }
 
+namespace {
+/* Scoped lock of a pthread mutex */
+struct Lock {
+	pthread_mutex_t& mutex;
+	Lock(pthread_mutex_t& m) : mutex(m) { pthread_mutex_lock(&mutex); }
+	~Lock() { pthread_mutex_unlock(&mutex); }
+};
+}
+
+#if defined (RF24_GPIOCHIP)
+
+/*
+ * GPIO character device backend (Linux 5.10+ uAPI v2).
+ *
+ * Every pin is requested once as a line and its request fd is kept in a
+ * flat table, so read() and write() are a single ioctl, under a mutex
+ * that is only ever contended while pins are set up, on the hot path
+ * instead of lseek() + read()/write() on /sys/class/gpio.
+ */
+
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "interrupt.h"
+
+#define GPIO_MAX_CHIPS 16
+
+int GPIO::lines[RF24_GPIO_MAX_PINS];
+
+/*
+ * Guards lines[] and every use of its fds. Radios in different threads set
+ * up their pins concurrently, and a line closed or requested again under a
+ * read() or write() would leave it an fd the kernel may have reused.
+ */
+static pthread_mutex_t requestMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* /dev/gpiochipN fds and line counts, opened on first use */
+static int chipFds[GPIO_MAX_CHIPS];
+static int chipLines[GPIO_MAX_CHIPS];
+static int chipCount = -1;
+
+static void openChips()
+{
+	chipCount = 0;
+	for (int i = 0; i < GPIO_MAX_CHIPS; i++) {
+		char file[32];
+		sprintf(file, "/dev/gpiochip%d", i);
+		int fd = ::open(file, O_RDWR | O_CLOEXEC);
+		if (fd < 0) break;
+
+		struct gpiochip_info info;
+		if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) < 0) {
+			::close(fd);
+			break;
+		}
+		chipFds[chipCount] = fd;
+		chipLines[chipCount] = info.lines;
+		chipCount++;
+	}
+	if (chipCount == 0) {
+		chipCount = -1;
+		throw GPIOException("can't open /dev/gpiochip0. check access rights");
+	}
+}
+
+int GPIO::request(int port, uint64_t flags, int value)
+{
+	if (chipCount < 0) {
+		for (int i = 0; i < RF24_GPIO_MAX_PINS; i++) lines[i] = -1;
+		openChips();
+	}
+	if (port < 0 || port >= RF24_GPIO_MAX_PINS) throw GPIOException("GPIO pin out of range");
+
+	// Find the chip and line offset of the pin
+	int chip = 0;
+	unsigned offset = port;
+	while (chip < chipCount && offset >= (unsigned) chipLines[chip]) offset -= chipLines[chip++];
+	if (chip == chipCount) throw GPIOException("GPIO pin out of range");
+
+	if (lines[port] >= 0) {
+		::close(lines[port]);
+		lines[port] = -1;
+	}
+
+	struct gpio_v2_line_request req;
+	memset(&req, 0, sizeof(req));
+	req.offsets[0] = offset;
+	req.num_lines = 1;
+	strcpy(req.consumer, "RF24");
+	req.config.flags = flags;
+	if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+		req.config.num_attrs = 1;
+		req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+		req.config.attrs[0].attr.values = value ? 1 : 0;
+		req.config.attrs[0].mask = 1;
+	}
+	if (ioctl(chipFds[chip], GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+		throw GPIOException("can't request GPIO line. check access rights or if it is in use");
+	}
+	lines[port] = req.fd;
+	return req.fd;
+}
+
+void GPIO::open(int port, int DDR)
+{
+	Lock lock(requestMutex);
+	request(port, DDR == DIRECTION_IN ? GPIO_V2_LINE_FLAG_INPUT : GPIO_V2_LINE_FLAG_OUTPUT, 0);
+}
+
+void GPIO::close(int port)
+{
+	Lock lock(requestMutex);
+
+	if (port < 0 || port >= RF24_GPIO_MAX_PINS || chipCount < 0) return;
+	if (lines[port] >= 0) {
+		::close(lines[port]);
+		lines[port] = -1;
+	}
+}
+
+int GPIO::read(int port)
+{
+	Lock lock(requestMutex);
+	int fd = (port >= 0 && port < RF24_GPIO_MAX_PINS && chipCount >= 0) ? lines[port] : -1;
+	if (fd < 0) fd = request(port, GPIO_V2_LINE_FLAG_INPUT, 0);
+
+	struct gpio_v2_line_values values;
+	values.bits = 0;
+	values.mask = 1;
+	if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) throw GPIOException("can't access to GPIO");
+	return values.bits & 1;
+}
+
+void GPIO::write(int port, int value)
+{
+	Lock lock(requestMutex);
+	int fd = (port >= 0 && port < RF24_GPIO_MAX_PINS && chipCount >= 0) ? lines[port] : -1;
+	if (fd < 0) {
+		request(port, GPIO_V2_LINE_FLAG_OUTPUT, value);
+		return;
+	}
+
+	struct gpio_v2_line_values values;
+	values.bits = value ? 1 : 0;
+	values.mask = 1;
+	if (ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) throw GPIOException("can't access to GPIO");
+}
+
+int GPIO::openEdge(int port, int edge)
+{
+	uint64_t flags = GPIO_V2_LINE_FLAG_INPUT;
+	if (edge == INT_EDGE_FALLING) flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	else if (edge == INT_EDGE_RISING) flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+	else flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING | GPIO_V2_LINE_FLAG_EDGE_RISING;
+
+	Lock lock(requestMutex);
+	try {
+		return request(port, flags, 0);
+	} catch (GPIOException&) {
+		return -1;
+	}
+}
+
+uint64_t GPIO::readEdge(int port)
+{
+	Lock lock(requestMutex);
+	if (port < 0 || port >= RF24_GPIO_MAX_PINS || chipCount < 0 || lines[port] < 0) return 0;
+
+	// A read returns as many whole events as fit, keep the newest. Only
+	// called once poll() saw events, so it doesn't block with the lock held
+	struct gpio_v2_line_event events[16];
+	ssize_t len = ::read(lines[port], events, sizeof(events));
+	if (len < (ssize_t) sizeof(events[0])) return 0;
+	return events[len / sizeof(events[0]) - 1].timestamp_ns;
+}
+
+#else
+
+std::map<int,GPIOfdCache_t> GPIO::cache;
+
+/* Guards the fd cache, radios in different threads open their pins concurrently */
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Cached fd of a pin, -1 if it isn't open */
+static int cachedFd(std::map<int,GPIOfdCache_t>& cache, int port)
+{
+	Lock lock(cacheMutex);
+	std::map<int,GPIOfdCache_t>::iterator i = cache.find(port);
+	return i == cache.end() ? -1 : i->second;
+}
+
 void GPIO::open(int port, int DDR)
 {
 	FILE *f;
@@ -65,6 +255,9 @@ void GPIO::open(int port, int DDR)
 	if(fd<0) {
 		throw GPIOException("Can't open the GPIO");
 	} else {
+		Lock lock(cacheMutex);
+		std::map<int,GPIOfdCache_t>::iterator i = cache.find(port);
+		if(i != cache.end()) ::close(i->second); // opened again, drop the old fd
 		cache[port]=fd;  // cache the fd;
 		lseek(fd,SEEK_SET,0);
 	}
@@ -73,11 +266,14 @@ void GPIO::open(int port, int DDR)
 
 void GPIO::close(int port)
 {
-  std::map<int,GPIOfdCache_t>::iterator i;
-	i=cache.find(port);
-	if(i!=cache.end()){
-		close(i->second); // close the cached fd
-		cache.erase(i); // Delete cache entry
+	{
+		Lock lock(cacheMutex);
+		std::map<int,GPIOfdCache_t>::iterator i;
+		i=cache.find(port);
+		if(i!=cache.end()){
+			::close(i->second); // close the cached fd
+			cache.erase(i); // Delete cache entry
+		}
 	}
 	// Do unexport
 	FILE *f;
@@ -90,15 +286,12 @@ void GPIO::close(int port)
 
 int GPIO::read(int port)
 {
-  std::map<int,GPIOfdCache_t>::iterator i;
-  int fd;
-	i=cache.find(port);
-	if(i==cache.end()){ // Fallback to open the gpio
+	int fd=cachedFd(cache,port);
+	if(fd<0){ // Fallback to open the gpio
 		GPIO::open(port,GPIO::DIRECTION_IN);
-		i=cache.find(port);
-		if(i==cache.end()) throw GPIOException("can't access to GPIO");
-		else fd=i->second;
-	} else fd=i->second;
+		fd=cachedFd(cache,port);
+		if(fd<0) throw GPIOException("can't access to GPIO");
+	}
 
 	char c;
 	if(lseek(fd,0,SEEK_SET)==0 && ::read(fd,&c,1)==1){
@@ -118,15 +311,12 @@ int GPIO::read(int port)
 */
 }
 void GPIO::write(int port, int value){
-	std::map<int,GPIOfdCache_t>::iterator i;
-  int fd;
-	i=cache.find(port);
-	if(i==cache.end()){ // Fallback to open the gpio
+	int fd=cachedFd(cache,port);
+	if(fd<0){ // Fallback to open the gpio
 		GPIO::open(port,GPIO::DIRECTION_OUT);
-		i=cache.find(port);
-		if(i==cache.end()) throw GPIOException("can't access to GPIO");
-		else fd=i->second;
-	} else fd=i->second;
+		fd=cachedFd(cache,port);
+		if(fd<0) throw GPIOException("can't access to GPIO");
+	}
 
 	if(lseek(fd,0,SEEK_SET)!=0) throw GPIOException("can't access to GPIO");
 	int l=(value==0) ? ::write(fd,"0\n",2) : ::write(fd,"1\n",2);
@@ -143,3 +333,5 @@ void GPIO::write(int port, int value){
 
 	fclose(f);*/
 }
+
+#endif
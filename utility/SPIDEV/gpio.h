@@ -15,6 +15,7 @@
 #include <cstdio>
 #include <map>
 #include <stdexcept>
+#include <stdint.h>
 
 /** Specific excpetion for SPI errors */
 class GPIOException : public std::runtime_error {
@@ -40,6 +41,14 @@ class GPIOException : public std::runtime_error {
 
 typedef int GPIOfdCache_t;
 
+/**
+ * With the gpiochip backend (configure --gpio=gpiochip), pins are numbered
+ * across the GPIO character devices in order: pin N is
+ * line N of /dev/gpiochip0, the lines of gpiochip1 follow, and so on. On
+ * the Raspberry Pi this is the BCM numbering.
+ */
+#define RF24_GPIO_MAX_PINS 512
+
 class GPIO {
 public:
 
@@ -76,11 +85,34 @@ public:
 	*/
 	static void write(int port,int value);
 
+#if defined (RF24_GPIOCHIP)
+	/**
+	 * Request a pin as an input reporting edge events
+     * @param port
+     * @param edge INT_EDGE_FALLING, INT_EDGE_RISING or INT_EDGE_BOTH
+     * @return File descriptor that polls POLLIN on an event, -1 on failure
+     */
+	static int openEdge(int port, int edge);
+	/**
+	 * Consume the pending edge events of a pin opened with openEdge()
+     * @param port
+     * @return CLOCK_MONOTONIC kernel timestamp of the last event in ns, 0 if none
+     */
+	static uint64_t readEdge(int port);
+#endif
+
 	virtual ~GPIO();
 
 private:
+#if defined (RF24_GPIOCHIP)
+  /* line request fd of every pin, -1 if not requested */
+  static int lines[RF24_GPIO_MAX_PINS];
+  /* (re)requests a line, the caller holds the request lock */
+  static int request(int port, uint64_t flags, int value);
+#else
   /* fd cache */
   static std::map<int,GPIOfdCache_t> cache;
+#endif
 };
 /**
  * \endcond
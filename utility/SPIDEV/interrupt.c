@@ -41,10 +41,16 @@ static int sysFds [64] =
 // ISR Data
 static void (*isrFunctions [64])(void) ;
 
+// eventTimes:
+//      CLOCK_MONOTONIC time in ns of the last edge seen by waitForInterrupt
+static uint64_t eventTimes [64] ;
+
 int waitForInterrupt (int pin, int mS)
 {
   int fd, x ;
+#if !defined (RF24_GPIOCHIP)
   uint8_t c ;
+#endif
   struct pollfd polls ;
 
   if ((fd = sysFds [pin]) == -1)
@@ -53,11 +59,21 @@ int waitForInterrupt (int pin, int mS)
 // Setup poll structure
 
   polls.fd     = fd ;
+#if defined (RF24_GPIOCHIP)
+  polls.events = POLLIN ;       // Line event queued
+#else
   polls.events = POLLPRI ;      // Urgent data!
+#endif
 
 // Wait for it ...
   x = poll (&polls, 1, mS) ;
 
+#if defined (RF24_GPIOCHIP)
+// Consume the queued events, keeping the kernel timestamp
+
+  if (x > 0)
+    eventTimes [pin] = GPIO::readEdge (pin) ;
+#else
 // Do a dummy read to clear the interrupt
 //      A one character read appars to be enough.
 //      Followed by a seek to reset it.
@@ -65,10 +81,99 @@ int waitForInterrupt (int pin, int mS)
   (void)read (fd, &c, 1) ;
   lseek (fd, 0, SEEK_SET) ;
 
+  if (x > 0)
+  {
+    struct timespec now ;
+    clock_gettime (CLOCK_MONOTONIC, &now) ;
+    eventTimes [pin] = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec ;
+  }
+#endif
+
   return x ;
 }
 
 
+uint64_t interruptTime (int pin)
+{
+  return (pin < 0 || pin > 63) ? 0 : eventTimes [pin] ;
+}
+
+
+int setupInterrupt (int pin, int mode)
+{
+#if defined (RF24_GPIOCHIP)
+// Request the line with edge detection, no sysfs involved
+
+  if (pin < 0 || pin > 63)
+    return -1 ;
+
+  sysFds [pin] = GPIO::openEdge (pin, mode) ;
+  return sysFds [pin] < 0 ? -1 : 0 ;
+#else
+  const char *modeS ;
+  char fName [64] ;
+  FILE *f ;
+  int count, i ;
+  char c ;
+
+  if (pin < 0 || pin > 63)
+    return -1 ;
+
+  /**/ if (mode == INT_EDGE_FALLING)
+    modeS = "falling" ;
+  else if (mode == INT_EDGE_RISING)
+    modeS = "rising" ;
+  else
+    modeS = "both" ;
+
+// Export the pin, fails harmlessly if it already is
+
+  if ((f = fopen ("/sys/class/gpio/export", "w")) != NULL)
+  {
+    fprintf (f, "%d\n", pin) ;
+    fclose (f) ;
+  }
+
+// udev may need a moment to grant access to a freshly exported pin
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/direction", pin) ;
+  for (i = 0 ; (f = fopen (fName, "w")) == NULL ; ++i)
+  {
+    if (i == 100)
+      return -1 ;
+    delay (10) ;
+  }
+  fprintf (f, "in\n") ;
+  fclose (f) ;
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/edge", pin) ;
+  if ((f = fopen (fName, "w")) == NULL)
+    return -1 ;
+  fprintf (f, "%s\n", modeS) ;
+  fclose (f) ;
+
+  if (sysFds [pin] == -1)
+  {
+    sprintf (fName, "/sys/class/gpio/gpio%d/value", pin) ;
+    if ((sysFds [pin] = open (fName, O_RDWR)) < 0)
+    {
+      sysFds [pin] = -1 ;
+      return -1 ;
+    }
+  }
+
+// Clear any edge already latched
+
+  ioctl (sysFds [pin], FIONREAD, &count) ;
+  for (i = 0 ; i < count ; ++i)
+    read (sysFds [pin], &c, 1) ;
+  lseek (sysFds [pin], 0, SEEK_SET) ;
+
+  return 0 ;
+#endif
+}
+
+
 int piHiPri (const int pri)
 {
   struct sched_param sched ;
@@ -107,16 +212,22 @@ void *interruptHandler (void *arg)
 
 int attachInterrupt (int pin, int mode, void (*function)(void))
 {
+#if !defined (RF24_GPIOCHIP)
   const char *modeS ;
   char fName   [64] ;
   char  pinS [8] ;
   pid_t pid ;
   int   count, i ;
   char  c ;
+#endif
   int   bcmGpioPin ;
 
   bcmGpioPin = pin ;
 
+#if defined (RF24_GPIOCHIP)
+  if (setupInterrupt (bcmGpioPin, mode == INT_EDGE_SETUP ? INT_EDGE_BOTH : mode) < 0)
+    return printf ("wiringPiISR: unable to request GPIO line %d\n", bcmGpioPin) ;
+#else
   if (mode != INT_EDGE_SETUP)
   {
     /**/ if (mode == INT_EDGE_FALLING)
@@ -160,6 +271,7 @@ int attachInterrupt (int pin, int mode, void (*function)(void))
     ioctl (sysFds [bcmGpioPin], FIONREAD, &count) ;
   for (i = 0 ; i < count ; ++i)
     read (sysFds [bcmGpioPin], &c, 1) ;
+#endif
 
   isrFunctions [pin] = function ;
 
@@ -175,16 +287,24 @@ int attachInterrupt (int pin, int mode, void (*function)(void))
 
 int detachInterrupt (int pin)
 {
+#if !defined (RF24_GPIOCHIP)
 	char  pinS [8];
     const char *modeS = "none";
 	pid_t pid ;
+#endif
 	
-	if (!pthread_cancel(threadId[pin])) //Cancel the thread
+	if (pthread_cancel(threadId[pin]) != 0) //Cancel the thread
 	{
 	 return 0;
 	}
+
+#if defined (RF24_GPIOCHIP)
+	GPIO::close(pin); //Release the line, this also stops edge detection
+	sysFds[pin] = -1;
+	return 1;
+#else
 	
-	if (!close(sysFds[pin])) //Close filehandle
+	if (close(sysFds[pin]) != 0) //Close filehandle
 	{
 		return 0;
 	}
@@ -215,6 +335,7 @@ int detachInterrupt (int pin)
       wait (NULL) ;
 	  
 	return 1;
+#endif
 }
 
 void rfNoInterrupts(){
@@ -14,6 +14,9 @@ see <http://www.gnu.org/licenses/>
 #define INT_EDGE_RISING         2
 #define INT_EDGE_BOTH           3
 
+/* setupInterrupt() and waitForInterrupt() are available, see RF24::waitForEvent() */
+#define RF24_IRQ_WAIT
+
 /*
  * interruptHandler:
  *      This is a thread and gets started to wait for the interrupt we're
@@ -37,6 +40,26 @@ extern "C" {
  */
 extern int waitForInterrupt (int pin, int mS);
 
+/*
+ * setupInterrupt:
+ *      Export the pin as an input and arm edge detection on it through
+ *      /sys/class/gpio (or request it as a line with edge detection on
+ *      the gpiochip backend), without starting a handler thread, so that
+ *      waitForInterrupt() can be used directly.
+ *      Returns 0, or -1 if the pin could not be set up.
+ *********************************************************************************
+ */
+extern int setupInterrupt (int pin, int mode);
+
+/*
+ * interruptTime:
+ *      CLOCK_MONOTONIC time in ns of the last edge waitForInterrupt() saw
+ *      on the pin. The kernel timestamps the edge itself with gpiochip,
+ *      with sysfs this is the time poll() returned.
+ *********************************************************************************
+ */
+extern uint64_t interruptTime (int pin);
+
 /*
  * piHiPri:
  *      Attempt to set a high priority schedulling for the running program
@@ -13,7 +13,6 @@
 #include "spi.h"
 
 #include <fcntl.h>
-#include <linux/spi/spidev.h>
 #include <memory.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,17 +21,42 @@
 
 #define RF24_SPIDEV_BITS 8
 
-SPI::SPI():fd(-1), _spi_speed(RF24_SPIDEV_SPEED) {
+/* Transmit buffer of segments without one, R_RX_PAYLOAD clocks out NOPs */
+static const uint8_t nops[RF24_SPI_NOP_MAX] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+/* Fill one spi_ioc_transfer per segment, chip select held in between */
+static void fillSegments(struct spi_ioc_transfer* tr, const SPISegment* segs, uint8_t count, uint32_t speed)
+{
+	for (uint8_t i = 0; i < count; i++) {
+		if (segs[i].tbuf == NULL && segs[i].len > RF24_SPI_NOP_MAX) throw SPIException("spi segment too long");
+		memset(&tr[i], 0, sizeof(tr[i]));
+		tr[i].tx_buf = (unsigned long)( segs[i].tbuf ? segs[i].tbuf : nops );
+		tr[i].rx_buf = (unsigned long)segs[i].rbuf; // 0: the kernel discards what is clocked in
+		tr[i].len = segs[i].len;
+		tr[i].speed_hz = speed;
+		tr[i].delay_usecs = 0;
+		tr[i].bits_per_word = RF24_SPIDEV_BITS;
+		tr[i].cs_change = 0;
+	}
 }
 
-bool spiIsInitialized = 0;
+SPI::SPI():fd(-1), _bus(-1), _spi_speed(RF24_SPIDEV_SPEED), _batch_len(0) {
+}
 
 void SPI::begin(int busNo,uint32_t spi_speed){
-	
-	if(spiIsInitialized){
-       return; 
-    }
-    
+
+	/* Every instance owns its own /dev/spidevX.Y, the kernel serializes
+	 * the messages of devices sharing a controller. Calling begin() again
+	 * on the same bus only applies the speed.
+	 * */
+	if(this->fd >= 0 && _bus == busNo){
+		init(spi_speed);
+		return;
+	}
+
     /* set spidev accordingly to busNo like:
      * busNo = 23 -> /dev/spidev2.3
      *
@@ -47,7 +71,7 @@ void SPI::begin(int busNo,uint32_t spi_speed){
 		this->fd=-1;
 	}
 
-	this->fd = open(device, O_RDWR);
+	this->fd = open(device, O_RDWR | O_CLOEXEC);
   if (this->fd < 0) throw SPIException("can't open device");
 	/*
   {
@@ -55,7 +79,7 @@ void SPI::begin(int busNo,uint32_t spi_speed){
         abort();
 
   }*/
-    spiIsInitialized = true;
+	_bus = busNo;
 	init(spi_speed);
 }
 
@@ -162,6 +186,61 @@ void SPI::transfernb(char* tbuf, char* rbuf, uint32_t len)
 	}*/
 }
 
+void SPI::transferSegments(const SPISegment* segs, uint8_t count)
+{
+	if (count > RF24_SPI_SEGMENTS_MAX) throw SPIException("too many spi segments");
+
+	struct spi_ioc_transfer tr[RF24_SPI_SEGMENTS_MAX];
+	fillSegments(tr, segs, count, _spi_speed);
+
+	int ret;
+	ret = ioctl(this->fd, SPI_IOC_MESSAGE(count), tr);
+	if (ret < 1) throw SPIException("can't send spi message");
+}
+
+void SPI::beginBatch()
+{
+	_batch_len = 0;
+}
+
+void SPI::batch(char* tbuf, char* rbuf, uint32_t len)
+{
+	if (_batch_len == RF24_SPIDEV_BATCH_MAX) endBatch();
+
+	struct spi_ioc_transfer& tr = _batch[_batch_len++];
+	memset(&tr, 0, sizeof(tr));
+	tr.tx_buf = (unsigned long)tbuf;
+	tr.rx_buf = (unsigned long)rbuf;
+	tr.len = len;
+	tr.speed_hz = _spi_speed;
+	tr.delay_usecs = 0;
+	tr.bits_per_word = RF24_SPIDEV_BITS;
+	tr.cs_change = 1; // every queued transfer is a separate command for the radio
+}
+
+void SPI::batchSegments(const SPISegment* segs, uint8_t count)
+{
+	if (count > RF24_SPI_SEGMENTS_MAX) throw SPIException("too many spi segments");
+	if (_batch_len + count > RF24_SPIDEV_BATCH_MAX) endBatch();
+
+	fillSegments(_batch + _batch_len, segs, count, _spi_speed);
+	_batch_len += count;
+	_batch[_batch_len - 1].cs_change = 1; // the next queued transfer is another command
+}
+
+void SPI::endBatch()
+{
+	if (_batch_len == 0) return;
+
+	// cs_change on the last transfer would keep the chip selected after the message
+	_batch[_batch_len - 1].cs_change = 0;
+
+	int ret;
+	ret = ioctl(this->fd, SPI_IOC_MESSAGE(_batch_len), _batch);
+	_batch_len = 0;
+	if (ret < 1) throw SPIException("can't send spi message");
+}
+
 SPI::~SPI() {
 	if (this->fd >= 0) close(this->fd);
 }
@@ -25,12 +25,41 @@
 
 #include <inttypes.h>
 #include <stdexcept>
+#include <linux/spi/spidev.h>
 
 #ifndef RF24_SPIDEV_SPEED
 /* 8MHz as default */
 #define RF24_SPIDEV_SPEED 8000000
 #endif
 
+#ifndef RF24_SPIDEV_BATCH_MAX
+/* Transfers queued before a batch is submitted on its own, every segment counts as one */
+#define RF24_SPIDEV_BATCH_MAX 16
+#endif
+
+/* beginBatch(), batch() and endBatch() are available */
+#define SPI_HAS_BATCH
+
+#ifndef RF24_SPI_SEGMENTS_MAX
+/* Segments in one transferSegments() or batchSegments() call */
+#define RF24_SPI_SEGMENTS_MAX 4
+#endif
+
+/* Longest segment sent without a transmit buffer */
+#define RF24_SPI_NOP_MAX 32
+
+/* transferSegments() and batchSegments() are available */
+#define SPI_HAS_SEGMENTS
+
+/**
+ * One piece of a transfer made of several buffers, see transferSegments()
+ */
+struct SPISegment {
+	const void* tbuf; /**< Bytes to send, NULL to send NOPs (0xFF) */
+	void* rbuf; /**< Where the bytes clocked in go, NULL to discard them */
+	uint32_t len; /**< Length of the segment */
+};
+
 /** Specific excpetion for SPI errors */
 class SPIException : public std::runtime_error {
 	public:
@@ -48,7 +77,7 @@ public:
 	SPI();
 
 	/**
-	* Start SPI
+	* Start SPI, opens /dev/spidev\<busNo/10\>.\<busNo%10\> for this instance
 	*/
 	void begin(int busNo,uint32_t spi_speed=RF24_SPIDEV_SPEED);
 
@@ -76,13 +105,55 @@ public:
 	  transfernb(buf, buf, len);
 	}
 
+	/**
+	* Transfer several buffers back to back with chip select held, as one
+	* command for the radio. Payloads go straight between the caller's
+	* buffers and the bus without being copied into a single one first.
+	* @param segs Segments, in the order they are clocked out
+	* @param count Number of segments, up to RF24_SPI_SEGMENTS_MAX
+	*/
+	void transferSegments(const SPISegment* segs, uint8_t count);
+
+	/**
+	* Start queueing transfers with batch() instead of sending them one by one
+	*/
+	void beginBatch();
+
+	/**
+	* Queue a transfer, chip select is released between queued transfers.
+	* Both buffers must stay valid until endBatch() returns, @p rbuf is only
+	* filled then.
+	* @param tbuf Transmit buffer
+	* @param rbuf Receive buffer
+	* @param len Length of the data
+	*/
+	void batch(char* tbuf, char* rbuf, uint32_t len);
+
+	/**
+	* Queue a transfer made of several segments, chip select is held between
+	* them and released after the last one. The buffers must stay valid
+	* until endBatch() returns.
+	* @param segs Segments, in the order they are clocked out
+	* @param count Number of segments, up to RF24_SPI_SEGMENTS_MAX
+	*/
+	void batchSegments(const SPISegment* segs, uint8_t count);
+
+	/**
+	* Send all queued transfers with a single SPI_IOC_MESSAGE ioctl
+	*/
+	void endBatch();
+
 	~SPI();
 
 private:
 
 	int fd;
+	int _bus;
 	uint32_t _spi_speed;
 
+	struct spi_ioc_transfer _batch[RF24_SPIDEV_BATCH_MAX];
+	uint8_t _batch_len;
+
 	void init(uint32_t spi_speed=RF24_SPIDEV_SPEED);
 };
 
@@ -0,0 +1,129 @@
+/*
+ * File:   timing.c
+ *
+ * Monotonic timekeeping and delays shared by the Linux drivers.
+ */
+
+#include "timing.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined (__i386__) || defined (__x86_64__)
+  #define CPU_RELAX() __builtin_ia32_pause()
+#elif defined (__aarch64__) || (defined (__arm__) && (__ARM_ARCH >= 7 || defined (__ARM_ARCH_6K__) || defined (__ARM_ARCH_6ZK__)))
+  #define CPU_RELAX() __asm__ __volatile__ ("yield")
+#else
+  #define CPU_RELAX()
+#endif
+
+#define CALIBRATION_RUNS 16
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static uint64_t epoch;          /* CLOCK_MONOTONIC at first use, ns */
+static uint32_t spinThreshold;  /* us, see rf24_spin_threshold() */
+
+static uint64_t monotonic(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int compare(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+static void init(void)
+{
+	const char* env = getenv("RF24_SPIN_US");
+
+	epoch = monotonic();
+	if (env != NULL) {
+		spinThreshold = strtoul(env, NULL, 10);
+		return;
+	}
+
+	// How late does the shortest possible sleep return? Any sleep aimed
+	// closer than that to a deadline would overshoot it.
+	uint64_t late[CALIBRATION_RUNS];
+	for (int i = 0; i < CALIBRATION_RUNS; i++) {
+		struct timespec req = { 0, 1000 };
+		uint64_t start = monotonic();
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &req, NULL);
+		late[i] = monotonic() - start;
+	}
+	qsort(late, CALIBRATION_RUNS, sizeof(late[0]), compare);
+
+	// 3rd quartile plus some margin, within sane bounds
+	uint32_t us = late[CALIBRATION_RUNS * 3 / 4] / 1000 + 10;
+	spinThreshold = us < 20 ? 20 : us > 2000 ? 2000 : us;
+}
+
+/****************************************************************************/
+
+uint64_t rf24_micros(void)
+{
+	pthread_once(&once, init);
+	return (monotonic() - epoch) / 1000;
+}
+
+uint32_t rf24_millis(void)
+{
+	pthread_once(&once, init);
+	return (uint32_t)((monotonic() - epoch) / 1000000);
+}
+
+uint32_t rf24_spin_threshold(void)
+{
+	pthread_once(&once, init);
+	return __atomic_load_n(&spinThreshold, __ATOMIC_RELAXED);
+}
+
+void rf24_set_spin_threshold(uint32_t us)
+{
+	pthread_once(&once, init);
+	__atomic_store_n(&spinThreshold, us, __ATOMIC_RELAXED);
+}
+
+/****************************************************************************/
+
+static void sleepUntil(uint64_t deadline)
+{
+	uint64_t spin = (uint64_t)__atomic_load_n(&spinThreshold, __ATOMIC_RELAXED) * 1000;
+
+	// Sleep to an absolute time, so that being preempted or interrupted
+	// by a signal never stretches the wait
+	if (deadline > spin && monotonic() < deadline - spin) {
+		struct timespec wake;
+		wake.tv_sec = (deadline - spin) / 1000000000ULL;
+		wake.tv_nsec = (deadline - spin) % 1000000000ULL;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+			;
+	}
+
+	while (monotonic() < deadline)
+		CPU_RELAX();
+}
+
+void rf24_sleep_until(uint64_t deadline)
+{
+	pthread_once(&once, init);
+	sleepUntil(epoch + deadline * 1000);
+}
+
+void rf24_delay_us(uint32_t us)
+{
+	pthread_once(&once, init);
+	sleepUntil(monotonic() + (uint64_t)us * 1000);
+}
+
+void rf24_delay_ms(uint32_t ms)
+{
+	pthread_once(&once, init);
+	sleepUntil(monotonic() + (uint64_t)ms * 1000000);
+}
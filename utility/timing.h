@@ -0,0 +1,62 @@
+/*
+ * File:   timing.h
+ *
+ * Monotonic timekeeping and delays shared by the Linux drivers.
+ *
+ * Every clock reading comes from CLOCK_MONOTONIC, counted from the first
+ * call into this module, so wall clock adjustments never disturb RF24
+ * timeouts. Delays sleep towards an absolute deadline and spin the last
+ * stretch, so short waits such as the 10us CE pulse or the 130us PLL
+ * settling are neither rounded up to a scheduler tick nor cut short.
+ */
+
+#ifndef RF24_TIMING_H
+#define RF24_TIMING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @file timing.h
+ * \cond HIDDEN_SYMBOLS
+ * Delay and timekeeping functions of the Linux drivers
+ */
+
+/** Microseconds since the first call into this module */
+uint64_t rf24_micros(void);
+
+/** Milliseconds since the first call into this module, wraps like Arduino millis() */
+uint32_t rf24_millis(void);
+
+/** Wait until rf24_micros() reaches @p deadline */
+void rf24_sleep_until(uint64_t deadline);
+
+/** Wait @p us microseconds */
+void rf24_delay_us(uint32_t us);
+
+/** Wait @p ms milliseconds */
+void rf24_delay_ms(uint32_t ms);
+
+/**
+ * Remaining time below which a delay spins instead of sleeping, in us.
+ *
+ * Measured on first use as the time the kernel takes to wake up a sleeping
+ * thread, or taken from the RF24_SPIN_US environment variable.
+ */
+uint32_t rf24_spin_threshold(void);
+
+/** Override the spin threshold, 0 never spins and always sleeps */
+void rf24_set_spin_threshold(uint32_t us);
+
+/**
+ * \endcond
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RF24_TIMING_H */